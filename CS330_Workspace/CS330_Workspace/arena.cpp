@@ -0,0 +1,329 @@
+#include "arena.h"
+#include "cpuprofiler.h"
+#include "glstate.h"
+#include "renderstats.h"
+#include <iostream>
+using namespace std;
+
+/**
+ * @brief Creates a geometry arena with one vertex buffer, one index buffer, and one VAO.
+ *
+ * The vertex and index buffers are allocated once with immutable storage and
+ * meshes are appended to them with UArenaAddMesh. Because every mesh shares the
+ * same buffers and vertex layout, the whole scene can be drawn with a single VAO
+ * bind and a single glMultiDrawElementsIndirect call.
+ *
+ * @param maxVertices The number of vertices the arena can hold.
+ * @param maxIndices The number of indices the arena can hold.
+ * @param format The layout every vertex is stored in.
+ * @param indexType The index type every mesh is stored with. Indices are
+ *        relative to each mesh's base vertex, so GL_UNSIGNED_SHORT only limits
+ *        each mesh, not the arena, to 65536 vertices (see UChooseIndexType).
+ * @param arena The GLGeometryArena structure to hold the arena data.
+ * @return True if the arena was created, otherwise false.
+ */
+bool UCreateGeometryArena(GLsizei maxVertices, GLsizei maxIndices, VertexFormatId format, GLenum indexType,
+    GLGeometryArena& arena)
+{
+    CPU_ZONE("UCreateGeometryArena");
+
+    // Clears stale errors so the check below only reports allocation failures
+    while (glGetError() != GL_NO_ERROR) {}
+
+    arena.format = &UGetVertexFormat(format);
+    arena.indexType = indexType;
+    arena.maxVertices = maxVertices;
+    arena.maxIndices = maxIndices;
+    arena.vertexCount = 0;
+    arena.indexCount = 0;
+    arena.instanceCapacity = 0;
+    arena.commandCapacity = 0;
+
+    glGenVertexArrays(1, &arena.vao);
+    UStateBindVertexArray(arena.vao);
+
+    // Creates the vertex, position, index, instance, and indirect command buffers
+    GLuint buffers[5];
+    glGenBuffers(5, buffers);
+    arena.vertexBuffer = buffers[0];
+    arena.indexBuffer = buffers[1];
+    arena.instanceBuffer = buffers[2];
+    arena.indirectBuffer = buffers[3];
+    arena.positionBuffer = buffers[4];
+
+    // Fixed-size storage for geometry; meshes are written with glBufferSubData
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffer);
+    glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)arena.format->stride * maxVertices, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer);
+    glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)UIndexSize(indexType) * maxIndices, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    // One vertex layout and one instance layout for every mesh in the arena
+    UBindVertexFormat(*arena.format, arena.vertexBuffer);
+    UBindInstanceAttributes(arena.instanceBuffer);
+
+    // A second VAO over the same indices and instances that fetches only positions,
+    // so depth-only passes read 12 (or 8 compact) bytes per vertex instead of 32 (or 16)
+    glGenVertexArrays(1, &arena.depthVao);
+    UStateBindVertexArray(arena.depthVao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, arena.positionBuffer);
+    glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)arena.format->positionStride * maxVertices, NULL, GL_DYNAMIC_STORAGE_BIT);
+    UBindVertexFormatPositions(*arena.format, arena.positionBuffer);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.indexBuffer);
+    UBindInstanceAttributes(arena.instanceBuffer);
+
+    UStateBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        cout << "ERROR::ARENA::ALLOCATION_FAILED" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Copies built geometry into the arena and describes it with a GLMesh.
+ *
+ * The vertices are first encoded in the arena's format and the indices in its
+ * index type; the GLMesh keeps the scale and bias that decode its positions
+ * (see UMakeMeshInstance). See UArenaAddEncodedMesh for the rest.
+ *
+ * @param arena The GLGeometryArena structure to allocate from.
+ * @param data The MeshData structure holding the geometry.
+ * @param mesh The GLMesh structure describing the allocation.
+ * @return True if the geometry fit in the arena and its index type, otherwise false.
+ */
+bool UArenaAddMesh(GLGeometryArena& arena, const MeshData& data, GLMesh& mesh)
+{
+    // Encode in the arena's format; the depth-only stream keeps just the positions
+    EncodedVertices encoded;
+    UEncodeVertices(*arena.format, data, encoded);
+
+    vector<unsigned char> indexBytes;
+    UEncodeIndices(data.indices, arena.indexType, indexBytes);
+
+    GLMesh bounds;
+    UComputeMeshBounds(data, bounds);
+
+    EncodedMeshView view;
+    view.vertices = encoded.vertices.data();
+    view.positions = encoded.positions.data();
+    view.indices = indexBytes.data();
+    view.indexType = arena.indexType;
+    view.vertexCount = (GLsizei)(data.vertices.size() / FLOATS_PER_VERTEX);
+    view.indexCount = (GLsizei)data.indices.size();
+    view.positionScale = encoded.positionScale;
+    view.positionBias = encoded.positionBias;
+    view.texCoordScale = encoded.texCoordScale;
+    view.texCoordBias = encoded.texCoordBias;
+    view.boundsMin = bounds.boundsMin;
+    view.boundsMax = bounds.boundsMax;
+    view.boundsCenter = bounds.boundsCenter;
+    view.boundsRadius = bounds.boundsRadius;
+
+    return UArenaAddEncodedMesh(arena, view, mesh);
+}
+
+/**
+ * @brief Copies geometry already in the arena's vertex format into the arena.
+ *
+ * The vertex, position, and index streams are uploaded straight from the
+ * view's memory, which may be a file mapping (see UMeshCacheLevel). Indices
+ * are only converted when the view's index type differs from the arena's.
+ * The mesh's indices stay relative to its own vertices; the returned GLMesh
+ * records where they landed (firstIndex, baseVertex) so draw commands can find
+ * them. Arena meshes own no GL objects; UDestroyGeometryArena frees them all.
+ *
+ * @param arena The GLGeometryArena structure to allocate from.
+ * @param view The EncodedMeshView structure describing the geometry.
+ * @param mesh The GLMesh structure describing the allocation.
+ * @return True if the geometry fit in the arena and its index type, otherwise false.
+ */
+bool UArenaAddEncodedMesh(GLGeometryArena& arena, const EncodedMeshView& view, GLMesh& mesh)
+{
+    GLsizei numVertices = view.vertexCount;
+    GLsizei numIndices = view.indexCount;
+
+    if (numVertices > arena.maxVertices - arena.vertexCount || numIndices > arena.maxIndices - arena.indexCount)
+    {
+        cout << "ERROR::ARENA::OUT_OF_SPACE" << endl;
+        return false;
+    }
+
+    if (UIndexSize(UChooseIndexType(numVertices)) > UIndexSize(arena.indexType))
+    {
+        cout << "ERROR::ARENA::INDEX_TYPE_TOO_SMALL" << endl;
+        return false;
+    }
+
+    // Only widened or narrowed indices need a copy
+    const void* indices = view.indices;
+    vector<unsigned char> indexBytes;
+    if (view.indexType != arena.indexType)
+    {
+        vector<GLuint> values(numIndices);
+        for (GLsizei i = 0; i < numIndices; ++i)
+        {
+            values[i] = view.indexType == GL_UNSIGNED_SHORT ?
+                ((const GLushort*)view.indices)[i] : ((const GLuint*)view.indices)[i];
+        }
+        UEncodeIndices(values, arena.indexType, indexBytes);
+        indices = indexBytes.data();
+    }
+
+    GLsizeiptr vertexBytes = (GLsizeiptr)arena.format->stride * numVertices;
+    GLsizeiptr positionBytes = (GLsizeiptr)arena.format->positionStride * numVertices;
+    GLsizeiptr indexSize = (GLsizeiptr)UIndexSize(arena.indexType) * numIndices;
+
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vertexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)arena.format->stride * arena.vertexCount, vertexBytes, view.vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.positionBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)arena.format->positionStride * arena.vertexCount,
+        positionBytes, view.positions);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The element array binding is VAO state, so upload through the arena's VAO
+    UStateBindVertexArray(arena.vao);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)UIndexSize(arena.indexType) * arena.indexCount,
+        indexSize, indices);
+    UStateBindVertexArray(0);
+    UCountBufferUpload(vertexBytes + positionBytes + indexSize);
+
+    mesh.nIndices = numIndices;
+    mesh.indexType = arena.indexType;
+    mesh.firstIndex = arena.indexCount;
+    mesh.baseVertex = arena.vertexCount;
+    mesh.positionScale = view.positionScale;
+    mesh.positionBias = view.positionBias;
+    mesh.texCoordScale = view.texCoordScale;
+    mesh.texCoordBias = view.texCoordBias;
+    mesh.boundsMin = view.boundsMin;
+    mesh.boundsMax = view.boundsMax;
+    mesh.boundsCenter = view.boundsCenter;
+    mesh.boundsRadius = view.boundsRadius;
+
+    arena.vertexCount += numVertices;
+    arena.indexCount += numIndices;
+
+    return true;
+}
+
+/**
+ * @brief Builds the indirect draw command for a range of a mesh's instances.
+ *
+ * @param mesh The arena mesh to draw.
+ * @param instanceCount The number of instances to draw.
+ * @param baseInstance The index of the first GLInstance record to use.
+ * @return The filled-in command.
+ */
+DrawElementsIndirectCommand UArenaCommand(const GLMesh& mesh, GLuint instanceCount, GLuint baseInstance)
+{
+    DrawElementsIndirectCommand command;
+    command.count = mesh.nIndices;
+    command.instanceCount = instanceCount;
+    command.firstIndex = mesh.firstIndex;
+    command.baseVertex = mesh.baseVertex;
+    command.baseInstance = baseInstance;
+    return command;
+}
+
+/**
+ * @brief Uploads this frame's draw commands and instance records.
+ *
+ * Both buffers are orphaned before they are rewritten so the driver can hand
+ * back fresh storage instead of waiting for the previous frame's draws.
+ *
+ * @param arena The GLGeometryArena structure to upload to.
+ * @param commands A pointer to the draw commands.
+ * @param commandCount The number of draw commands.
+ * @param instances A pointer to the instance records referenced by the commands.
+ * @param instanceCount The number of instance records.
+ */
+void UArenaUpload(GLGeometryArena& arena, const DrawElementsIndirectCommand* commands, GLsizei commandCount,
+    const GLInstance* instances, GLsizei instanceCount)
+{
+    // Grow geometrically so steadily growing scenes do not reallocate every frame
+    while (arena.instanceCapacity < instanceCount)
+        arena.instanceCapacity = arena.instanceCapacity > 0 ? arena.instanceCapacity * 2 : 64;
+    while (arena.commandCapacity < commandCount)
+        arena.commandCapacity = arena.commandCapacity > 0 ? arena.commandCapacity * 2 : 64;
+
+    glBindBuffer(GL_ARRAY_BUFFER, arena.instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLInstance) * arena.instanceCapacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLInstance) * instanceCount, instances);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, arena.indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand) * arena.commandCapacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * commandCount, commands);
+
+    UCountBufferUpload(sizeof(GLInstance) * instanceCount + sizeof(DrawElementsIndirectCommand) * commandCount);
+}
+
+/**
+ * @brief Binds the arena's VAO and indirect command buffer for drawing.
+ *
+ * @param arena The GLGeometryArena structure to draw from.
+ */
+void UBindGeometryArena(const GLGeometryArena& arena)
+{
+    UStateBindVertexArray(arena.vao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, arena.indirectBuffer);
+}
+
+/**
+ * @brief Binds the arena's position-only VAO and indirect command buffer for depth-only drawing.
+ *
+ * The same commands draw the same triangles as through UBindGeometryArena,
+ * but only positions and model matrices are fetched.
+ *
+ * @param arena The GLGeometryArena structure to draw from.
+ */
+void UBindGeometryArenaPositions(const GLGeometryArena& arena)
+{
+    UStateBindVertexArray(arena.depthVao);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, arena.indirectBuffer);
+}
+
+/**
+ * @brief Draws a range of the uploaded commands with one glMultiDrawElementsIndirect.
+ *
+ * The arena must be bound with UBindGeometryArena first, so consecutive draws
+ * from the same arena do not rebind its VAO.
+ *
+ * @param arena The GLGeometryArena structure holding the uploaded commands.
+ * @param firstCommand The index of the first command to draw.
+ * @param commandCount The number of commands to draw.
+ */
+void UArenaDraw(const GLGeometryArena& arena, GLsizei firstCommand, GLsizei commandCount)
+{
+    glMultiDrawElementsIndirect(GL_TRIANGLES, arena.indexType,
+        (void*)(sizeof(DrawElementsIndirectCommand) * firstCommand), commandCount, 0);
+    UCountDrawCall();
+}
+
+/**
+ * @brief Deletes the arena's VAO and buffers.
+ *
+ * Every GLMesh allocated from the arena becomes invalid.
+ *
+ * @param arena The GLGeometryArena structure to be destroyed.
+ */
+void UDestroyGeometryArena(GLGeometryArena& arena)
+{
+    glDeleteVertexArrays(1, &arena.vao);
+    UStateForgetVertexArray(arena.vao);
+    glDeleteVertexArrays(1, &arena.depthVao);
+    UStateForgetVertexArray(arena.depthVao);
+
+    GLuint buffers[5] = { arena.vertexBuffer, arena.indexBuffer, arena.instanceBuffer, arena.indirectBuffer, arena.positionBuffer };
+    glDeleteBuffers(5, buffers);
+
+    arena.vertexCount = 0;
+    arena.indexCount = 0;
+}
\ No newline at end of file
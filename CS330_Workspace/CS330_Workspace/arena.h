@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "vertexformat.h"
+
+// Layout of one glMultiDrawElementsIndirect command
+struct DrawElementsIndirectCommand {
+    GLuint count;          // number of indices
+    GLuint instanceCount;  // number of instances
+    GLuint firstIndex;     // offset of the first index in the arena's index buffer
+    GLint baseVertex;      // offset added to every index
+    GLuint baseInstance;   // offset of the first GLInstance record
+};
+
+// Struct to hold a mesh already encoded in an arena's vertex format, such as a mesh cache level
+struct EncodedMeshView {
+    const void* vertices;     // vertexCount * format stride bytes
+    const void* positions;    // vertexCount * format positionStride bytes
+    const void* indices;      // indexCount indices of indexType, relative to the mesh's first vertex
+    GLenum indexType;
+    GLsizei vertexCount;
+    GLsizei indexCount;
+    glm::vec3 positionScale;  // object position = stored position * scale + bias
+    glm::vec3 positionBias;
+    glm::vec2 texCoordScale;  // texture coordinate = stored coordinate * scale + bias
+    glm::vec2 texCoordBias;
+    glm::vec3 boundsMin;      // object-space bounds, as computed by UComputeMeshBounds
+    glm::vec3 boundsMax;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+};
+
+// Struct to hold a shared geometry pool that every scene mesh suballocates from
+struct GLGeometryArena {
+    GLuint vao;               // single VAO shared by every mesh in the arena
+    GLuint depthVao;          // VAO reading only positions and instance model matrices, for depth-only passes
+    const VertexFormat* format; // layout of every vertex in the arena
+    GLuint vertexBuffer;      // immutable storage for maxVertices vertices
+    GLuint positionBuffer;    // immutable storage for maxVertices positions in the format's position layout, read by depthVao
+    GLuint indexBuffer;       // immutable storage for maxIndices indices of indexType
+    GLenum indexType;         // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, shared by every mesh so one multi-draw covers them
+    GLuint instanceBuffer;    // GLInstance records for the current frame
+    GLuint indirectBuffer;    // DrawElementsIndirectCommand records for the current frame
+    GLsizei maxVertices;
+    GLsizei maxIndices;
+    GLsizei vertexCount;      // vertices allocated so far
+    GLsizei indexCount;       // indices allocated so far
+    GLsizei instanceCapacity; // GLInstance records the instance buffer can hold
+    GLsizei commandCapacity;  // commands the indirect buffer can hold
+};
+
+bool UCreateGeometryArena(GLsizei maxVertices, GLsizei maxIndices, VertexFormatId format, GLenum indexType,
+    GLGeometryArena& arena);
+bool UArenaAddMesh(GLGeometryArena& arena, const MeshData& data, GLMesh& mesh);
+bool UArenaAddEncodedMesh(GLGeometryArena& arena, const EncodedMeshView& view, GLMesh& mesh);
+DrawElementsIndirectCommand UArenaCommand(const GLMesh& mesh, GLuint instanceCount, GLuint baseInstance);
+void UArenaUpload(GLGeometryArena& arena, const DrawElementsIndirectCommand* commands, GLsizei commandCount,
+    const GLInstance* instances, GLsizei instanceCount);
+void UBindGeometryArena(const GLGeometryArena& arena);
+void UBindGeometryArenaPositions(const GLGeometryArena& arena);
+void UArenaDraw(const GLGeometryArena& arena, GLsizei firstCommand, GLsizei commandCount);
+void UDestroyGeometryArena(GLGeometryArena& arena);
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Returns the nearest-rank percentile of sorted samples.
+     */
+    double percentile(const vector<double>& sorted, double fraction)
+    {
+        size_t rank = (size_t)ceil(fraction * sorted.size());
+        return sorted[rank > 0 ? rank - 1 : 0];
+    }
+
+    /**
+     * @brief Writes a string as a JSON string literal.
+     */
+    void writeJsonString(ostream& out, const string& value)
+    {
+        out << '"';
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            char c = value[i];
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if ((unsigned char)c >= 0x20)
+                out << c;
+        }
+        out << '"';
+    }
+
+    /**
+     * @brief Writes the statistics of a timing series as a JSON object.
+     */
+    void writeJsonStats(ostream& out, const vector<double>& samples)
+    {
+        TimingStats stats = UComputeTimingStats(samples);
+        out << "{ \"mean\": " << stats.mean << ", \"p50\": " << stats.p50 << ", \"p99\": " << stats.p99 << " }";
+    }
+}
+
+/**
+ * @brief Computes the mean, median, and 99th percentile of a series of timings.
+ *
+ * @param samples The timings in milliseconds.
+ * @return The statistics, all zero for an empty series.
+ */
+TimingStats UComputeTimingStats(const vector<double>& samples)
+{
+    TimingStats stats = { 0.0, 0.0, 0.0 };
+    if (samples.empty())
+        return stats;
+
+    vector<double> sorted(samples);
+    sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+        sum += sorted[i];
+
+    stats.mean = sum / sorted.size();
+    stats.p50 = percentile(sorted, 0.50);
+    stats.p99 = percentile(sorted, 0.99);
+    return stats;
+}
+
+/**
+ * @brief Writes a benchmark report as JSON.
+ *
+ * The report holds the renderer, the number of recorded frames, and the mean,
+ * p50, and p99 of the CPU and GPU frame times in milliseconds.
+ *
+ * @param results The BenchmarkResults structure to report.
+ * @param filename The file to write, or nullptr for standard output.
+ * @return True if the report was written, otherwise false.
+ */
+bool UWriteBenchmarkReport(const BenchmarkResults& results, const char* filename)
+{
+    ofstream file;
+    if (filename)
+    {
+        file.open(filename);
+        if (!file)
+        {
+            cout << "ERROR::BENCHMARK::WRITE_FAILED " << filename << endl;
+            return false;
+        }
+    }
+    ostream& out = filename ? (ostream&)file : cout;
+
+    out << "{\n";
+    out << "  \"renderer\": ";
+    writeJsonString(out, results.renderer);
+    out << ",\n  \"version\": ";
+    writeJsonString(out, results.version);
+    out << ",\n  \"warmupFrames\": " << results.warmupFrames;
+    out << ",\n  \"frames\": " << results.cpuMs.size();
+    out << ",\n  \"cpuMs\": ";
+    writeJsonStats(out, results.cpuMs);
+    out << ",\n  \"gpuMs\": ";
+    writeJsonStats(out, results.gpuMs);
+    out << "\n}" << endl;
+
+    return (bool)out;
+}
\ No newline at end of file
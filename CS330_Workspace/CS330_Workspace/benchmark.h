@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Struct to hold summary statistics of a series of timings, in milliseconds
+struct TimingStats {
+    double mean;
+    double p50;
+    double p99;
+};
+
+// Struct to hold the per-frame timings collected by a benchmark run
+struct BenchmarkResults {
+    std::string renderer;       // GL_RENDERER of the context that ran the benchmark
+    std::string version;        // GL_VERSION of the context that ran the benchmark
+    int warmupFrames;           // frames rendered before recording started
+    std::vector<double> cpuMs;  // CPU time per recorded frame
+    std::vector<double> gpuMs;  // GPU time per recorded frame
+};
+
+TimingStats UComputeTimingStats(const std::vector<double>& samples);
+bool UWriteBenchmarkReport(const BenchmarkResults& results, const char* filename);
\ No newline at end of file
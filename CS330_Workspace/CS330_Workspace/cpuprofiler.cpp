@@ -0,0 +1,182 @@
+#include "cpuprofiler.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+using namespace std;
+
+std::atomic<bool> gCpuProfilerEnabled(false);
+
+namespace
+{
+    // Struct to hold the zone events of one thread. Only the owning thread
+    // writes; head is published with release ordering so the exporter can
+    // read every event below it without a lock.
+    struct CPUThreadRing {
+        vector<CPUZoneEvent> events;
+        atomic<uint64_t> head;      // total events written (the slot is head % size)
+        uint32_t threadIndex;       // small id used as the trace tid
+    };
+
+    mutex gRingsMutex;                    // guards gRings; taken once per thread
+    vector<CPUThreadRing*> gRings;
+    thread_local CPUThreadRing* tRing = nullptr;
+
+    // Calibration of the tick counter against steady_clock
+    uint64_t gStartTicks = 0;
+    chrono::steady_clock::time_point gStartTime;
+
+    /**
+     * @brief Returns the calling thread's ring, creating it on first use.
+     */
+    CPUThreadRing* threadRing()
+    {
+        if (!tRing)
+        {
+            CPUThreadRing* ring = new CPUThreadRing;
+            ring->events.resize(CPU_PROFILER_RING_SIZE);
+            ring->head.store(0, memory_order_relaxed);
+
+            lock_guard<mutex> lock(gRingsMutex);
+            ring->threadIndex = (uint32_t)gRings.size();
+            gRings.push_back(ring);
+            tRing = ring;
+        }
+        return tRing;
+    }
+}
+
+/**
+ * @brief Reads the CPU timestamp counter used by the zones.
+ *
+ * The invariant TSC is used on x86 (a few cycles per read); other targets
+ * fall back to std::chrono::steady_clock. Ticks are converted to time when
+ * the trace is written.
+ *
+ * @return The current tick count.
+ */
+uint64_t UCpuTimestamp()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief Appends a completed zone to the calling thread's ring.
+ *
+ * Called by CPUZone; no lock is taken after the thread's first zone.
+ *
+ * @param name The zone name (a string literal).
+ * @param begin The UCpuTimestamp at zone entry.
+ * @param end The UCpuTimestamp at zone exit.
+ */
+void URecordCPUZone(const char* name, uint64_t begin, uint64_t end)
+{
+    CPUThreadRing* ring = threadRing();
+    uint64_t head = ring->head.load(memory_order_relaxed);
+
+    CPUZoneEvent& event = ring->events[head % CPU_PROFILER_RING_SIZE];
+    event.name = name;
+    event.begin = begin;
+    event.end = end;
+
+    ring->head.store(head + 1, memory_order_release);
+}
+
+/**
+ * @brief Turns zone recording on or off.
+ *
+ * Enabling also records the reference point used to convert ticks to time.
+ *
+ * @param enabled True to record zones.
+ */
+void UEnableCPUProfiler(bool enabled)
+{
+    if (enabled && gStartTicks == 0)
+    {
+        gStartTicks = UCpuTimestamp();
+        gStartTime = chrono::steady_clock::now();
+    }
+    gCpuProfilerEnabled.store(enabled, memory_order_relaxed);
+}
+
+/**
+ * @brief Writes every recorded zone in the Chrome trace event format.
+ *
+ * The file opens in chrome://tracing and in Perfetto. Tick rates are derived
+ * from the time elapsed since UEnableCPUProfiler, so the conversion is exact
+ * for the TSC and for steady_clock alike. Call this when the recording
+ * threads are idle (for example at exit): a ring that wraps while it is
+ * being read can yield a torn event.
+ *
+ * @param filename The JSON file to write.
+ * @return True if the file was written, otherwise false.
+ */
+bool UWriteChromeTrace(const char* filename)
+{
+    ofstream out(filename);
+    if (!out)
+    {
+        cout << "ERROR::CPUPROFILER::WRITE_FAILED " << filename << endl;
+        return false;
+    }
+
+    // Ticks per microsecond over the whole recording
+    uint64_t ticks = UCpuTimestamp() - gStartTicks;
+    double microseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - gStartTime).count();
+    double ticksPerMicrosecond = microseconds > 0.0 ? ticks / microseconds : 1.0;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out.setf(ios::fixed);
+    out.precision(3);
+
+    bool first = true;
+    lock_guard<mutex> lock(gRingsMutex);
+    for (size_t r = 0; r < gRings.size(); ++r)
+    {
+        const CPUThreadRing* ring = gRings[r];
+        uint64_t head = ring->head.load(memory_order_acquire);
+        uint64_t count = head < CPU_PROFILER_RING_SIZE ? head : CPU_PROFILER_RING_SIZE;
+
+        for (uint64_t i = head - count; i < head; ++i)
+        {
+            const CPUZoneEvent& event = ring->events[i % CPU_PROFILER_RING_SIZE];
+            double begin = (double)(int64_t)(event.begin - gStartTicks) / ticksPerMicrosecond;
+            double duration = (double)(event.end - event.begin) / ticksPerMicrosecond;
+
+            out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << ring->threadIndex << ",\"ts\":" << begin << ",\"dur\":" << duration << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+
+    return (bool)out;
+}
+
+/**
+ * @brief Disables recording and frees every thread's ring.
+ *
+ * Only call this once no other thread records zones.
+ */
+void UShutdownCPUProfiler()
+{
+    gCpuProfilerEnabled.store(false, memory_order_relaxed);
+
+    lock_guard<mutex> lock(gRingsMutex);
+    for (size_t i = 0; i < gRings.size(); ++i)
+        delete gRings[i];
+    gRings.clear();
+    tRing = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Number of zone events each thread keeps; older events are overwritten
+const uint32_t CPU_PROFILER_RING_SIZE = 1 << 16;
+
+// Struct to hold one completed zone
+struct CPUZoneEvent {
+    const char* name;   // string literal naming the zone
+    uint64_t begin;     // UCpuTimestamp ticks
+    uint64_t end;
+};
+
+// Set by UEnableCPUProfiler; read by every zone
+extern std::atomic<bool> gCpuProfilerEnabled;
+
+uint64_t UCpuTimestamp();
+
+void URecordCPUZone(const char* name, uint64_t begin, uint64_t end);
+void UEnableCPUProfiler(bool enabled);
+bool UWriteChromeTrace(const char* filename);
+void UShutdownCPUProfiler();
+
+// RAII zone: times the enclosing scope while the profiler is enabled.
+// When it is disabled, entering and leaving a zone each cost one branch on
+// a value that does not change during the frame.
+class CPUZone {
+public:
+    explicit CPUZone(const char* name)
+        : mName(nullptr), mBegin(0)
+    {
+        if (gCpuProfilerEnabled.load(std::memory_order_relaxed))
+        {
+            mName = name;
+            mBegin = UCpuTimestamp();
+        }
+    }
+
+    ~CPUZone()
+    {
+        if (mName)
+            URecordCPUZone(mName, mBegin, UCpuTimestamp());
+    }
+
+private:
+    CPUZone(const CPUZone&);
+    CPUZone& operator=(const CPUZone&);
+
+    const char* mName;
+    uint64_t mBegin;
+};
+
+#define CPU_ZONE_CONCAT2(a, b) a##b
+#define CPU_ZONE_CONCAT(a, b) CPU_ZONE_CONCAT2(a, b)
+
+// Times the rest of the enclosing scope as a zone called name (a string literal)
+#define CPU_ZONE(name) CPUZone CPU_ZONE_CONCAT(cpuZone, __LINE__)(name)
\ No newline at end of file
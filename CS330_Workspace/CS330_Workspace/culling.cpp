@@ -0,0 +1,232 @@
+#include "culling.h"
+#include <glm/simd/platform.h>
+#include <cmath>
+using namespace std;
+
+// unnamed namespace to hold the per-width test kernels
+namespace
+{
+    // Struct to hold a plane with its normal's absolute values, broadcast once per cull
+    struct CullingPlane
+    {
+        float x, y, z, w;
+        float absX, absY, absZ;
+    };
+
+    /**
+     * @brief Prepares the planes for the box term |n| . extent.
+     */
+    void preparePlanes(const glm::vec4 planes[6], CullingPlane prepared[6])
+    {
+        for (int p = 0; p < 6; ++p)
+        {
+            prepared[p].x = planes[p].x;
+            prepared[p].y = planes[p].y;
+            prepared[p].z = planes[p].z;
+            prepared[p].w = planes[p].w;
+            prepared[p].absX = fabs(planes[p].x);
+            prepared[p].absY = fabs(planes[p].y);
+            prepared[p].absZ = fabs(planes[p].z);
+        }
+    }
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+    /**
+     * @brief Tests eight objects against every plane with AVX.
+     */
+    void cullBatch8(const CullingPlane planes[6], CullingBounds& bounds, size_t first)
+    {
+        __m256 cx = _mm256_loadu_ps(&bounds.centerX[first]);
+        __m256 cy = _mm256_loadu_ps(&bounds.centerY[first]);
+        __m256 cz = _mm256_loadu_ps(&bounds.centerZ[first]);
+        __m256 r = _mm256_loadu_ps(&bounds.radius[first]);
+        __m256 ex = _mm256_loadu_ps(&bounds.extentX[first]);
+        __m256 ey = _mm256_loadu_ps(&bounds.extentY[first]);
+        __m256 ez = _mm256_loadu_ps(&bounds.extentZ[first]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (int p = 0; p < 6; ++p)
+        {
+            const CullingPlane& plane = planes[p];
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), _mm256_set1_ps(plane.w)));
+            __m256 boxReach = _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(_mm256_set1_ps(plane.absX), ex), _mm256_mul_ps(_mm256_set1_ps(plane.absY), ey)),
+                _mm256_mul_ps(_mm256_set1_ps(plane.absZ), ez));
+            __m256 reach = _mm256_min_ps(r, boxReach);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int k = 0; k < 8; ++k)
+            bounds.visible[first + k] = (uint8_t)((mask >> k) & 1);
+    }
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    /**
+     * @brief Tests four objects against every plane with SSE.
+     */
+    void cullBatch4(const CullingPlane planes[6], CullingBounds& bounds, size_t first)
+    {
+        __m128 cx = _mm_loadu_ps(&bounds.centerX[first]);
+        __m128 cy = _mm_loadu_ps(&bounds.centerY[first]);
+        __m128 cz = _mm_loadu_ps(&bounds.centerZ[first]);
+        __m128 r = _mm_loadu_ps(&bounds.radius[first]);
+        __m128 ex = _mm_loadu_ps(&bounds.extentX[first]);
+        __m128 ey = _mm_loadu_ps(&bounds.extentY[first]);
+        __m128 ez = _mm_loadu_ps(&bounds.extentZ[first]);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int p = 0; p < 6; ++p)
+        {
+            const CullingPlane& plane = planes[p];
+            __m128 distance = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+            __m128 boxReach = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(plane.absX), ex), _mm_mul_ps(_mm_set1_ps(plane.absY), ey)),
+                _mm_mul_ps(_mm_set1_ps(plane.absZ), ez));
+            __m128 reach = _mm_min_ps(r, boxReach);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k)
+            bounds.visible[first + k] = (uint8_t)((mask >> k) & 1);
+    }
+#else
+    /**
+     * @brief Tests one object against every plane.
+     */
+    void cullOne(const CullingPlane planes[6], CullingBounds& bounds, size_t i)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p)
+        {
+            const CullingPlane& plane = planes[p];
+            float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+            float boxReach = plane.absX * bounds.extentX[i] + plane.absY * bounds.extentY[i] + plane.absZ * bounds.extentZ[i];
+            float reach = bounds.radius[i] < boxReach ? bounds.radius[i] : boxReach;
+            inside = distance + reach >= 0.0f;
+        }
+        bounds.visible[i] = inside ? 1 : 0;
+    }
+#endif
+}
+
+
+/**
+ * @brief Sets the number of objects the bounds hold.
+ *
+ * The arrays are padded with empty bounds up to a multiple of CULLING_BATCH so
+ * the batched tests never read past the end. New objects start out visible
+ * with zero-sized bounds until USetCullingBounds is called for them.
+ *
+ * @param bounds The CullingBounds structure to resize.
+ * @param count The number of objects.
+ */
+void UResizeCullingBounds(CullingBounds& bounds, size_t count)
+{
+    size_t padded = (count + CULLING_BATCH - 1) / CULLING_BATCH * CULLING_BATCH;
+    bounds.centerX.resize(padded, 0.0f);
+    bounds.centerY.resize(padded, 0.0f);
+    bounds.centerZ.resize(padded, 0.0f);
+    bounds.radius.resize(padded, 0.0f);
+    bounds.extentX.resize(padded, 0.0f);
+    bounds.extentY.resize(padded, 0.0f);
+    bounds.extentZ.resize(padded, 0.0f);
+    bounds.visible.resize(padded, 1);
+    bounds.count = count;
+}
+
+/**
+ * @brief Transforms a mesh's bounds to world space and stores them for an object.
+ *
+ * The box becomes the world-space box enclosing the transformed box (its
+ * extent is |M| times the local extent), and the sphere radius is scaled by
+ * the largest axis scale of the matrix. Only call this when the object moves.
+ *
+ * @param bounds The CullingBounds structure to write.
+ * @param index The object's index.
+ * @param mesh The mesh whose object-space bounds are transformed.
+ * @param world The object's world matrix.
+ */
+void USetCullingBounds(CullingBounds& bounds, size_t index, const GLMesh& mesh, const glm::mat4& world)
+{
+    glm::vec3 center = glm::vec3(world * glm::vec4(mesh.boundsCenter, 1.0f));
+    glm::vec3 localExtent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+
+    glm::mat3 linear(world);
+    glm::mat3 absolute(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+    glm::vec3 extent = absolute * localExtent;
+
+    float scale = glm::max(glm::length(linear[0]), glm::max(glm::length(linear[1]), glm::length(linear[2])));
+
+    bounds.centerX[index] = center.x;
+    bounds.centerY[index] = center.y;
+    bounds.centerZ[index] = center.z;
+    bounds.radius[index] = mesh.boundsRadius * scale;
+    bounds.extentX[index] = extent.x;
+    bounds.extentY[index] = extent.y;
+    bounds.extentZ[index] = extent.z;
+}
+
+/**
+ * @brief Extracts the six frustum planes from a view-projection matrix.
+ *
+ * Each plane is a sum or difference of the matrix's fourth row and one of the
+ * first three (Gribb and Hartmann), normalized so that plane.xyz . p + plane.w
+ * is the signed distance of p, positive inside. The order is left, right,
+ * bottom, top, near, far.
+ *
+ * @param viewProjection The projection * view matrix.
+ * @param planes The array receiving the six planes.
+ */
+void UExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+    glm::mat4 rows = glm::transpose(viewProjection);
+
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+
+    for (int p = 0; p < 6; ++p)
+        planes[p] /= glm::length(glm::vec3(planes[p]));
+}
+
+/**
+ * @brief Tests every object's bounds against the frustum.
+ *
+ * An object is culled when it lies entirely behind one plane, using whichever
+ * of its sphere and box reaches less far toward that plane. The objects are
+ * tested eight at a time with AVX, four at a time with SSE, or one at a time
+ * without SIMD, writing bounds.visible.
+ *
+ * @param planes The frustum planes from UExtractFrustumPlanes.
+ * @param bounds The CullingBounds structure to test.
+ * @return The number of visible objects.
+ */
+size_t UCullBounds(const glm::vec4 planes[6], CullingBounds& bounds)
+{
+    CullingPlane prepared[6];
+    preparePlanes(planes, prepared);
+
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+    for (size_t i = 0; i < bounds.count; i += 8)
+        cullBatch8(prepared, bounds, i);
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    for (size_t i = 0; i < bounds.count; i += 4)
+        cullBatch4(prepared, bounds, i);
+#else
+    for (size_t i = 0; i < bounds.count; ++i)
+        cullOne(prepared, bounds, i);
+#endif
+
+    size_t visible = 0;
+    for (size_t i = 0; i < bounds.count; ++i)
+        visible += bounds.visible[i];
+    return visible;
+}
\ No newline at end of file
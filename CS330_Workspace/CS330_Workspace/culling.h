@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+
+// Number of bounds tested together; arrays are padded to a multiple of it
+const size_t CULLING_BATCH = 8;
+
+// Struct to hold world-space bounds in structure-of-arrays form for batched frustum tests.
+// Each object has one center shared by its bounding sphere and its bounding box.
+struct CullingBounds {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;     // bounding sphere radius
+    std::vector<float> extentX;    // half size of the axis-aligned bounding box
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+    std::vector<uint8_t> visible;  // result of the last UCullBounds, 1 if inside the frustum
+    size_t count;                  // objects in use (the arrays hold count rounded up to CULLING_BATCH)
+};
+
+void UResizeCullingBounds(CullingBounds& bounds, size_t count);
+void USetCullingBounds(CullingBounds& bounds, size_t index, const GLMesh& mesh, const glm::mat4& world);
+void UExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+size_t UCullBounds(const glm::vec4 planes[6], CullingBounds& bounds);
\ No newline at end of file
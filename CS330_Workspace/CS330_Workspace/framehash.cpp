@@ -0,0 +1,201 @@
+#include "framehash.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+using namespace std;
+
+namespace
+{
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    /**
+     * @brief Folds bytes into a 64-bit FNV-1a hash.
+     */
+    uint64_t fnv1a(uint64_t hash, const unsigned char* bytes, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    /**
+     * @brief Waits for a buffer's readback, hashes it, and frees the slot.
+     */
+    void resolveSlot(GLFrameHasher& hasher, int slot)
+    {
+        if (!hasher.fences[slot])
+            return;
+
+        // The readback was issued frames ago, so this rarely has to wait
+        glClientWaitSync(hasher.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(hasher.fences[slot]);
+        hasher.fences[slot] = 0;
+
+        // A minimized window has an empty framebuffer, and empty ranges cannot be mapped
+        GLsizeiptr size = (GLsizeiptr)hasher.width * hasher.height * 4;
+        uint64_t hash = FNV_OFFSET_BASIS;
+        if (size > 0)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, hasher.pbos[slot]);
+            const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+            hash = pixels ? fnv1a(FNV_OFFSET_BASIS, pixels, (size_t)size) : 0;
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        uint32_t frame = hasher.frames[slot];
+        if (hasher.hashes.size() <= frame)
+            hasher.hashes.resize(frame + 1, 0);
+        hasher.hashes[frame] = hash;
+    }
+}
+
+/**
+ * @brief Creates the pixel buffers used to hash rendered frames.
+ *
+ * @param width The width of the frames in pixels.
+ * @param height The height of the frames in pixels.
+ * @param hasher The GLFrameHasher structure to hold the buffers.
+ * @return True if the buffers were created, otherwise false.
+ */
+bool UCreateFrameHasher(GLsizei width, GLsizei height, GLFrameHasher& hasher)
+{
+    hasher.width = width;
+    hasher.height = height;
+    hasher.frame = 0;
+    hasher.hashes.clear();
+
+    glGenBuffers(FRAME_HASH_LATENCY, hasher.pbos);
+    for (int i = 0; i < FRAME_HASH_LATENCY; ++i)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, hasher.pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+        hasher.fences[i] = 0;
+        hasher.frames[i] = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        cout << "ERROR::FRAMEHASH::ALLOCATION_FAILED" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reallocates the pixel buffers for a new framebuffer size.
+ *
+ * Readbacks still in flight are hashed at the size they were taken at first,
+ * so every hash covers the whole framebuffer of its frame.
+ *
+ * @param width The new width of the frames in pixels.
+ * @param height The new height of the frames in pixels.
+ * @param hasher The GLFrameHasher structure holding the buffers.
+ */
+void UResizeFrameHasher(GLsizei width, GLsizei height, GLFrameHasher& hasher)
+{
+    if (width == hasher.width && height == hasher.height)
+        return;
+
+    UFinishFrameHasher(hasher);
+    hasher.width = width;
+    hasher.height = height;
+
+    for (int i = 0; i < FRAME_HASH_LATENCY; ++i)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, hasher.pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/**
+ * @brief Starts reading back the frame just rendered.
+ *
+ * The pixels are copied into a pixel buffer asynchronously and hashed
+ * FRAME_HASH_LATENCY frames later, so capturing does not stall the pipeline.
+ * Call this after drawing and before swapping buffers.
+ *
+ * @param hasher The GLFrameHasher structure to capture into.
+ */
+void UCaptureFrame(GLFrameHasher& hasher)
+{
+    int slot = hasher.frame % FRAME_HASH_LATENCY;
+    resolveSlot(hasher, slot);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, hasher.pbos[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, hasher.width, hasher.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    hasher.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    hasher.frames[slot] = hasher.frame++;
+}
+
+/**
+ * @brief Hashes every readback still in flight.
+ *
+ * @param hasher The GLFrameHasher structure to finish.
+ */
+void UFinishFrameHasher(GLFrameHasher& hasher)
+{
+    for (uint32_t i = 0; i < FRAME_HASH_LATENCY; ++i)
+        resolveSlot(hasher, (hasher.frame + i) % FRAME_HASH_LATENCY);
+}
+
+/**
+ * @brief Combines every frame hash into one value that identifies the run.
+ *
+ * @param hasher The GLFrameHasher structure holding the hashes.
+ * @return The FNV-1a hash of the per-frame hashes.
+ */
+uint64_t UCombinedFrameHash(const GLFrameHasher& hasher)
+{
+    return fnv1a(FNV_OFFSET_BASIS, (const unsigned char*)hasher.hashes.data(),
+        hasher.hashes.size() * sizeof(uint64_t));
+}
+
+/**
+ * @brief Writes one hexadecimal hash per line, one line per frame.
+ *
+ * @param hasher The GLFrameHasher structure holding the hashes.
+ * @param filename The text file to write.
+ * @return True if the file was written, otherwise false.
+ */
+bool UWriteFrameHashes(const GLFrameHasher& hasher, const char* filename)
+{
+    ofstream out(filename);
+    if (!out)
+    {
+        cout << "ERROR::FRAMEHASH::WRITE_FAILED " << filename << endl;
+        return false;
+    }
+
+    out << hex << setfill('0');
+    for (size_t i = 0; i < hasher.hashes.size(); ++i)
+        out << setw(16) << hasher.hashes[i] << "\n";
+
+    return (bool)out;
+}
+
+/**
+ * @brief Deletes the pixel buffers and any pending fences.
+ *
+ * @param hasher The GLFrameHasher structure to be destroyed.
+ */
+void UDestroyFrameHasher(GLFrameHasher& hasher)
+{
+    for (int i = 0; i < FRAME_HASH_LATENCY; ++i)
+    {
+        if (hasher.fences[i])
+            glDeleteSync(hasher.fences[i]);
+        hasher.fences[i] = 0;
+    }
+    glDeleteBuffers(FRAME_HASH_LATENCY, hasher.pbos);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+
+// Number of frames a readback may stay in flight before its hash is needed
+const int FRAME_HASH_LATENCY = 3;
+
+// Struct to hold the pixel buffers that frames are read back into for hashing
+struct GLFrameHasher {
+    GLuint pbos[FRAME_HASH_LATENCY];
+    GLsync fences[FRAME_HASH_LATENCY];   // signalled when a readback has landed
+    uint32_t frames[FRAME_HASH_LATENCY]; // frame number held by each buffer
+    GLsizei width;
+    GLsizei height;
+    uint32_t frame;                      // frames captured so far
+    std::vector<uint64_t> hashes;        // one per captured frame, in order
+};
+
+bool UCreateFrameHasher(GLsizei width, GLsizei height, GLFrameHasher& hasher);
+void UResizeFrameHasher(GLsizei width, GLsizei height, GLFrameHasher& hasher);
+void UCaptureFrame(GLFrameHasher& hasher);
+void UFinishFrameHasher(GLFrameHasher& hasher);
+uint64_t UCombinedFrameHash(const GLFrameHasher& hasher);
+bool UWriteFrameHashes(const GLFrameHasher& hasher, const char* filename);
+void UDestroyFrameHasher(GLFrameHasher& hasher);
\ No newline at end of file
@@ -0,0 +1,358 @@
+#include "glstate.h"
+#include "renderstats.h"
+
+// unnamed namespace to hold the shadowed state
+namespace
+{
+    // value marking a binding whose current GL value is unknown
+    const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    // capabilities tracked by UStateEnable and UStateDisable
+    const GLenum TRACKED_CAPABILITIES[] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_SCISSOR_TEST, GL_STENCIL_TEST };
+    const int NUM_CAPABILITIES = sizeof(TRACKED_CAPABILITIES) / sizeof(TRACKED_CAPABILITIES[0]);
+
+    // texture targets shadowed per unit
+    const GLenum TRACKED_TARGETS[] = { GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY };
+    const int NUM_TARGETS = sizeof(TRACKED_TARGETS) / sizeof(TRACKED_TARGETS[0]);
+
+    GLuint gProgram = UNKNOWN;
+    GLuint gVertexArray = UNKNOWN;
+    GLenum gActiveUnit = UNKNOWN;
+    GLuint gTextures[STATE_TEXTURE_UNITS][NUM_TARGETS]; // zero (GL's default) until invalidated
+    int gCapabilities[NUM_CAPABILITIES];    // 1 enabled, 0 disabled (GL's default), -1 unknown
+    GLfloat gClearColor[4];
+    bool gClearColorKnown = false;
+    GLenum gDepthFunc = GL_LESS;            // GL's defaults until invalidated
+    GLuint gDepthMask = GL_TRUE;
+    GLuint gColorMask = GL_TRUE;            // the same for all four channels
+    GLenum gBlendSource = GL_ONE;
+    GLenum gBlendDestination = GL_ZERO;
+
+    GLStateCounters gCounters = { 0, 0 };
+
+    // Returns the slot of a tracked capability, or -1
+    int capabilitySlot(GLenum capability)
+    {
+        for (int i = 0; i < NUM_CAPABILITIES; ++i)
+        {
+            if (TRACKED_CAPABILITIES[i] == capability)
+                return i;
+        }
+        return -1;
+    }
+
+    // Returns the slot of a tracked texture target, or -1
+    int targetSlot(GLenum target)
+    {
+        for (int i = 0; i < NUM_TARGETS; ++i)
+        {
+            if (TRACKED_TARGETS[i] == target)
+                return i;
+        }
+        return -1;
+    }
+
+    // Sets a capability through the cache
+    void setCapability(GLenum capability, int enabled)
+    {
+        int slot = capabilitySlot(capability);
+        if (slot >= 0 && gCapabilities[slot] == enabled)
+        {
+            ++gCounters.elided;
+            return;
+        }
+
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+
+        if (slot >= 0)
+            gCapabilities[slot] = enabled;
+        ++gCounters.issued;
+    }
+}
+
+
+/**
+ * @brief Marks every shadowed value as unknown.
+ *
+ * The next call for each piece of state is always forwarded to GL. Call this
+ * after code outside the cache (a library, a debugging tool) changed state.
+ */
+void UStateInvalidate()
+{
+    gProgram = UNKNOWN;
+    gVertexArray = UNKNOWN;
+    gActiveUnit = UNKNOWN;
+
+    for (GLuint unit = 0; unit < STATE_TEXTURE_UNITS; ++unit)
+    {
+        for (int target = 0; target < NUM_TARGETS; ++target)
+            gTextures[unit][target] = UNKNOWN;
+    }
+
+    for (int i = 0; i < NUM_CAPABILITIES; ++i)
+        gCapabilities[i] = -1;
+
+    gClearColorKnown = false;
+    gDepthFunc = UNKNOWN;
+    gDepthMask = UNKNOWN;
+    gColorMask = UNKNOWN;
+    gBlendSource = UNKNOWN;
+    gBlendDestination = UNKNOWN;
+}
+
+/**
+ * @brief Binds a shader program unless it is already in use.
+ *
+ * @param program The ID of the program to use.
+ */
+void UStateUseProgram(GLuint program)
+{
+    if (program == gProgram)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glUseProgram(program);
+    gProgram = program;
+    ++gCounters.issued;
+    UCountProgramBind();
+}
+
+/**
+ * @brief Binds a vertex array object unless it is already bound.
+ *
+ * @param vao The ID of the VAO to bind.
+ */
+void UStateBindVertexArray(GLuint vao)
+{
+    if (vao == gVertexArray)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glBindVertexArray(vao);
+    gVertexArray = vao;
+    ++gCounters.issued;
+    UCountVertexArrayBind();
+}
+
+/**
+ * @brief Selects the active texture unit unless it is already active.
+ *
+ * @param unit The texture unit enum (GL_TEXTURE0 + n).
+ */
+void UStateActiveTexture(GLenum unit)
+{
+    if (unit == gActiveUnit)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glActiveTexture(unit);
+    gActiveUnit = unit;
+    ++gCounters.issued;
+}
+
+/**
+ * @brief Binds a texture to the active unit unless it is already bound there.
+ *
+ * GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY bindings are shadowed for the first
+ * STATE_TEXTURE_UNITS units; other targets and units are always forwarded.
+ *
+ * @param target The texture target.
+ * @param texture The ID of the texture to bind.
+ */
+void UStateBindTexture(GLenum target, GLuint texture)
+{
+    int slot = targetSlot(target);
+    GLuint unit = gActiveUnit - GL_TEXTURE0;
+    bool tracked = slot >= 0 && gActiveUnit != UNKNOWN && unit < STATE_TEXTURE_UNITS;
+
+    if (tracked && gTextures[unit][slot] == texture)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glBindTexture(target, texture);
+    if (tracked)
+        gTextures[unit][slot] = texture;
+    ++gCounters.issued;
+    UCountTextureBind();
+}
+
+/**
+ * @brief Enables a capability unless it is already enabled.
+ *
+ * @param capability The capability enum (GL_DEPTH_TEST, GL_CULL_FACE, ...).
+ */
+void UStateEnable(GLenum capability)
+{
+    setCapability(capability, 1);
+}
+
+/**
+ * @brief Disables a capability unless it is already disabled.
+ *
+ * @param capability The capability enum (GL_DEPTH_TEST, GL_CULL_FACE, ...).
+ */
+void UStateDisable(GLenum capability)
+{
+    setCapability(capability, 0);
+}
+
+/**
+ * @brief Sets the clear color unless it already has this value.
+ *
+ * @param red The red component.
+ * @param green The green component.
+ * @param blue The blue component.
+ * @param alpha The alpha component.
+ */
+void UStateClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    if (gClearColorKnown && gClearColor[0] == red && gClearColor[1] == green &&
+        gClearColor[2] == blue && gClearColor[3] == alpha)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glClearColor(red, green, blue, alpha);
+    gClearColor[0] = red;
+    gClearColor[1] = green;
+    gClearColor[2] = blue;
+    gClearColor[3] = alpha;
+    gClearColorKnown = true;
+    ++gCounters.issued;
+}
+
+/**
+ * @brief Sets the depth comparison unless it already has this value.
+ *
+ * @param func The comparison enum (GL_LESS, GL_EQUAL, ...).
+ */
+void UStateDepthFunc(GLenum func)
+{
+    if (func == gDepthFunc)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glDepthFunc(func);
+    gDepthFunc = func;
+    ++gCounters.issued;
+}
+
+/**
+ * @brief Enables or disables depth writes unless they are already in that state.
+ *
+ * @param write GL_TRUE to write depth, GL_FALSE to only test it.
+ */
+void UStateDepthMask(GLboolean write)
+{
+    if (write == gDepthMask)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glDepthMask(write);
+    gDepthMask = write;
+    ++gCounters.issued;
+}
+
+/**
+ * @brief Enables or disables color writes unless they are already in that state.
+ *
+ * @param write GL_TRUE to write all four channels, GL_FALSE to write none.
+ */
+void UStateColorMask(GLboolean write)
+{
+    if (write == gColorMask)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glColorMask(write, write, write, write);
+    gColorMask = write;
+    ++gCounters.issued;
+}
+
+/**
+ * @brief Sets the blend factors unless they already have these values.
+ *
+ * @param source The source factor enum.
+ * @param destination The destination factor enum.
+ */
+void UStateBlendFunc(GLenum source, GLenum destination)
+{
+    if (source == gBlendSource && destination == gBlendDestination)
+    {
+        ++gCounters.elided;
+        return;
+    }
+
+    glBlendFunc(source, destination);
+    gBlendSource = source;
+    gBlendDestination = destination;
+    ++gCounters.issued;
+}
+
+/**
+ * @brief Updates the shadow after a texture is deleted.
+ *
+ * Deleting a texture unbinds it from every unit, and its ID may be reused by
+ * the next texture created, so its cached bindings are reset to 0.
+ *
+ * @param texture The ID of the deleted texture.
+ */
+void UStateForgetTexture(GLuint texture)
+{
+    for (GLuint unit = 0; unit < STATE_TEXTURE_UNITS; ++unit)
+    {
+        for (int target = 0; target < NUM_TARGETS; ++target)
+        {
+            if (gTextures[unit][target] == texture)
+                gTextures[unit][target] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Updates the shadow after a vertex array object is deleted.
+ *
+ * @param vao The ID of the deleted VAO.
+ */
+void UStateForgetVertexArray(GLuint vao)
+{
+    if (gVertexArray == vao)
+        gVertexArray = 0;
+}
+
+/**
+ * @brief Returns the calls issued and elided since the last reset.
+ *
+ * @return The current GLStateCounters.
+ */
+GLStateCounters UStateCounters()
+{
+    return gCounters;
+}
+
+/**
+ * @brief Resets the issued and elided counters, typically once per frame.
+ */
+void UStateResetCounters()
+{
+    gCounters.issued = 0;
+    gCounters.elided = 0;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Number of texture units whose bindings are shadowed
+const GLuint STATE_TEXTURE_UNITS = 16;
+
+// Struct to hold the number of state calls forwarded to and skipped before the driver
+struct GLStateCounters {
+    unsigned int issued;   // calls that changed state and reached GL
+    unsigned int elided;   // calls skipped because the state already matched
+};
+
+void UStateInvalidate();
+void UStateUseProgram(GLuint program);
+void UStateBindVertexArray(GLuint vao);
+void UStateActiveTexture(GLenum unit);
+void UStateBindTexture(GLenum target, GLuint texture);
+void UStateEnable(GLenum capability);
+void UStateDisable(GLenum capability);
+void UStateClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void UStateDepthFunc(GLenum func);
+void UStateDepthMask(GLboolean write);
+void UStateColorMask(GLboolean write);
+void UStateBlendFunc(GLenum source, GLenum destination);
+void UStateForgetTexture(GLuint texture);
+void UStateForgetVertexArray(GLuint vao);
+GLStateCounters UStateCounters();
+void UStateResetCounters();
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "gpuprofiler.h"
+#include "cpuprofiler.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Adds a sample to a scope and refreshes its rolling statistics.
+     */
+    void addSample(GPUScopeStats& stats, double ms)
+    {
+        if (stats.history.size() < (size_t)GPU_PROFILER_HISTORY)
+            stats.history.push_back(ms);
+        else
+            stats.history[stats.next] = ms;
+        stats.next = (stats.next + 1) % GPU_PROFILER_HISTORY;
+        ++stats.samples;
+
+        stats.lastMs = ms;
+        stats.minMs = stats.maxMs = ms;
+        double sum = 0.0;
+        for (size_t i = 0; i < stats.history.size(); ++i)
+        {
+            sum += stats.history[i];
+            if (stats.history[i] < stats.minMs)
+                stats.minMs = stats.history[i];
+            if (stats.history[i] > stats.maxMs)
+                stats.maxMs = stats.history[i];
+        }
+        stats.meanMs = sum / stats.history.size();
+    }
+
+    /**
+     * @brief Reads back a frame's timestamps if the GPU has written all of them.
+     *
+     * Only the last query issued in the frame is checked: queries complete in
+     * the order they were issued, so once it is available every earlier one is
+     * too. With nested scopes that is an outer scope's end, not the last slot's,
+     * so UEndGPUScope records which query it was. Nothing here waits.
+     */
+    void collectFrame(GPUProfiler& profiler, GPUProfilerFrame& frame)
+    {
+        if (frame.scopeCount == 0)
+            return;
+
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(frame.queries[frame.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            ++profiler.droppedFrames;
+            frame.scopeCount = 0;
+            return;
+        }
+
+        for (int i = 0; i < frame.scopeCount; ++i)
+        {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+            addSample(profiler.scopes[frame.scopes[i]], (end - begin) / 1.0e6);
+        }
+
+        frame.scopeCount = 0;
+    }
+}
+
+/**
+ * @brief Creates the query ring of a GPU profiler.
+ *
+ * Each of the GPU_PROFILER_FRAMES frame slots owns enough GL_TIMESTAMP queries
+ * for GPU_PROFILER_MAX_SCOPES scopes. A slot is only read back when it comes
+ * around again, by which time the GPU has normally finished it, so reading
+ * the results never stalls the pipeline.
+ *
+ * @param profiler The GPUProfiler structure to initialize.
+ * @return True if the queries were created, otherwise false.
+ */
+bool UCreateGPUProfiler(GPUProfiler& profiler)
+{
+    CPU_ZONE("UCreateGPUProfiler");
+
+    for (int i = 0; i < GPU_PROFILER_FRAMES; ++i)
+    {
+        glGenQueries(GPU_PROFILER_MAX_SCOPES * 2, profiler.frames[i].queries);
+        profiler.frames[i].scopeCount = 0;
+        profiler.frames[i].lastQuery = 0;
+    }
+
+    profiler.frame = 0;
+    profiler.openCount = 0;
+    profiler.overflowCount = 0;
+    profiler.droppedFrames = 0;
+    profiler.scopes.clear();
+
+    GLint timestampBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+    if (timestampBits == 0)
+    {
+        cout << "ERROR::GPUPROFILER::TIMESTAMPS_UNSUPPORTED" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Returns the id of a named scope, registering the name on first use.
+ *
+ * Look the id up once and keep it; the lookup compares strings.
+ *
+ * @param profiler The GPUProfiler structure holding the scopes.
+ * @param name The name shown in the overlay and the reports.
+ * @return The scope id to pass to UBeginGPUScope.
+ */
+int UGPUScopeId(GPUProfiler& profiler, const char* name)
+{
+    for (size_t i = 0; i < profiler.scopes.size(); ++i)
+    {
+        if (profiler.scopes[i].name == name)
+            return (int)i;
+    }
+
+    GPUScopeStats stats;
+    stats.name = name;
+    stats.lastMs = stats.meanMs = stats.minMs = stats.maxMs = 0.0;
+    stats.next = 0;
+    stats.samples = 0;
+    profiler.scopes.push_back(stats);
+    return (int)profiler.scopes.size() - 1;
+}
+
+/**
+ * @brief Starts recording a frame, collecting the oldest frame in the ring.
+ *
+ * @param profiler The GPUProfiler structure to record into.
+ */
+void UBeginGPUFrame(GPUProfiler& profiler)
+{
+    collectFrame(profiler, profiler.frames[profiler.frame]);
+    profiler.openCount = 0;
+    profiler.overflowCount = 0;
+}
+
+/**
+ * @brief Timestamps the start of a scope. Scopes may nest.
+ *
+ * Once the frame has used all GPU_PROFILER_MAX_SCOPES slots, further scopes
+ * are counted but not timed, so their UEndGPUScope calls still match them
+ * instead of ending an enclosing scope early.
+ *
+ * @param profiler The GPUProfiler structure to record into.
+ * @param scope The scope id returned by UGPUScopeId.
+ */
+void UBeginGPUScope(GPUProfiler& profiler, int scope)
+{
+    GPUProfilerFrame& frame = profiler.frames[profiler.frame];
+    if (frame.scopeCount >= GPU_PROFILER_MAX_SCOPES)
+    {
+        ++profiler.overflowCount;
+        return;
+    }
+
+    int slot = frame.scopeCount++;
+    frame.scopes[slot] = scope;
+    profiler.openScopes[profiler.openCount++] = slot;
+    glQueryCounter(frame.queries[slot * 2], GL_TIMESTAMP);
+}
+
+/**
+ * @brief Timestamps the end of the innermost open scope.
+ *
+ * @param profiler The GPUProfiler structure to record into.
+ */
+void UEndGPUScope(GPUProfiler& profiler)
+{
+    // Untimed scopes are always the innermost, since no slot is free once one begins
+    if (profiler.overflowCount > 0)
+    {
+        --profiler.overflowCount;
+        return;
+    }
+    if (profiler.openCount == 0)
+        return;
+
+    GPUProfilerFrame& frame = profiler.frames[profiler.frame];
+    int slot = profiler.openScopes[--profiler.openCount];
+    frame.lastQuery = slot * 2 + 1;
+    glQueryCounter(frame.queries[frame.lastQuery], GL_TIMESTAMP);
+}
+
+/**
+ * @brief Finishes the frame and moves on to the next slot of the ring.
+ *
+ * @param profiler The GPUProfiler structure being recorded.
+ */
+void UEndGPUFrame(GPUProfiler& profiler)
+{
+    // Close scopes left open so every begin timestamp has an end
+    profiler.overflowCount = 0;
+    while (profiler.openCount > 0)
+        UEndGPUScope(profiler);
+
+    profiler.frame = (profiler.frame + 1) % GPU_PROFILER_FRAMES;
+}
+
+/**
+ * @brief Formats the rolling mean of every scope on one line for an overlay.
+ *
+ * @param profiler The GPUProfiler structure to format.
+ * @return A line such as "GPU frame 1.20 ms | clear 0.05 ms".
+ */
+string UFormatGPUProfile(const GPUProfiler& profiler)
+{
+    ostringstream line;
+    line.setf(ios::fixed);
+    line.precision(2);
+    line << "GPU";
+    for (size_t i = 0; i < profiler.scopes.size(); ++i)
+        line << (i == 0 ? " " : " | ") << profiler.scopes[i].name << " " << profiler.scopes[i].meanMs << " ms";
+    return line.str();
+}
+
+/**
+ * @brief Writes the statistics of every scope to a file.
+ *
+ * Files ending in ".json" get a JSON array of objects; anything else gets CSV
+ * with a header row. All times are in milliseconds over the last
+ * GPU_PROFILER_HISTORY samples.
+ *
+ * @param profiler The GPUProfiler structure to report.
+ * @param filename The file to write.
+ * @return True if the file was written, otherwise false.
+ */
+bool UWriteGPUProfile(const GPUProfiler& profiler, const char* filename)
+{
+    ofstream out(filename);
+    if (!out)
+    {
+        cout << "ERROR::GPUPROFILER::WRITE_FAILED " << filename << endl;
+        return false;
+    }
+
+    size_t length = strlen(filename);
+    bool json = length >= 5 && strcmp(filename + length - 5, ".json") == 0;
+
+    if (json)
+        out << "[\n";
+    else
+        out << "scope,samples,last_ms,mean_ms,min_ms,max_ms\n";
+
+    for (size_t i = 0; i < profiler.scopes.size(); ++i)
+    {
+        const GPUScopeStats& stats = profiler.scopes[i];
+        if (json)
+        {
+            out << "  { \"scope\": \"" << stats.name << "\", \"samples\": " << stats.samples
+                << ", \"lastMs\": " << stats.lastMs << ", \"meanMs\": " << stats.meanMs
+                << ", \"minMs\": " << stats.minMs << ", \"maxMs\": " << stats.maxMs << " }"
+                << (i + 1 < profiler.scopes.size() ? ",\n" : "\n");
+        }
+        else
+        {
+            out << stats.name << "," << stats.samples << "," << stats.lastMs << "," << stats.meanMs
+                << "," << stats.minMs << "," << stats.maxMs << "\n";
+        }
+    }
+
+    if (json)
+        out << "]\n";
+
+    return (bool)out;
+}
+
+/**
+ * @brief Deletes the profiler's queries.
+ *
+ * @param profiler The GPUProfiler structure to be destroyed.
+ */
+void UDestroyGPUProfiler(GPUProfiler& profiler)
+{
+    for (int i = 0; i < GPU_PROFILER_FRAMES; ++i)
+    {
+        glDeleteQueries(GPU_PROFILER_MAX_SCOPES * 2, profiler.frames[i].queries);
+        profiler.frames[i].scopeCount = 0;
+    }
+    profiler.scopes.clear();
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+// Number of frames of queries in flight before results are read back
+const int GPU_PROFILER_FRAMES = 4;
+// Maximum number of scopes timed in one frame
+const int GPU_PROFILER_MAX_SCOPES = 32;
+// Number of recent samples the rolling statistics are computed over
+const int GPU_PROFILER_HISTORY = 120;
+
+// Struct to hold the rolling statistics of one named scope, in milliseconds
+struct GPUScopeStats {
+    std::string name;
+    double lastMs;
+    double meanMs;
+    double minMs;
+    double maxMs;
+    std::vector<double> history;  // ring of the last GPU_PROFILER_HISTORY samples
+    size_t next;                  // slot in history written by the next sample
+    unsigned long long samples;   // samples recorded since the profiler was created
+};
+
+// Struct to hold the queries issued during one frame
+struct GPUProfilerFrame {
+    GLuint queries[GPU_PROFILER_MAX_SCOPES * 2];  // begin and end timestamp per scope
+    int scopes[GPU_PROFILER_MAX_SCOPES];          // scope id of each begin/end pair
+    int scopeCount;
+    int lastQuery;                                // index of the last timestamp issued, always an end
+};
+
+// Struct to hold a ring of GL_TIMESTAMP queries and the per-scope statistics
+struct GPUProfiler {
+    GPUProfilerFrame frames[GPU_PROFILER_FRAMES];
+    int frame;                          // frame slot currently being recorded
+    int openScopes[GPU_PROFILER_MAX_SCOPES]; // stack of scope slots begun but not ended
+    int openCount;
+    int overflowCount;                  // scopes begun after the frame ran out of slots, still open
+    std::vector<GPUScopeStats> scopes;  // indexed by scope id
+    unsigned long long droppedFrames;   // frames whose results were not ready in time
+};
+
+bool UCreateGPUProfiler(GPUProfiler& profiler);
+int UGPUScopeId(GPUProfiler& profiler, const char* name);
+void UBeginGPUFrame(GPUProfiler& profiler);
+void UBeginGPUScope(GPUProfiler& profiler, int scope);
+void UEndGPUScope(GPUProfiler& profiler);
+void UEndGPUFrame(GPUProfiler& profiler);
+std::string UFormatGPUProfile(const GPUProfiler& profiler);
+bool UWriteGPUProfile(const GPUProfiler& profiler, const char* filename);
+void UDestroyGPUProfiler(GPUProfiler& profiler);
\ No newline at end of file
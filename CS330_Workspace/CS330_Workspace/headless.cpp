@@ -0,0 +1,200 @@
+#include "headless.h"
+#include "cpuprofiler.h"
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+using namespace std;
+
+/**
+ * @brief Creates an OpenGL 4.4 core context without a window.
+ *
+ * On Linux this uses EGL. The Mesa surfaceless platform is preferred because
+ * it needs neither an X server nor a GPU (it runs on llvmpipe); otherwise the
+ * default display is used. The context renders into framebuffer objects, so
+ * its own surface is only a 1x1 pbuffer, or no surface at all when the config
+ * has no pbuffer support. Other platforms report an error.
+ *
+ * @param context The GLHeadlessContext structure to hold the context.
+ * @return True if the context was created and made current, otherwise false.
+ */
+bool UCreateHeadlessContext(GLHeadlessContext& context)
+{
+    CPU_ZONE("UCreateHeadlessContext");
+
+    context.display = nullptr;
+    context.config = nullptr;
+    context.context = nullptr;
+    context.surface = nullptr;
+
+#if defined(__linux__)
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // Prefer the surfaceless platform when the client library offers it
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        cout << "ERROR::HEADLESS::NO_DISPLAY" << endl;
+        return false;
+    }
+    context.display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        cout << "ERROR::HEADLESS::NO_OPENGL_API" << endl;
+        UDestroyHeadlessContext(context);
+        return false;
+    }
+
+    // Look for a pbuffer-capable config first, then for any OpenGL config
+    const EGLint pbufferAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    const EGLint anyAttributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    bool pbuffer = eglChooseConfig(display, pbufferAttributes, &config, 1, &configCount) && configCount > 0;
+    if (!pbuffer && (!eglChooseConfig(display, anyAttributes, &config, 1, &configCount) || configCount == 0))
+    {
+        cout << "ERROR::HEADLESS::NO_CONFIG" << endl;
+        UDestroyHeadlessContext(context);
+        return false;
+    }
+    context.config = config;
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 4,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED" << endl;
+        UDestroyHeadlessContext(context);
+        return false;
+    }
+    context.context = eglContext;
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (pbuffer)
+    {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    }
+    context.surface = surface;
+
+    if (!eglMakeCurrent(display, surface, surface, eglContext))
+    {
+        cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << endl;
+        UDestroyHeadlessContext(context);
+        return false;
+    }
+
+    return true;
+#else
+    cout << "ERROR::HEADLESS::UNSUPPORTED_PLATFORM" << endl;
+    return false;
+#endif
+}
+
+/**
+ * @brief Releases the headless context and its display.
+ *
+ * @param context The GLHeadlessContext structure to be destroyed.
+ */
+void UDestroyHeadlessContext(GLHeadlessContext& context)
+{
+#if defined(__linux__)
+    if (context.display)
+    {
+        eglMakeCurrent(context.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context.surface)
+            eglDestroySurface(context.display, context.surface);
+        if (context.context)
+            eglDestroyContext(context.display, context.context);
+        eglTerminate(context.display);
+    }
+#endif
+
+    context.display = nullptr;
+    context.config = nullptr;
+    context.context = nullptr;
+    context.surface = nullptr;
+}
+
+/**
+ * @brief Creates a framebuffer object to render into instead of a window.
+ *
+ * The framebuffer is left bound to GL_FRAMEBUFFER, so everything drawn
+ * afterwards lands in it.
+ *
+ * @param width The width of the attachments in pixels.
+ * @param height The height of the attachments in pixels.
+ * @param target The GLRenderTarget structure to hold the framebuffer.
+ * @return True if the framebuffer is complete, otherwise false.
+ */
+bool UCreateRenderTarget(GLsizei width, GLsizei height, GLRenderTarget& target)
+{
+    CPU_ZONE("UCreateRenderTarget");
+
+    target.width = width;
+    target.height = height;
+
+    glGenRenderbuffers(1, &target.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenRenderbuffers(1, &target.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &target.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << endl;
+        UDestroyRenderTarget(target);
+        return false;
+    }
+
+    glViewport(0, 0, width, height);
+    return true;
+}
+
+/**
+ * @brief Deletes the framebuffer and its attachments.
+ *
+ * @param target The GLRenderTarget structure to be destroyed.
+ */
+void UDestroyRenderTarget(GLRenderTarget& target)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &target.fbo);
+    glDeleteRenderbuffers(1, &target.color);
+    glDeleteRenderbuffers(1, &target.depth);
+    target.fbo = target.color = target.depth = 0;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Struct to hold an offscreen OpenGL context that needs no window system
+struct GLHeadlessContext {
+    void* display;   // EGLDisplay
+    void* config;    // EGLConfig
+    void* context;   // EGLContext
+    void* surface;   // EGLSurface (a 1x1 pbuffer, or null when surfaceless)
+};
+
+// Struct to hold a framebuffer object with color and depth attachments
+struct GLRenderTarget {
+    GLuint fbo;
+    GLuint color;    // GL_RGBA8 renderbuffer
+    GLuint depth;    // GL_DEPTH24_STENCIL8 renderbuffer
+    GLsizei width;
+    GLsizei height;
+};
+
+bool UCreateHeadlessContext(GLHeadlessContext& context);
+void UDestroyHeadlessContext(GLHeadlessContext& context);
+bool UCreateRenderTarget(GLsizei width, GLsizei height, GLRenderTarget& target);
+void UDestroyRenderTarget(GLRenderTarget& target);
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include "inputrecord.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Returns the index of a key in INPUT_TRACKED_KEYS, or -1.
+     */
+    int trackedKeyIndex(int key)
+    {
+        for (int i = 0; i < INPUT_TRACKED_KEY_COUNT; ++i)
+        {
+            if (INPUT_TRACKED_KEYS[i] == key)
+                return i;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Orders events by the frame they are delivered in.
+     */
+    bool eventFrameLess(const InputEvent& a, const InputEvent& b)
+    {
+        return a.frame < b.frame;
+    }
+}
+
+/**
+ * @brief Starts a new, empty recording.
+ *
+ * @param recording The InputRecording structure to reset.
+ * @param time The current glfwGetTime().
+ */
+void UBeginInputRecording(InputRecording& recording, double time)
+{
+    recording.events.clear();
+    recording.frameCount = 0;
+    recording.frame = 0;
+    recording.startTime = time;
+    recording.next = 0;
+    for (int i = 0; i < INPUT_TRACKED_KEY_COUNT; ++i)
+        recording.keys[i] = false;
+}
+
+/**
+ * @brief Starts a recorded frame and logs the keys that changed state.
+ *
+ * Only transitions are stored, so a held key costs two events in total.
+ * Call this once per frame before the frame's input is processed.
+ *
+ * @param recording The InputRecording structure to append to.
+ * @param window The window whose keys are polled.
+ * @param time The current glfwGetTime().
+ */
+void URecordInputFrame(InputRecording& recording, GLFWwindow* window, double time)
+{
+    recording.frame = recording.frameCount++;
+
+    for (int i = 0; i < INPUT_TRACKED_KEY_COUNT; ++i)
+    {
+        bool pressed = glfwGetKey(window, INPUT_TRACKED_KEYS[i]) == GLFW_PRESS;
+        if (pressed == recording.keys[i])
+            continue;
+
+        recording.keys[i] = pressed;
+
+        InputEvent event;
+        event.frame = recording.frame;
+        event.time = (float)(time - recording.startTime);
+        event.type = (uint16_t)(pressed ? INPUT_KEY_DOWN : INPUT_KEY_UP);
+        event.key = (uint16_t)INPUT_TRACKED_KEYS[i];
+        event.x = event.y = 0.0f;
+        recording.events.push_back(event);
+    }
+}
+
+/**
+ * @brief Logs a cursor or scroll event for the next frame.
+ *
+ * GLFW delivers these while polling at the end of a frame, after that frame's
+ * input was processed, so they are replayed at the start of the next frame.
+ *
+ * @param recording The InputRecording structure to append to.
+ * @param type INPUT_CURSOR or INPUT_SCROLL.
+ * @param x The cursor x position or the horizontal scroll offset.
+ * @param y The cursor y position or the vertical scroll offset.
+ * @param time The current glfwGetTime().
+ */
+void URecordInputEvent(InputRecording& recording, InputEventType type, float x, float y, double time)
+{
+    InputEvent event;
+    event.frame = recording.frameCount;
+    event.time = (float)(time - recording.startTime);
+    event.type = (uint16_t)type;
+    event.key = 0;
+    event.x = x;
+    event.y = y;
+    recording.events.push_back(event);
+}
+
+/**
+ * @brief Writes a recording to a binary file.
+ *
+ * @param recording The InputRecording structure to write.
+ * @param filename The file to create.
+ * @return True if the file was written, otherwise false.
+ */
+bool USaveInputRecording(const InputRecording& recording, const char* filename)
+{
+    InputRecordingHeader header;
+    header.magic = INPUT_RECORDING_MAGIC;
+    header.version = INPUT_RECORDING_VERSION;
+    header.frameCount = recording.frameCount;
+    header.eventCount = (uint32_t)recording.events.size();
+
+    ofstream out(filename, ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)recording.events.data(), recording.events.size() * sizeof(InputEvent));
+
+    if (!out)
+    {
+        cout << "ERROR::INPUTRECORD::WRITE_FAILED " << filename << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads a recording written by USaveInputRecording, ready for replay.
+ *
+ * @param filename The file to read.
+ * @param recording The InputRecording structure to hold the events.
+ * @return True if the file is a valid recording, otherwise false.
+ */
+bool ULoadInputRecording(const char* filename, InputRecording& recording)
+{
+    ifstream in(filename, ios::binary);
+    InputRecordingHeader header;
+    if (!in.read((char*)&header, sizeof(header)) ||
+        header.magic != INPUT_RECORDING_MAGIC || header.version != INPUT_RECORDING_VERSION)
+    {
+        cout << "ERROR::INPUTRECORD::INVALID_FILE " << filename << endl;
+        return false;
+    }
+
+    UBeginInputRecording(recording, 0.0);
+    recording.frameCount = header.frameCount;
+    recording.events.resize(header.eventCount);
+    if (header.eventCount > 0 &&
+        !in.read((char*)recording.events.data(), header.eventCount * sizeof(InputEvent)))
+    {
+        cout << "ERROR::INPUTRECORD::INVALID_FILE " << filename << endl;
+        recording.events.clear();
+        return false;
+    }
+
+    // Replay walks the events in frame order; keep the recorded order within a frame
+    stable_sort(recording.events.begin(), recording.events.end(), eventFrameLess);
+
+    return true;
+}
+
+/**
+ * @brief Delivers the next recorded frame's input.
+ *
+ * Key transitions update the state read by UInputKeyPressed; cursor and scroll
+ * events are passed to the same callbacks GLFW would call, in recorded order.
+ *
+ * @param recording The InputRecording structure being replayed.
+ * @param window The window passed on to the callbacks (may be null).
+ * @param cursorCallback The cursor position callback.
+ * @param scrollCallback The scroll callback.
+ * @return True if a frame was delivered, false once the recording has ended.
+ */
+bool UReplayInputFrame(InputRecording& recording, GLFWwindow* window,
+    GLFWcursorposfun cursorCallback, GLFWscrollfun scrollCallback)
+{
+    if (recording.frame >= recording.frameCount)
+        return false;
+
+    while (recording.next < recording.events.size() && recording.events[recording.next].frame == recording.frame)
+    {
+        const InputEvent& event = recording.events[recording.next++];
+        switch (event.type)
+        {
+        case INPUT_KEY_DOWN:
+        case INPUT_KEY_UP:
+        {
+            int index = trackedKeyIndex(event.key);
+            if (index >= 0)
+                recording.keys[index] = event.type == INPUT_KEY_DOWN;
+            break;
+        }
+        case INPUT_CURSOR:
+            cursorCallback(window, event.x, event.y);
+            break;
+        case INPUT_SCROLL:
+            scrollCallback(window, event.x, event.y);
+            break;
+        }
+    }
+
+    ++recording.frame;
+    return true;
+}
+
+/**
+ * @brief Returns whether a tracked key is held in the frame being replayed.
+ *
+ * @param recording The InputRecording structure being replayed.
+ * @param key The GLFW key.
+ * @return True if the key is down.
+ */
+bool UInputKeyPressed(const InputRecording& recording, int key)
+{
+    int index = trackedKeyIndex(key);
+    return index >= 0 && recording.keys[index];
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <vector>
+
+// Input recordings start with INPUT_RECORDING_MAGIC ("INP1" in file order)
+const uint32_t INPUT_RECORDING_MAGIC = 0x31504E49;
+const uint32_t INPUT_RECORDING_VERSION = 1;
+
+// Frame time used when a recording is replayed
+const float INPUT_REPLAY_DELTA_TIME = 1.0f / 60.0f;
+
+// Keys whose state is recorded (every key UProcessInput polls)
+const int INPUT_TRACKED_KEYS[] = {
+    GLFW_KEY_ESCAPE, GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_Q, GLFW_KEY_E, GLFW_KEY_P,
+    GLFW_KEY_Z, GLFW_KEY_O
+};
+const int INPUT_TRACKED_KEY_COUNT = sizeof(INPUT_TRACKED_KEYS) / sizeof(INPUT_TRACKED_KEYS[0]);
+
+enum InputEventType
+{
+    INPUT_KEY_DOWN = 0,
+    INPUT_KEY_UP = 1,
+    INPUT_CURSOR = 2,   // x, y: cursor position
+    INPUT_SCROLL = 3    // x, y: scroll offsets
+};
+
+// Struct to hold one recorded event; this is also its on-disk layout (20 bytes)
+struct InputEvent {
+    uint32_t frame;     // frame the event was delivered in
+    float time;         // seconds since recording started
+    uint16_t type;      // InputEventType
+    uint16_t key;       // GLFW key for key events
+    float x;
+    float y;
+};
+
+// Struct to hold the header of an input recording file
+struct InputRecordingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t eventCount;
+};
+
+// Struct to hold an input recording being written or replayed
+struct InputRecording {
+    std::vector<InputEvent> events;
+    uint32_t frameCount;        // frames covered by the recording
+    uint32_t frame;             // frame currently being recorded or replayed
+    double startTime;           // glfwGetTime() when recording started
+    size_t next;                // next event to replay
+    bool keys[INPUT_TRACKED_KEY_COUNT]; // key state at the current frame
+};
+
+void UBeginInputRecording(InputRecording& recording, double time);
+void URecordInputFrame(InputRecording& recording, GLFWwindow* window, double time);
+void URecordInputEvent(InputRecording& recording, InputEventType type, float x, float y, double time);
+bool USaveInputRecording(const InputRecording& recording, const char* filename);
+bool ULoadInputRecording(const char* filename, InputRecording& recording);
+bool UReplayInputFrame(InputRecording& recording, GLFWwindow* window,
+    GLFWcursorposfun cursorCallback, GLFWscrollfun scrollCallback);
+bool UInputKeyPressed(const InputRecording& recording, int key);
\ No newline at end of file
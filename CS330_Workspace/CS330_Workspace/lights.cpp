@@ -0,0 +1,276 @@
+#include "lights.h"
+#include "cpuprofiler.h"
+#include "glstate.h"
+#include "renderstats.h"
+using namespace std;
+
+// shader program macro
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version " core \n" #Source
+#endif
+
+// unnamed namespace to hold the binning shader
+namespace
+{
+    // One invocation per cluster. Each workgroup walks the light list in chunks
+    // of 128, staging every chunk's view-space spheres in shared memory, and keeps
+    // the lights whose sphere touches the cluster's view-space box.
+    const GLchar* binShaderSource = GLSL(440,
+        layout(local_size_x = 128) in;
+
+        struct Light
+        {
+            vec4 positionRange;
+            vec4 colorType;
+            vec4 directionCutOff;
+            vec4 outerCutOff;
+        };
+
+        layout(std430, binding = 4) readonly buffer Lights { Light lights[]; };
+        layout(std430, binding = 5) writeonly buffer ClusterCounts { uint clusterCounts[]; };
+        layout(std430, binding = 6) writeonly buffer ClusterLights { uint clusterLights[]; };
+
+        uniform mat4 uView;
+        uniform mat4 uInverseProjection;
+        uniform float uNear;
+        uniform float uFar;
+        uniform int uLightCount;
+        uniform int uGridX;
+        uniform int uGridY;
+        uniform int uGridZ;
+        uniform int uMaxLights;
+
+        shared vec4 chunk[128];   // view-space center and range of the staged lights
+
+        // Returns the view-space point at view depth -depth on the ray through an NDC position.
+        // Unprojecting both ends of the ray handles perspective and orthographic projections alike.
+        vec3 pointAtDepth(vec2 ndc, float depth)
+        {
+            vec4 a = uInverseProjection * vec4(ndc, -1.0, 1.0);
+            vec4 b = uInverseProjection * vec4(ndc, 1.0, 1.0);
+            vec3 nearPoint = a.xyz / a.w;
+            vec3 farPoint = b.xyz / b.w;
+            return mix(nearPoint, farPoint, (-depth - nearPoint.z) / (farPoint.z - nearPoint.z));
+        }
+
+        void main()
+        {
+            int cluster = int(gl_GlobalInvocationID.x);
+            bool inGrid = cluster < uGridX * uGridY * uGridZ;
+
+            // View-space box of the cluster: its tile between its slice's two depths
+            int x = cluster % uGridX;
+            int y = (cluster / uGridX) % uGridY;
+            int z = cluster / (uGridX * uGridY);
+            float depth0 = uNear * pow(uFar / uNear, float(z) / float(uGridZ));
+            float depth1 = uNear * pow(uFar / uNear, float(z + 1) / float(uGridZ));
+            vec2 ndc0 = vec2(x, y) / vec2(uGridX, uGridY) * 2.0 - 1.0;
+            vec2 ndc1 = vec2(x + 1, y + 1) / vec2(uGridX, uGridY) * 2.0 - 1.0;
+
+            vec3 boxMin = vec3(1.0e30);
+            vec3 boxMax = vec3(-1.0e30);
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                vec2 ndc = mix(ndc0, ndc1, vec2(corner & 1, (corner >> 1) & 1));
+                vec3 p = pointAtDepth(ndc, (corner & 4) != 0 ? depth1 : depth0);
+                boxMin = min(boxMin, p);
+                boxMax = max(boxMax, p);
+            }
+
+            int count = 0;
+            for (int base = 0; base < uLightCount; base += 128)
+            {
+                int staged = base + int(gl_LocalInvocationIndex);
+                if (staged < uLightCount)
+                {
+                    vec4 positionRange = lights[staged].positionRange;
+                    chunk[gl_LocalInvocationIndex] = vec4((uView * vec4(positionRange.xyz, 1.0)).xyz, positionRange.w);
+                }
+                barrier();
+
+                int chunkCount = min(128, uLightCount - base);
+                for (int j = 0; inGrid && j < chunkCount && count < uMaxLights; ++j)
+                {
+                    // Distance from the sphere's center to the nearest point of the box
+                    vec3 center = chunk[j].xyz;
+                    vec3 offset = center - clamp(center, boxMin, boxMax);
+                    if (dot(offset, offset) <= chunk[j].w * chunk[j].w)
+                    {
+                        clusterLights[cluster * uMaxLights + count] = uint(base + j);
+                        ++count;
+                    }
+                }
+                barrier();
+            }
+
+            if (inGrid)
+                clusterCounts[cluster] = uint(count);
+        }
+    );
+}
+
+
+/**
+ * @brief Compiles the binning shader and allocates the cluster lists.
+ *
+ * @param lights The GLClusteredLights structure to hold the buffers.
+ * @return True if the binning shader was built, otherwise false.
+ */
+bool UCreateClusteredLights(GLClusteredLights& lights)
+{
+    CPU_ZONE("UCreateClusteredLights");
+
+    lights.lightCapacity = 0;
+    lights.lightCount = 0;
+
+    if (!UCreateComputeProgram(binShaderSource, lights.binProgram))
+        return false;
+
+    // The grid never changes, so it is set once; the rest is set by every UBinLights
+    const GLProgram& program = lights.binProgram;
+    UStateUseProgram(program.id);
+    USetUniform(UGetUniform(program, "uGridX"), (GLint)CLUSTER_GRID_X);
+    USetUniform(UGetUniform(program, "uGridY"), (GLint)CLUSTER_GRID_Y);
+    USetUniform(UGetUniform(program, "uGridZ"), (GLint)CLUSTER_GRID_Z);
+    USetUniform(UGetUniform(program, "uMaxLights"), (GLint)CLUSTER_MAX_LIGHTS);
+
+    lights.uniforms.view = UGetUniform(program, "uView");
+    lights.uniforms.inverseProjection = UGetUniform(program, "uInverseProjection");
+    lights.uniforms.nearPlane = UGetUniform(program, "uNear");
+    lights.uniforms.farPlane = UGetUniform(program, "uFar");
+    lights.uniforms.lightCount = UGetUniform(program, "uLightCount");
+
+    GLuint buffers[3];
+    glGenBuffers(3, buffers);
+    lights.lightBuffer = buffers[0];
+    lights.clusterCounts = buffers[1];
+    lights.clusterLights = buffers[2];
+
+    // Cluster lists are written on the GPU only
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lights.clusterCounts);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * CLUSTER_COUNT, NULL, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lights.clusterLights);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * CLUSTER_COUNT * CLUSTER_MAX_LIGHTS, NULL, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    return true;
+}
+
+/**
+ * @brief Builds the record of a point light.
+ *
+ * @param position The light's world position.
+ * @param color The light's color.
+ * @param range The distance past which the light contributes nothing.
+ * @return The filled-in record.
+ */
+GPULight UMakePointLight(const glm::vec3& position, const glm::vec3& color, float range)
+{
+    GPULight light;
+    light.positionRange = glm::vec4(position, range);
+    light.colorType = glm::vec4(color, (float)LIGHT_POINT);
+    light.directionCutOff = glm::vec4(0.0f, -1.0f, 0.0f, 1.0f);
+    light.outerCutOff = glm::vec4(0.0f);
+    return light;
+}
+
+/**
+ * @brief Builds the record of a spotlight.
+ *
+ * @param position The light's world position.
+ * @param direction The direction the cone is aimed along, negated (as in the scene files).
+ * @param color The light's color.
+ * @param cutOff The cosine of the inner cone angle.
+ * @param outerCutOff The cosine of the outer cone angle.
+ * @param range The distance past which the light contributes nothing.
+ * @return The filled-in record.
+ */
+GPULight UMakeSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color,
+    float cutOff, float outerCutOff, float range)
+{
+    GPULight light;
+    light.positionRange = glm::vec4(position, range);
+    light.colorType = glm::vec4(color, (float)LIGHT_SPOT);
+    light.directionCutOff = glm::vec4(direction, cutOff);
+    light.outerCutOff = glm::vec4(outerCutOff, 0.0f, 0.0f, 0.0f);
+    return light;
+}
+
+/**
+ * @brief Uploads this frame's lights.
+ *
+ * The buffer grows geometrically and is orphaned before it is rewritten, like
+ * the arena's instance buffer, so moving lights never wait on the GPU.
+ *
+ * @param lights The GLClusteredLights structure.
+ * @param records A pointer to the light records.
+ * @param count The number of records.
+ */
+void UUploadLights(GLClusteredLights& lights, const GPULight* records, GLsizei count)
+{
+    while (lights.lightCapacity < count)
+        lights.lightCapacity = lights.lightCapacity > 0 ? lights.lightCapacity * 2 : 64;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lights.lightBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GPULight) * (lights.lightCapacity > 0 ? lights.lightCapacity : 1),
+        NULL, GL_STREAM_DRAW);
+    if (count > 0)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GPULight) * count, records);
+        UCountBufferUpload(sizeof(GPULight) * count);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    lights.lightCount = count;
+}
+
+/**
+ * @brief Assigns the uploaded lights to the clusters of the view frustum.
+ *
+ * The frustum between the near and far planes is split into CLUSTER_GRID_X by
+ * CLUSTER_GRID_Y screen tiles and CLUSTER_GRID_Z slices whose depth grows
+ * exponentially, so near and far clusters cover similar screen-space volumes.
+ * A compute pass lists, for every cluster, the lights whose range sphere
+ * touches the cluster's view-space box. The lists are left bound for the
+ * fragment shader, which only loops over its own cluster's lights.
+ *
+ * @param lights The GLClusteredLights structure.
+ * @param view The view matrix.
+ * @param projection The projection matrix.
+ * @param nearPlane The distance to the projection's near plane.
+ * @param farPlane The distance to the projection's far plane.
+ */
+void UBinLights(GLClusteredLights& lights, const glm::mat4& view, const glm::mat4& projection,
+    float nearPlane, float farPlane)
+{
+    UStateUseProgram(lights.binProgram.id);
+    USetUniform(lights.uniforms.view, view);
+    USetUniform(lights.uniforms.inverseProjection, glm::inverse(projection));
+    USetUniform(lights.uniforms.nearPlane, nearPlane);
+    USetUniform(lights.uniforms.farPlane, farPlane);
+    USetUniform(lights.uniforms.lightCount, (GLint)lights.lightCount);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_BINDING_LIGHTS, lights.lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_BINDING_CLUSTER_COUNTS, lights.clusterCounts);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SSBO_BINDING_CLUSTER_LIGHTS, lights.clusterLights);
+
+    glDispatchCompute((CLUSTER_COUNT + 127) / 128, 1, 1);
+
+    // The fragment shaders read the lists this pass wrote
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+/**
+ * @brief Deletes the binning shader and the light and cluster buffers.
+ *
+ * @param lights The GLClusteredLights structure to be destroyed.
+ */
+void UDestroyClusteredLights(GLClusteredLights& lights)
+{
+    GLuint buffers[3] = { lights.lightBuffer, lights.clusterCounts, lights.clusterLights };
+    glDeleteBuffers(3, buffers);
+    UDestroyShaderProgram(lights.binProgram);
+
+    lights.lightCapacity = 0;
+    lights.lightCount = 0;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.h"
+
+// Froxel grid the view frustum is split into: screen tiles by exponential depth slices
+const GLuint CLUSTER_GRID_X = 16;
+const GLuint CLUSTER_GRID_Y = 9;
+const GLuint CLUSTER_GRID_Z = 24;
+const GLuint CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+
+// Light indices stored per cluster; lights past this many are dropped from the cluster
+const GLuint CLUSTER_MAX_LIGHTS = 128;
+
+// Range given to lights that should reach the whole scene
+const float LIGHT_UNBOUNDED_RANGE = 1000.0f;
+
+enum LightType
+{
+    LIGHT_POINT = 0,
+    LIGHT_SPOT = 1
+};
+
+// Struct to hold one light as the shaders read it (std430, 64 bytes)
+struct GPULight {
+    glm::vec4 positionRange;    // world position, and the distance the light reaches
+    glm::vec4 colorType;        // color, and the LightType as a float
+    glm::vec4 directionCutOff;  // spotlight direction, and the cosine of its inner cone
+    glm::vec4 outerCutOff;      // cosine of the spotlight's outer cone (x); yzw unused
+};
+
+// Struct to hold the uniform handles of the binning program that change every frame
+struct ClusterUniforms {
+    GLUniform view;
+    GLUniform inverseProjection;
+    GLUniform nearPlane;
+    GLUniform farPlane;
+    GLUniform lightCount;
+};
+
+// Struct to hold the light list and the per-cluster light lists built from it
+struct GLClusteredLights {
+    GLProgram binProgram;       // assigns lights to clusters
+    ClusterUniforms uniforms;   // resolved once in UCreateClusteredLights
+    GLuint lightBuffer;         // GPULight records (SSBO_BINDING_LIGHTS)
+    GLuint clusterCounts;       // number of lights in each cluster (SSBO_BINDING_CLUSTER_COUNTS)
+    GLuint clusterLights;       // CLUSTER_MAX_LIGHTS light indices per cluster (SSBO_BINDING_CLUSTER_LIGHTS)
+    GLsizei lightCapacity;      // records the light buffer can hold
+    GLsizei lightCount;         // records uploaded this frame
+};
+
+bool UCreateClusteredLights(GLClusteredLights& lights);
+GPULight UMakePointLight(const glm::vec3& position, const glm::vec3& color, float range);
+GPULight UMakeSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color,
+    float cutOff, float outerCutOff, float range);
+void UUploadLights(GLClusteredLights& lights, const GPULight* records, GLsizei count);
+void UBinLights(GLClusteredLights& lights, const glm::mat4& view, const glm::mat4& projection,
+    float nearPlane, float farPlane);
+void UDestroyClusteredLights(GLClusteredLights& lights);
\ No newline at end of file
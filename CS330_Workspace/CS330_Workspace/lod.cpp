@@ -0,0 +1,122 @@
+#include "lod.h"
+#include <glm/gtc/constants.hpp>
+using namespace std;
+
+// unnamed namespace to hold the level selection helper
+namespace
+{
+    /**
+     * @brief Returns the on-screen length of one level's edges around the circumference.
+     */
+    float edgePixels(const MeshLod& lod, int level, float diameter)
+    {
+        return glm::pi<float>() * diameter / (float)lod.segments[level];
+    }
+}
+
+
+/**
+ * @brief Copies one level's geometry into the arena and appends it to the chain.
+ *
+ * Levels must be added finest first. Meshes without a tessellation (cubes,
+ * planes) get a single level, with segments 0.
+ *
+ * @param arena The GLGeometryArena structure to allocate from.
+ * @param data The MeshData structure holding the level's geometry.
+ * @param segments The level's tessellation.
+ * @param lod The MeshLod structure to append to.
+ * @return True if the level fit in the arena and the chain, otherwise false.
+ */
+bool UAddMeshLodLevel(GLGeometryArena& arena, const MeshData& data, unsigned int segments, MeshLod& lod)
+{
+    if (lod.levelCount >= LOD_MAX_LEVELS)
+        return false;
+
+    if (!UArenaAddMesh(arena, data, lod.levels[lod.levelCount]))
+        return false;
+
+    lod.segments[lod.levelCount] = segments;
+    lod.arena = &arena;
+    ++lod.levelCount;
+    return true;
+}
+
+/**
+ * @brief Copies one level already in the arena's vertex format and appends it to the chain.
+ *
+ * Used for levels read from a mesh cache; see UAddMeshLodLevel.
+ *
+ * @param arena The GLGeometryArena structure to allocate from.
+ * @param view The EncodedMeshView structure describing the level's geometry.
+ * @param segments The level's tessellation.
+ * @param lod The MeshLod structure to append to.
+ * @return True if the level fit in the arena and the chain, otherwise false.
+ */
+bool UAddEncodedMeshLodLevel(GLGeometryArena& arena, const EncodedMeshView& view, unsigned int segments, MeshLod& lod)
+{
+    if (lod.levelCount >= LOD_MAX_LEVELS)
+        return false;
+
+    if (!UArenaAddEncodedMesh(arena, view, lod.levels[lod.levelCount]))
+        return false;
+
+    lod.segments[lod.levelCount] = segments;
+    lod.arena = &arena;
+    ++lod.levelCount;
+    return true;
+}
+
+/**
+ * @brief Estimates the on-screen diameter of a bounding sphere, in pixels.
+ *
+ * The sphere's radius is scaled by the projection's vertical scale and divided
+ * by the clip-space w of its center, which is the view depth for perspective
+ * projections and 1 for orthographic ones, so both are handled the same way.
+ *
+ * @param viewProjection The projection * view matrix.
+ * @param projectionScale The projection matrix's [1][1] element.
+ * @param viewportHeight The viewport height in pixels.
+ * @param center The sphere's world-space center.
+ * @param radius The sphere's world-space radius.
+ * @return The projected diameter, in pixels.
+ */
+float UProjectedDiameter(const glm::mat4& viewProjection, float projectionScale, float viewportHeight,
+    const glm::vec3& center, float radius)
+{
+    float w = (viewProjection * glm::vec4(center, 1.0f)).w;
+
+    // A sphere around the camera plane covers the screen
+    if (w <= radius)
+        return viewportHeight;
+
+    return radius * projectionScale / w * viewportHeight;
+}
+
+/**
+ * @brief Picks the level of detail to draw a mesh with, with hysteresis.
+ *
+ * The coarsest level whose edges span at most LOD_EDGE_PIXELS on screen is
+ * wanted. The current level is only left when its edges grow more than
+ * LOD_HYSTERESIS past that length, or when the next coarser level's edges are
+ * that much shorter, so objects hovering near a threshold do not flicker
+ * between levels.
+ *
+ * @param lod The MeshLod structure.
+ * @param diameter The object's projected diameter from UProjectedDiameter.
+ * @param currentLevel The level drawn last frame.
+ * @return The level to draw this frame.
+ */
+int USelectLodLevel(const MeshLod& lod, float diameter, int currentLevel)
+{
+    int level = glm::clamp(currentLevel, 0, lod.levelCount - 1);
+
+    // Refine while this level's edges are clearly too long
+    while (level > 0 && edgePixels(lod, level, diameter) > LOD_EDGE_PIXELS * (1.0f + LOD_HYSTERESIS))
+        --level;
+
+    // Coarsen while the next level's edges are clearly short enough
+    while (level + 1 < lod.levelCount && edgePixels(lod, level + 1, diameter) < LOD_EDGE_PIXELS * (1.0f - LOD_HYSTERESIS))
+        ++level;
+
+    return level;
+}
\ No newline at end of file
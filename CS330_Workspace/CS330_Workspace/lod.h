@@ -0,0 +1,32 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "arena.h"
+#include "mesh.h"
+
+// Most levels a mesh can have
+const int LOD_MAX_LEVELS = 6;
+
+// Tessellation of each level of a sphere or cylinder chain, finest first
+const unsigned int LOD_SEGMENTS[LOD_MAX_LEVELS] = { 128, 64, 32, 16, 8, 4 };
+
+// Longest a level's edges may get on screen, in pixels, before a finer level is used
+const float LOD_EDGE_PIXELS = 6.0f;
+
+// Fraction the edge length must pass LOD_EDGE_PIXELS by before the level changes
+const float LOD_HYSTERESIS = 0.2f;
+
+// Struct to hold the levels of detail of one mesh in the geometry arena
+struct MeshLod {
+    GLMesh levels[LOD_MAX_LEVELS];          // finest first
+    unsigned int segments[LOD_MAX_LEVELS];  // segments around the circumference of each level
+    int levelCount;                         // 1 for meshes with a single tessellation
+    GLGeometryArena* arena;                 // arena every level was allocated from
+};
+
+bool UAddMeshLodLevel(GLGeometryArena& arena, const MeshData& data, unsigned int segments, MeshLod& lod);
+bool UAddEncodedMeshLodLevel(GLGeometryArena& arena, const EncodedMeshView& view, unsigned int segments, MeshLod& lod);
+float UProjectedDiameter(const glm::mat4& viewProjection, float projectionScale, float viewportHeight,
+    const glm::vec3& center, float radius);
+int USelectLodLevel(const MeshLod& lod, float diameter, int currentLevel);
\ No newline at end of file
@@ -1,6 +1,12 @@
 // main inclusions
 #include <iostream>         // for input/output
 #include <cstdlib>          // for exit failure and success macros
+#include <cstring>          // for command line option comparison
+#include <chrono>           // for benchmark frame timing
+#include <iomanip>          // for mesh statistics formatting
+#include <algorithm>        // for the largest mesh's vertex count
+#include <string>           // for mesh cache keys
+#include <limits>           // for the largest arena a GLsizei can describe
 #include <GL/glew.h>        // GLEW library
 #include <GLFW/glfw3.h>     // GLFW library
 
@@ -15,9 +21,30 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>      // used for funtions that can handle images
 
+#include "arena.h"
+#include "benchmark.h"
+#include "cpuprofiler.h"
+#include "culling.h"
+#include "framehash.h"
+#include "glstate.h"
+#include "gpuprofiler.h"
+#include "headless.h"
+#include "inputrecord.h"
+#include "lights.h"
+#include "lod.h"
 #include "mesh.h"
+#include "meshcache.h"
+#include "meshimport.h"
+#include "meshopt.h"
+#include "occlusion.h"
+#include "renderqueue.h"
+#include "renderstats.h"
+#include "ringbuffer.h"
+#include "scene.h"
+#include "scenegraph.h"
 #include "shader.h"
 #include "texture.h"
+#include "vertexformat.h"
 
 using namespace std; // using the standard namespace
 
@@ -37,19 +64,117 @@ namespace
 
     // declaration of main GLFW window handle
     GLFWwindow* gWindow = nullptr;
-    // declaration of GLMesh objects to hold VAO, VBOs
-    GLMesh gMeshCylinder;
-    GLMesh gMeshCube;
-    GLMesh gMeshSphere;
-    GLMesh gMeshPlane;
-    // declaration of the texture ID
-    GLuint gTexture1;
-    GLuint gTexture2;
-    GLuint gTexture3;
-    GLuint gTexture4;
-    GLuint gTexture5;
-    // declaration of the shader program ID
-    GLuint gProgramId;
+    // offscreen context and framebuffer used instead of the window in headless mode
+    GLHeadlessContext gHeadlessContext;
+    GLRenderTarget gRenderTarget;
+    // geometry arenas the scene meshes are allocated from: meshes whose vertices fit 16-bit
+    // indices go in gArena, larger ones in gWideArena (vao 0 unless some mesh needs it)
+    GLGeometryArena gArena;
+    GLGeometryArena gWideArena;
+    // levels of detail of each scene mesh, each level a range in the arena
+    vector<MeshLod> gMeshLods;
+    // declaration of the texture array holding every scene material, one layer each
+    GLuint gMaterialTextures;
+
+    // transform hierarchy holding every object's TRS and cached world matrix
+    SceneGraph gScene;
+
+    // Struct to hold a drawable object attached to a scene graph node
+    struct SceneObject
+    {
+        uint32_t node;          // node in gScene providing the world matrix
+        const MeshLod* lod;     // arena mesh to draw, at each level of detail
+        int lodLevel;           // level drawn last frame, kept for hysteresis
+        GLuint layer;           // material layer in gMaterialTextures
+        GLInstance instance;    // cached instance data, rebuilt only when the node moves or the level changes
+    };
+    vector<SceneObject> gSceneObjects;
+    // world-space bounds of gSceneObjects, by index, tested against the frustum each frame
+    CullingBounds gCullingBounds;
+
+    // declaration of the shader program and its uniform handles
+    GLProgram gProgram;
+
+    // uniform handles resolved once after linking so URender never looks names up
+    struct SceneUniforms
+    {
+        GLUniform texture;
+        GLUniform overdraw;
+        GLUniform octahedralNormals;
+    } gUniforms;
+
+    // position-only program writing depth ahead of the lit pass
+    GLProgram gDepthProgram;
+    bool gDepthPrepass = false;     // lay down depth first, then shade with GL_EQUAL (Z, --depth-prepass)
+    bool gOverdrawView = false;     // show how many times each pixel is shaded (O, --overdraw)
+    bool gDepthPrepassKeyHeld = false;
+    bool gOverdrawKeyHeld = false;
+
+    // CPU mirrors of the std140 uniform blocks declared in the shaders
+    struct FrameData
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;   // projection * view, multiplied once per frame on the CPU
+        glm::vec3 cameraPos;
+        float padding;
+    };
+
+    struct LightData
+    {
+        glm::vec3 ambientColor;
+        GLuint lightCount;
+        glm::uvec4 clusterGrid;     // CLUSTER_GRID_X, _Y, _Z, and CLUSTER_MAX_LIGHTS
+        glm::vec4 clusterDepth;     // near plane, far plane, CLUSTER_GRID_Z / log(far / near)
+        glm::vec2 tileSize;         // pixels covered by one cluster tile
+        glm::vec2 padding;
+    };
+
+    // ambient color taken from the scene file's first point light
+    LightData gLightData;
+
+    // every light of the scene file, then the --lights stress lights
+    vector<GPULight> gLights;
+    size_t gSceneLightCount = 0;            // lights taken from the scene file
+    vector<glm::vec3> gStressLightAnchors;  // point each stress light circles, by stress light
+    // light buffer and the per-cluster light lists binned from it each frame
+    GLClusteredLights gClusteredLights;
+
+    // framebuffer size the cluster tiles are laid over
+    int gViewportWidth = WINDOW_WIDTH;
+    int gViewportHeight = WINDOW_HEIGHT;
+
+    // triple-buffered, persistently mapped storage for the per-frame uniform blocks
+    GLRingBuffer gUniformRing;
+
+    // draws submitted each frame, sorted to minimize state changes
+    RenderQueue gRenderQueue;
+    // depth pyramid and GPU visibility tests run around the queue's draws
+    GLOcclusionCuller gOcclusionCuller;
+    bool gOcclusionCulling = true;  // cleared by --no-occlusion
+    unsigned int gFrameCount = 0; // frames rendered so far
+
+    // GPU timings of the render passes, read back a few frames late
+    GPUProfiler gGpuProfiler;
+    struct GPUPassScopes
+    {
+        int frame;
+        int clear;
+        int opaque;
+        int occlusion;
+        int depthPrepass;
+        int lightBinning;
+    } gGpuScopes;
+    float gOverlayTime = 0.0f; // time the window title overlay was last refreshed
+
+    // input recorded from or replayed into UProcessInput and the mouse callbacks
+    InputRecording gInputRecording;
+    bool gRecordingInput = false;
+    bool gReplayingInput = false;
+
+    // per-frame image hashes proving that two runs rendered the same frames
+    GLFrameHasher gFrameHasher;
+    bool gHashingFrames = false;
 
     // camera parameters  
     glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 4.0f);   // position vector for the camera
@@ -71,6 +196,32 @@ namespace
     float gLastFrame = 0.0f; // time of last frame
 
     float cameraSpeed = 2.5f; // initial camera movement speed
+
+    // Struct to hold the options given on the command line
+    struct AppOptions
+    {
+        const char* sceneFilename;          // text or binary scene to load
+        const char* compiledSceneFilename;  // if set, write the scene in binary form and exit
+        bool headless;                      // render offscreen and run the benchmark
+        int benchmarkFrames;                // frames recorded by the benchmark
+        const char* benchmarkOutput;        // benchmark JSON file (standard output if null)
+        const char* gpuProfileOutput;       // GPU scope statistics written at exit (.json or CSV)
+        const char* cpuTraceOutput;         // Chrome trace of the CPU zones written at exit
+        const char* recordInputOutput;      // input recording written at exit
+        const char* replayInput;            // input recording to replay with a fixed frame time
+        const char* frameHashOutput;        // per-frame image hashes written at exit
+        const char* statsLogOutput;         // render statistics log, one line per statsInterval frames
+        int statsInterval;                  // frames between render statistics log lines
+        bool occlusionCulling;              // cull occluded instances on the GPU
+        bool depthPrepass;                  // start with the depth pre-pass on
+        bool overdraw;                      // start with the overdraw view on
+        int stressLights;                   // small animated point lights added to the scene's
+        bool compactVertices;               // store meshes in the 16-byte compact vertex format
+        const char* meshCacheDirectory;     // built meshes are cached here (not cached if null)
+    };
+
+    // frames rendered before the benchmark starts recording
+    const int BENCHMARK_WARMUP_FRAMES = 10;
 }
 
 
@@ -79,35 +230,73 @@ namespace
  * redraw graphics on the window when resized,
  * and render graphics on the screen
  */
+bool UParseOptions(int argc, char* argv[], AppOptions& options);
 bool UInitialize(int, char* [], GLFWwindow** window);
+bool UInitializeHeadless();
+bool UInitializeGlew();
 void UResizeWindow(GLFWwindow* window, int width, int height);
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos);
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void UProcessInput(GLFWwindow* window);
+bool UKeyPressed(GLFWwindow* window, int key);
+bool UCreateScene(const SceneDescription& description, VertexFormatId vertexFormat, const char* meshCacheDirectory);
+void UAddStressLights(int count);
+void UAnimateStressLights();
 void URender();
+void UBenchmarkCamera(int frame, int frameCount);
+bool URunBenchmark(const AppOptions& options);
 
 
 // vertex shader source code
 const GLchar* vertexShaderSource = GLSL(440,
     layout(location = 0) in vec3 position; // vertex data
-    layout(location = 1) in vec3 normal; //normal data
+    layout(location = 1) in vec3 normal; //normal data (two octahedral components in the compact format)
     layout(location = 2) in vec2 textureCoordinate;  // texture coordinate data
+    layout(location = 3) in mat4 instanceModel; // per-instance model matrix (locations 3-6)
+    layout(location = 7) in mat3 instanceNormalMatrix; // per-instance normal matrix (locations 7-9)
+    layout(location = 10) in uint instanceLayer; // per-instance texture layer
+    layout(location = 11) in vec4 instanceTexCoordTransform; // scale (xy) and bias (zw) of the mesh's texture coordinates
 
     out vec2 vertexTextureCoordinate; // variable to transfer texture data to the fragment shader
+    flat out uint vertexLayer; // texture layer of the instance's material
     out vec3 FragPos;
     out vec3 Normal;
 
-    // variables for transform matrices
-    uniform mat4 model;
-    uniform mat4 view;
-    uniform mat4 projection;
+    // the depth pre-pass computes the same positions, so GL_EQUAL matches exactly
+    invariant gl_Position;
+
+    // decoding of the arena's vertex format (positions are decoded by the model matrix,
+    // texture coordinates by instanceTexCoordTransform)
+    uniform bool uOctahedralNormals;
+
+    // Unfolds a normal stored on an octahedron (see UEncodeOctahedral)
+    vec3 decodeOctahedral(vec2 e)
+    {
+        vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+        float t = max(-n.z, 0.0);
+        n.x += n.x >= 0.0 ? -t : t;
+        n.y += n.y >= 0.0 ? -t : t;
+        return normalize(n);
+    }
+
+    // per-frame camera data shared by every program (UBO_BINDING_FRAME)
+    layout(std140, binding = 0) uniform FrameData
+    {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+        vec3 u_CameraPos;
+    };
 
     void main()
     {
-        gl_Position = projection * view * model * vec4(position, 1.0f); // transforms vertices to clip coordinates
-        vertexTextureCoordinate = textureCoordinate; // passes incoming texture data
-        FragPos = vec3(model * vec4(position, 1.0f)); // transformed fragment position
-        Normal = mat3(transpose(inverse(model))) * normal; // transformed normal
+        vec4 worldPosition = instanceModel * vec4(position, 1.0f);
+        gl_Position = viewProjection * worldPosition; // transforms vertices to clip coordinates
+        vertexTextureCoordinate = textureCoordinate * instanceTexCoordTransform.xy + instanceTexCoordTransform.zw; // passes incoming texture data
+        vertexLayer = instanceLayer; // passes the material layer
+        FragPos = vec3(worldPosition); // transformed fragment position
+        vec3 objectNormal = uOctahedralNormals ? decodeOctahedral(normal.xy) : normal;
+        Normal = instanceNormalMatrix * objectNormal; // transformed normal (matrix precomputed per instance)
     }
 );
 
@@ -115,69 +304,138 @@ const GLchar* vertexShaderSource = GLSL(440,
 // fragment shader source code
 const GLchar* fragmentShaderSource = GLSL(440,
     in vec2 vertexTextureCoordinate; // holds incoming texture data from vertex shader
+    flat in uint vertexLayer; // material layer from vertex shader
     in vec3 FragPos;
     in vec3 Normal;
 
     out vec4 fragmentColor; // output color
 
-    uniform sampler2D uTexture; // sampler for texture
-
-    // light uniforms for main and secondary lights
-    uniform vec3 u_LightPos;    // position of light
-    uniform vec3 u_LightColor;  // color of light
+    uniform sampler2DArray uTexture; // sampler for the material texture array
+    uniform bool uOverdraw; // add one step of the overdraw ramp instead of lighting
 
-    uniform vec3 u_SpotLightPos;
-    uniform vec3 u_SpotLightDirection;
-    uniform float u_SpotLightCutOff;
-    uniform float u_SpotLightOuterCutOff;
-    uniform vec3 u_SpotLightColor;
+    // per-frame camera data shared by every program (UBO_BINDING_FRAME)
+    layout(std140, binding = 0) uniform FrameData
+    {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+        vec3 u_CameraPos;   // position of camera for reflection
+    };
+
+    // ambient color and cluster grid (UBO_BINDING_LIGHTS)
+    layout(std140, binding = 1) uniform LightData
+    {
+        vec3 u_AmbientColor;
+        uint u_LightCount;
+        uvec4 u_ClusterGrid;    // tiles across, tiles down, depth slices, lights per cluster
+        vec4 u_ClusterDepth;    // near plane, far plane, slices / log(far / near)
+        vec2 u_TileSize;        // pixels per tile
+    };
+
+    struct Light
+    {
+        vec4 positionRange;     // position, distance the light reaches
+        vec4 colorType;         // color, 0 for a point light or 1 for a spotlight
+        vec4 directionCutOff;   // spotlight direction, cosine of the inner cone
+        vec4 outerCutOff;       // cosine of the outer cone
+    };
 
-    uniform vec3 u_CameraPos;   // position of camera for reflection
+    // every light, and the lights binned into each cluster (SSBO_BINDING_LIGHTS and after)
+    layout(std430, binding = 4) readonly buffer Lights { Light lights[]; };
+    layout(std430, binding = 5) readonly buffer ClusterCounts { uint clusterCounts[]; };
+    layout(std430, binding = 6) readonly buffer ClusterLights { uint clusterLights[]; };
 
     void main()
     {
-        // diffuse calculations
-        float diffuseStrength = 0.6f; // intensity modifier
-        vec3 norm = normalize(Normal);
-        vec3 toLight = normalize(u_LightPos - FragPos);
-        float diffuse = max(dot(norm, toLight), 0.0);
-        vec3 light = diffuseStrength * u_LightColor * diffuse;
-
-        // ambient calculations
-        float ambientStrength = 0.25f; // Set ambient or global lighting strength
-        vec3 ambient = ambientStrength * u_LightColor; // Generate ambient light color
+        // Additive blending sums one step per shaded fragment: red, then orange, then white
+        if (uOverdraw)
+        {
+            fragmentColor = vec4(0.25, 0.0625, 0.015625, 1.0);
+            return;
+        }
+
+        // find the cluster holding this fragment: its screen tile and exponential depth slice
+        float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+        uvec2 tile = min(uvec2(gl_FragCoord.xy / u_TileSize), u_ClusterGrid.xy - 1u);
+        float slice = log(max(viewDepth, u_ClusterDepth.x) / u_ClusterDepth.x) * u_ClusterDepth.z;
+        uint cluster = (min(uint(slice), u_ClusterGrid.z - 1u) * u_ClusterGrid.y + tile.y) * u_ClusterGrid.x + tile.x;
 
-
-        // Calculate the reflection direction for main light
+        float diffuseStrength = 0.6f; // intensity modifier
         float specIntensity = 0.3f; // intensity modifier
         float highlightSize = 8.0f;
+        vec3 norm = normalize(Normal);
         vec3 viewDir = normalize(u_CameraPos - FragPos);
-        vec3 reflectDir = reflect(-toLight, norm);
 
-        float specComp = pow(max(dot(viewDir, reflectDir), 0.0), highlightSize);
-        vec3 specular = u_LightColor * specComp * specIntensity;
+        // ambient light, from the main light's color
+        vec3 result = u_AmbientColor;
+
+        // only the lights whose range reaches this cluster
+        uint count = clusterCounts[cluster];
+        for (uint i = 0u; i < count; ++i)
+        {
+            Light light = lights[clusterLights[cluster * u_ClusterGrid.w + i]];
+            vec3 lightPos = light.positionRange.xyz;
+            vec3 lightColor = light.colorType.rgb;
+
+            vec3 toLight = normalize(lightPos - FragPos);
+            float diffuse = max(dot(norm, toLight), 0.0);
+            vec3 reflectDir = reflect(-toLight, norm);
+            float specComp = pow(max(dot(viewDir, reflectDir), 0.0), highlightSize);
+
+            // fade to zero at the light's range so the clusters it was left out of see no seam
+            float distanceRatio = length(lightPos - FragPos) / light.positionRange.w;
+            float window = clamp(1.0 - distanceRatio * distanceRatio * distanceRatio * distanceRatio, 0.0, 1.0);
+            window *= window;
+
+            if (light.colorType.w < 0.5)
+            {
+                // point light: diffuse and specular
+                result += (diffuseStrength * diffuse + specComp * specIntensity) * lightColor * window;
+            }
+            else
+            {
+                // spotlight: diffuse and specular scaled by the cone falloff
+                float theta = dot(-toLight, normalize(-light.directionCutOff.xyz));
+                float epsilon = light.directionCutOff.w - light.outerCutOff.x;
+                float intensity = clamp((theta - light.outerCutOff.x) / epsilon, 0.0, 0.8);
+                result += (diffuse + specComp * specIntensity) * intensity * lightColor * window;
+            }
+        }
 
-        float spotSpecIntensity = 0.5f; // intensity modifier
-        vec3 lightToFragment = normalize(FragPos - u_SpotLightPos);
-        float theta = dot(lightToFragment, normalize(-u_SpotLightDirection));
+        // combine results 
+        vec3 texColor = texture(uTexture, vec3(vertexTextureCoordinate, float(vertexLayer))).rgb; // texture color
+        fragmentColor = vec4(result * texColor, 1.0);
+    }
+);
 
-        float epsilon = u_SpotLightCutOff - u_SpotLightOuterCutOff;
-        float intensity = clamp((theta - u_SpotLightOuterCutOff) / epsilon, 0.0, 0.8);
 
-        vec3 toSpotlight = normalize(u_SpotLightPos - FragPos);
-        float spotlightDiffuseValue = max(dot(norm, toSpotlight), 0.0);
-        vec3 reflectDirSpotlight = reflect(-toSpotlight, norm);
-        float specCompSpotlight = pow(max(dot(viewDir, reflectDirSpotlight), 0.0), highlightSize);
+// depth pre-pass vertex shader: positions and model matrices only
+const GLchar* depthVertexShaderSource = GLSL(440,
+    layout(location = 0) in vec3 position;
+    layout(location = 3) in mat4 instanceModel;
 
-        vec3 spotlightDiffuse = u_SpotLightColor * spotlightDiffuseValue * intensity;
-        vec3 spotlightSpecular = u_SpotLightColor * specCompSpotlight * specIntensity * intensity;
+    invariant gl_Position;
 
+    layout(std140, binding = 0) uniform FrameData
+    {
+        mat4 view;
+        mat4 projection;
+        mat4 viewProjection;
+        vec3 u_CameraPos;
+    };
+
+    void main()
+    {
+        vec4 worldPosition = instanceModel * vec4(position, 1.0f);
+        gl_Position = viewProjection * worldPosition;
+    }
+);
 
-        // combine results 
-        vec3 texColor = texture(uTexture, vertexTextureCoordinate).rgb; // texture color
-        vec3 finalColor = (ambient + light + specular + spotlightDiffuse + spotlightSpecular) * texColor;
 
-        fragmentColor = vec4(finalColor, 1.0);
+// depth pre-pass fragment shader: depth is written by fixed function
+const GLchar* depthFragmentShaderSource = GLSL(440,
+    void main()
+    {
     }
 );
 
@@ -185,117 +443,333 @@ const GLchar* fragmentShaderSource = GLSL(440,
 // Entry Point
 int main(int argc, char* argv[])
 {
-    // Initialize the application and create a window
-    if (!UInitialize(argc, argv, &gWindow))
-        return EXIT_FAILURE; // terminates program if initialization fails
+    AppOptions options;
+    if (!UParseOptions(argc, argv, options))
+        return EXIT_FAILURE; // terminates program if the command line is invalid
 
-    // Create meshes for the scene
-    UCreateCylinder(gMeshCylinder);
-    UCreateCube(gMeshCube);
-    UCreateSphere(gMeshSphere);
-    UCreatePlane(gMeshPlane);
+    // Record CPU zones from the start so loading shows up in the trace
+    if (options.cpuTraceOutput)
+        UEnableCPUProfiler(true);
 
-    // Creates shader program
-    if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgramId))
-        return EXIT_FAILURE; // terminates program if shader program fails
+    // Open the render statistics log before any frame reports into it
+    if (options.statsLogOutput && !UOpenRenderStatsLog(options.statsLogOutput, options.statsInterval))
+        return EXIT_FAILURE; // terminates program if the log cannot be written
 
-    // Load texture (relative to project's directory)
-    const char* texFilename = "textures/metal.jpg";
-    if (!UCreateTexture(texFilename, gTexture1))
+    // Load the input to replay before anything is rendered
+    if (options.replayInput)
     {
-        cout << "Failed to load texture " << texFilename << endl;
-        return EXIT_FAILURE;
+        if (!ULoadInputRecording(options.replayInput, gInputRecording))
+            return EXIT_FAILURE; // terminates program if the recording cannot be read
+        gReplayingInput = true;
     }
-    // Tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-    glUseProgram(gProgramId);
-    // We set the texture as texture unit 0
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
 
-    // Load texture (relative to project's directory)
-    texFilename = "textures/leather.jpg";
-    if (!UCreateTexture(texFilename, gTexture2))
-    {
-        cout << "Failed to load texture " << texFilename << endl;
-        return EXIT_FAILURE;
-    }
-    // Tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-    glUseProgram(gProgramId);
-    // We set the texture as texture unit 1
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 1);
+    // Load the scene description (text or binary, see scene.h)
+    SceneDescription sceneDescription;
+    if (!ULoadScene(options.sceneFilename, sceneDescription))
+        return EXIT_FAILURE; // terminates program if the scene cannot be loaded
 
-    // Load texture (relative to project's directory)
-    texFilename = "textures/paper.jpg";
-    if (!UCreateTexture(texFilename, gTexture3))
+    // Convert the scene to the binary form without opening a window
+    if (options.compiledSceneFilename)
     {
-        cout << "Failed to load texture " << texFilename << endl;
-        return EXIT_FAILURE;
+        bool saved = USaveSceneBinary(sceneDescription, options.compiledSceneFilename);
+        UDestroyScene(sceneDescription);
+        return saved ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-    // Tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-    glUseProgram(gProgramId);
-    // We set the texture as texture unit 2
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
 
-    // Load texture (relative to project's directory)
-    texFilename = "textures/peel.jpg";
-    if (!UCreateTexture(texFilename, gTexture4))
+    // Initialize the application and create a window, or an offscreen context in headless mode
+    if (options.headless ? !UInitializeHeadless() : !UInitialize(argc, argv, &gWindow))
+        return EXIT_FAILURE; // terminates program if initialization fails
+
+    // Build the geometry arena, meshes, scene graph, and lights described by the scene
+    if (!UCreateScene(sceneDescription, options.compactVertices ? VERTEX_FORMAT_COMPACT : VERTEX_FORMAT_STANDARD,
+        options.meshCacheDirectory))
+        return EXIT_FAILURE; // terminates program if the arena cannot be allocated or the scene does not fit
+
+    // Creates shader program
+    if (!UCreateShaderProgram(vertexShaderSource, fragmentShaderSource, gProgram))
+        return EXIT_FAILURE; // terminates program if shader program fails
+
+    // Resolve every uniform the renderer uses once, right after linking
+    gUniforms.texture = UGetUniform(gProgram, "uTexture");
+    gUniforms.overdraw = UGetUniform(gProgram, "uOverdraw");
+    gUniforms.octahedralNormals = UGetUniform(gProgram, "uOctahedralNormals");
+
+    // Creates the position-only program of the depth pre-pass
+    if (!UCreateShaderProgram(depthVertexShaderSource, depthFragmentShaderSource, gDepthProgram))
+        return EXIT_FAILURE; // terminates program if shader program fails
+    gDepthPrepass = options.depthPrepass;
+    gOverdrawView = options.overdraw;
+
+    // Creates the depth pyramid and culling shaders; the queue then keeps one command per instance
+    gOcclusionCulling = options.occlusionCulling;
+    if (gOcclusionCulling && !UCreateOcclusionCuller(gOcclusionCuller))
+        return EXIT_FAILURE; // terminates program if the culling shaders fail
+    gRenderQueue.perInstanceCommands = gOcclusionCulling;
+
+    // Creates the GPU timer queries and names the render passes
+    if (!UCreateGPUProfiler(gGpuProfiler))
+        return EXIT_FAILURE; // terminates program if GPU timestamps are unavailable
+    gGpuScopes.frame = UGPUScopeId(gGpuProfiler, "frame");
+    gGpuScopes.clear = UGPUScopeId(gGpuProfiler, "clear");
+    gGpuScopes.opaque = UGPUScopeId(gGpuProfiler, "opaque");
+    gGpuScopes.occlusion = UGPUScopeId(gGpuProfiler, "occlusion");
+    gGpuScopes.depthPrepass = UGPUScopeId(gGpuProfiler, "depth prepass");
+    gGpuScopes.lightBinning = UGPUScopeId(gGpuProfiler, "light binning");
+
+    // Creates the light binning shader and cluster lists, and adds the stress lights
+    if (!UCreateClusteredLights(gClusteredLights))
+        return EXIT_FAILURE; // terminates program if the binning shader fails
+    UAddStressLights(options.stressLights);
+
+    // Creates the ring buffer backing the FrameData and LightData blocks
+    if (!UCreateRingBuffer(2 * 256 + sizeof(FrameData) + sizeof(LightData), gUniformRing))
+        return EXIT_FAILURE; // terminates program if the uniform ring cannot be mapped
+
+    // Load every material into one texture array (relative to project's directory),
+    // one layer per material in scene order
+    vector<const char*> texFilenames;
+    for (uint32_t i = 0; i < sceneDescription.materialCount; ++i)
+        texFilenames.push_back(sceneDescription.materials[i].texture);
+    if (texFilenames.empty() ||
+        !UCreateTextureArray(texFilenames.data(), (int)texFilenames.size(), gMaterialTextures))
+        return EXIT_FAILURE; // terminates program if a material texture fails to load
+
+    // Everything needed from the description has been copied out
+    UDestroyScene(sceneDescription);
+
+    // Tell opengl which texture unit the sampler reads (only has to be done once);
+    // the render queue binds the material texture array to unit 0
+    UStateUseProgram(gProgram.id);
+    USetUniform(gUniforms.texture, 0);
+
+    // Tell the vertex shader how the arena's vertex format stores normals
+    USetUniform(gUniforms.octahedralNormals, gArena.format->octahedralNormals ? 1 : 0);
+
+    // sets the color to be used when clearing color buffers to black
+    UStateClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // Creates the pixel buffers that rendered frames are hashed from
+    if (options.frameHashOutput)
     {
-        cout << "Failed to load texture " << texFilename << endl;
-        return EXIT_FAILURE;
+        if (!UCreateFrameHasher(gViewportWidth, gViewportHeight, gFrameHasher))
+            return EXIT_FAILURE; // terminates program if the readback buffers cannot be allocated
+        gHashingFrames = true;
     }
-    // Tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-    glUseProgram(gProgramId);
-    // We set the texture as texture unit 3
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 3);
 
-    // Load texture (relative to project's directory)
-    texFilename = "textures/plastic.jpg";
-    if (!UCreateTexture(texFilename, gTexture5))
+    // Start recording input from the first frame
+    if (options.recordInputOutput)
     {
-        cout << "Failed to load texture " << texFilename << endl;
-        return EXIT_FAILURE;
+        UBeginInputRecording(gInputRecording, glfwGetTime());
+        gRecordingInput = true;
     }
-    // Tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-    glUseProgram(gProgramId);
-    // We set the texture as texture unit 4
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
 
-    // sets the color to be used when clearing color buffers to black
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    // Headless mode renders the benchmark instead of the interactive loop
+    bool benchmarkPassed = !options.headless || URunBenchmark(options);
 
     // Main render loop
-    while (!glfwWindowShouldClose(gWindow))
+    while (!options.headless && !glfwWindowShouldClose(gWindow))
     {
+        CPU_ZONE("frame");
+
         // per-frame timing logic
         float currentFrame = glfwGetTime();      // get current time
         gDeltaTime = currentFrame - gLastFrame;  // compute change in time
         gLastFrame = currentFrame;               // update last frame time
 
+        // A replay feeds the recorded input with a fixed frame time and ends with the recording
+        if (gReplayingInput)
+        {
+            if (!UReplayInputFrame(gInputRecording, nullptr, UMousePositionCallback, UMouseScrollCallback))
+                break;
+            gDeltaTime = INPUT_REPLAY_DELTA_TIME;
+        }
+        else if (gRecordingInput)
+            URecordInputFrame(gInputRecording, gWindow, currentFrame);
+
         // Handle input
         UProcessInput(gWindow);
 
         // Render the current frame
         URender();
 
-        // Handle events
-        glfwPollEvents();
+        if (gHashingFrames)
+            UCaptureFrame(gFrameHasher);
+
+        // Show the rolling GPU pass timings and last frame's render statistics in the window title twice a second
+        if (currentFrame - gOverlayTime >= 0.5f)
+        {
+            gOverlayTime = currentFrame;
+            string title = string(WINDOW_TITLE) + " - " + UFormatGPUProfile(gGpuProfiler) + " - " +
+                UFormatRenderStats(URenderStatsLastFrame());
+            glfwSetWindowTitle(gWindow, title.c_str());
+        }
+
+        // Swap buffers and poll for IO events
+        {
+            CPU_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(gWindow);
+        }
+        {
+            CPU_ZONE("glfwPollEvents");
+            glfwPollEvents();
+        }
+    }
+
+    // Write the input recording and the frame hashes if they were requested
+    if (gRecordingInput)
+        USaveInputRecording(gInputRecording, options.recordInputOutput);
+    if (gHashingFrames)
+    {
+        UFinishFrameHasher(gFrameHasher);
+        cout << "INFO: Frame hash: " << hex << UCombinedFrameHash(gFrameHasher) << dec
+            << " over " << gFrameHasher.hashes.size() << " frames" << endl;
+        UWriteFrameHashes(gFrameHasher, options.frameHashOutput);
+        UDestroyFrameHasher(gFrameHasher);
+    }
+
+    // Flush the render statistics log
+    UCloseRenderStatsLog();
+
+    // Write the GPU pass statistics and the CPU trace if they were requested
+    if (options.gpuProfileOutput)
+        UWriteGPUProfile(gGpuProfiler, options.gpuProfileOutput);
+    if (options.cpuTraceOutput)
+    {
+        UWriteChromeTrace(options.cpuTraceOutput);
+        UShutdownCPUProfiler();
     }
 
     // Cleanup resources
-    UDestroyMesh(gMeshCylinder); // destroy cylinder mesh data
-    UDestroyMesh(gMeshCube); // destroy cube mesh data
-    UDestroyMesh(gMeshSphere); // destroy sphere mesh data
-    UDestroyMesh(gMeshPlane); // destroy plane mesh data
-    UDestroyTexture(gTexture1);
-    UDestroyTexture(gTexture2);
-    UDestroyTexture(gTexture3);
-    UDestroyTexture(gTexture4);
-    UDestroyTexture(gTexture5);
-    UDestroyShaderProgram(gProgramId); // destroy shader program
+    UDestroyGeometryArena(gArena); // destroy the arenas holding every mesh
+    if (gWideArena.vao)
+        UDestroyGeometryArena(gWideArena);
+    UDestroyTexture(gMaterialTextures);
+    UDestroyRingBuffer(gUniformRing); // destroy per-frame uniform storage
+    UDestroyGPUProfiler(gGpuProfiler); // destroy GPU timer queries
+    UDestroyShaderProgram(gProgram); // destroy shader program
+    UDestroyShaderProgram(gDepthProgram);
+    UDestroyClusteredLights(gClusteredLights); // destroy light buffers and binning shader
+    if (gOcclusionCulling)
+        UDestroyOcclusionCuller(gOcclusionCuller); // destroy depth pyramid and culling shaders
+
+    if (options.headless)
+    {
+        UDestroyRenderTarget(gRenderTarget);
+        UDestroyHeadlessContext(gHeadlessContext);
+    }
+
+    if (!benchmarkPassed)
+        exit(EXIT_FAILURE); // terminates the program if the benchmark report could not be written
 
     exit(EXIT_SUCCESS); // terminates the program successfully
 }
 
 
+/**
+ * @brief Reads the command line options.
+ *
+ * Supported options:
+ *   --scene <file>             scene to load (default scenes/desk.scene)
+ *   --compile-scene <file>     write the loaded scene in binary form and exit
+ *   --headless                 render offscreen (EGL) and run the benchmark
+ *   --frames <n>               frames recorded by the benchmark (default 500)
+ *   --benchmark-output <file>  write the benchmark JSON to a file instead of standard output
+ *   --gpu-profile <file>       write per-pass GPU timings at exit (JSON if .json, else CSV)
+ *   --cpu-trace <file>         record CPU zones and write a Chrome trace at exit
+ *   --record-input <file>      record keyboard and mouse input and write it at exit
+ *   --replay-input <file>      replay recorded input with a fixed frame time, then exit
+ *   --frame-hashes <file>      hash every rendered frame and write the hashes at exit
+ *   --stats-log <file>         log the render statistics every --stats-interval frames
+ *   --stats-interval <n>       frames between render statistics log lines (default 60)
+ *   --no-occlusion             draw every instance in the frustum, without GPU occlusion culling
+ *   --depth-prepass            start with the depth pre-pass on (toggled with Z)
+ *   --overdraw                 start with the overdraw view on (toggled with O)
+ *   --lights <n>               add n small animated point lights to the scene's
+ *   --compact-vertices         store meshes in the 16-byte compact vertex format
+ *   --mesh-cache <dir>         read and write built meshes in dir (default meshcache)
+ *   --no-mesh-cache            build every mesh from scratch and write no cache
+ *
+ * @return True if every option was recognized, otherwise false.
+ */
+bool UParseOptions(int argc, char* argv[], AppOptions& options)
+{
+    options.sceneFilename = "scenes/desk.scene";
+    options.compiledSceneFilename = nullptr;
+    options.headless = false;
+    options.benchmarkFrames = 500;
+    options.benchmarkOutput = nullptr;
+    options.gpuProfileOutput = nullptr;
+    options.cpuTraceOutput = nullptr;
+    options.recordInputOutput = nullptr;
+    options.replayInput = nullptr;
+    options.frameHashOutput = nullptr;
+    options.statsLogOutput = nullptr;
+    options.statsInterval = 60;
+    options.occlusionCulling = true;
+    options.depthPrepass = false;
+    options.overdraw = false;
+    options.stressLights = 0;
+    options.compactVertices = false;
+    options.meshCacheDirectory = "meshcache";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            options.sceneFilename = argv[++i];
+        else if (strcmp(argv[i], "--compile-scene") == 0 && i + 1 < argc)
+            options.compiledSceneFilename = argv[++i];
+        else if (strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            options.benchmarkFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--benchmark-output") == 0 && i + 1 < argc)
+            options.benchmarkOutput = argv[++i];
+        else if (strcmp(argv[i], "--gpu-profile") == 0 && i + 1 < argc)
+            options.gpuProfileOutput = argv[++i];
+        else if (strcmp(argv[i], "--cpu-trace") == 0 && i + 1 < argc)
+            options.cpuTraceOutput = argv[++i];
+        else if (strcmp(argv[i], "--record-input") == 0 && i + 1 < argc)
+            options.recordInputOutput = argv[++i];
+        else if (strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc)
+            options.replayInput = argv[++i];
+        else if (strcmp(argv[i], "--frame-hashes") == 0 && i + 1 < argc)
+            options.frameHashOutput = argv[++i];
+        else if (strcmp(argv[i], "--stats-log") == 0 && i + 1 < argc)
+            options.statsLogOutput = argv[++i];
+        else if (strcmp(argv[i], "--stats-interval") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            options.statsInterval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-occlusion") == 0)
+            options.occlusionCulling = false;
+        else if (strcmp(argv[i], "--depth-prepass") == 0)
+            options.depthPrepass = true;
+        else if (strcmp(argv[i], "--overdraw") == 0)
+            options.overdraw = true;
+        else if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0)
+            options.stressLights = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--compact-vertices") == 0)
+            options.compactVertices = true;
+        else if (strcmp(argv[i], "--mesh-cache") == 0 && i + 1 < argc)
+            options.meshCacheDirectory = argv[++i];
+        else if (strcmp(argv[i], "--no-mesh-cache") == 0)
+            options.meshCacheDirectory = nullptr;
+        else
+        {
+            cout << "ERROR::OPTIONS::UNKNOWN_OPTION " << argv[i] << endl;
+            return false;
+        }
+    }
+
+    // Recording needs a window; a replay cannot also be recorded
+    if (options.recordInputOutput && (options.headless || options.replayInput))
+    {
+        cout << "ERROR::OPTIONS::RECORD_NEEDS_INTERACTIVE_RUN" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
 /**
  * @brief Initializes GLFW, GLEW, and creates a window.
  *
@@ -338,10 +812,45 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
     // Tell GLFW to capture mouse input and disable cursor
     glfwSetInputMode(*window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+    // The framebuffer can be larger than the window on high-DPI displays
+    glfwGetFramebufferSize(*window, &gViewportWidth, &gViewportHeight);
+
+    return UInitializeGlew();
+}
+
+
+/**
+ * @brief Creates an offscreen context and framebuffer for headless rendering.
+ *
+ * This function creates an EGL context (see headless.cpp), initializes GLEW,
+ * and binds a window-sized framebuffer object that URender draws into.
+ */
+bool UInitializeHeadless()
+{
+    if (!UCreateHeadlessContext(gHeadlessContext) || !UInitializeGlew())
+        return false;
+
+    return UCreateRenderTarget(WINDOW_WIDTH, WINDOW_HEIGHT, gRenderTarget);
+}
+
+
+/**
+ * @brief Initializes GLEW for the current context.
+ *
+ * This function loads the OpenGL entry points and resets the state cache.
+ */
+bool UInitializeGlew()
+{
     // GLEW: initialization
     glewExperimental = GL_TRUE;
     GLenum GlewInitResult = glewInit();
 
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX reports this under EGL after loading the GL entry points
+    if (GlewInitResult == GLEW_ERROR_NO_GLX_DISPLAY && gHeadlessContext.context)
+        GlewInitResult = GLEW_OK;
+#endif
+
     if (GLEW_OK != GlewInitResult) // if initialization fails
     {
         cerr << glewGetErrorString(GlewInitResult) << endl;
@@ -351,6 +860,9 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
     // Displays OpenGL version
     cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << endl;
 
+    // Start the state cache from a clean slate for the new context
+    UStateInvalidate();
+
     return true;
 }
 
@@ -365,8 +877,10 @@ bool UInitialize(int argc, char* argv[], GLFWwindow** window)
  */
 void UProcessInput(GLFWwindow* window)
 {
+    CPU_ZONE("UProcessInput");
+
     // Closes the window if escape is pressed
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_ESCAPE) && window)
         glfwSetWindowShouldClose(window, true);
 
     // Offset movement to account for frame timing
@@ -382,35 +896,67 @@ void UProcessInput(GLFWwindow* window)
     * if 'Q' is pressed, move camera up
     * if 'E' is pressed, move camera down
     * if 'P' is pressed, toggle between views
+    * if 'Z' is pressed, toggle the depth pre-pass
+    * if 'O' is pressed, toggle the overdraw view
     */
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_W))
     {
         cameraPos += cameraOffset * cameraFront;
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_S))
     {
         cameraPos -= cameraOffset * cameraFront;
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_A))
     {
         cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraOffset;
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_D))
     {
         cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * cameraOffset;
     }
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_Q))
     {
         cameraPos += cameraOffset * cameraUp;
     }
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_E))
     {
         cameraPos -= cameraOffset * cameraUp;
     }
-    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
+    if (UKeyPressed(window, GLFW_KEY_P))
     {
         isOrthoView = !isOrthoView;  // toggle between ortho and perspective view
     }
+
+    // The pass toggles flip once per press rather than every frame the key is held
+    bool depthPrepassKey = UKeyPressed(window, GLFW_KEY_Z);
+    if (depthPrepassKey && !gDepthPrepassKeyHeld)
+        gDepthPrepass = !gDepthPrepass;
+    gDepthPrepassKeyHeld = depthPrepassKey;
+
+    bool overdrawKey = UKeyPressed(window, GLFW_KEY_O);
+    if (overdrawKey && !gOverdrawKeyHeld)
+        gOverdrawView = !gOverdrawView;
+    gOverdrawKeyHeld = overdrawKey;
+}
+
+
+/**
+ * @brief Returns whether a key is held in this frame.
+ *
+ * During a replay the key state comes from the recording; otherwise the
+ * window is polled.
+ *
+ * @param window A pointer to the GLFW window (null in headless mode).
+ * @param key The GLFW key to query.
+ * @return True if the key is pressed.
+ */
+bool UKeyPressed(GLFWwindow* window, int key)
+{
+    if (gReplayingInput)
+        return UInputKeyPressed(gInputRecording, key);
+
+    return window && glfwGetKey(window, key) == GLFW_PRESS;
 }
 
 
@@ -419,7 +965,7 @@ void UProcessInput(GLFWwindow* window)
  *
  * This function is registered as a callback with GLFW and is called whenever
  * the window is resized. It updates the viewport dimensions to match the new
- * window size.
+ * window size, and resizes the frame hash readbacks when frames are hashed.
  *
  * @param window A pointer to the GLFW window.
  * @param width The new width of the window.
@@ -429,6 +975,12 @@ void UResizeWindow(GLFWwindow* window, int width, int height)
 {
     // Set the viewport to cover the new window dimensions
     glViewport(0, 0, width, height);
+
+    // The light cluster tiles and the frame hashes follow the framebuffer
+    gViewportWidth = width;
+    gViewportHeight = height;
+    if (gHashingFrames)
+        UResizeFrameHasher(width, height, gFrameHasher);
 }
 
 
@@ -439,12 +991,20 @@ void UResizeWindow(GLFWwindow* window, int width, int height)
  * the mouse moves. It updates the camera direction based on the new mouse
  * position, allowing for interactive camera control.
  *
+ * During a replay, recorded events arrive with a null window and live ones
+ * from GLFW are ignored.
+ *
  * @param window A pointer to the GLFW window.
  * @param xpos The new x-coordinate of the mouse.
  * @param ypos The new y-coordinate of the mouse.
  */
 void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos)
 {
+    if (gReplayingInput && window)
+        return;
+    if (gRecordingInput)
+        URecordInputEvent(gInputRecording, INPUT_CURSOR, (float)xpos, (float)ypos, glfwGetTime());
+
     // If this is the first time the mouse moved (after the window opened)
     if (firstMouse)
     {
@@ -498,12 +1058,20 @@ void UMousePositionCallback(GLFWwindow* window, double xpos, double ypos)
  * the mouse scroll wheel is used. It adjusts the camera speed based on the
  * scroll input, ensuring the speed remains within defined bounds.
  *
+ * During a replay, recorded events arrive with a null window and live ones
+ * from GLFW are ignored.
+ *
  * @param window A pointer to the GLFW window.
  * @param xoffset The scroll offset along the x-axis.
  * @param yoffset The scroll offset along the y-axis.
  */
 void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    if (gReplayingInput && window)
+        return;
+    if (gRecordingInput)
+        URecordInputEvent(gInputRecording, INPUT_SCROLL, (float)xoffset, (float)yoffset, glfwGetTime());
+
     // Adjusts camera speed based of scroll input
     cameraSpeed += (float)yoffset;
 
@@ -515,155 +1083,599 @@ void UMouseScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 }
 
 
+/**
+ * @brief Builds the meshes, scene graph, and lights of a scene description.
+ *
+ * Every mesh is read from the mesh cache when it holds the mesh in this vertex
+ * format. Otherwise it is tessellated, or imported from its model file. It is
+ * then optimized with UOptimizeMesh, which welds identical vertices and prints
+ * the vertex counts and vertex cache statistics, and written to the cache for
+ * the next run.
+ *
+ * Meshes whose levels all fit 16-bit indices go in gArena, which stores
+ * 16-bit indices; the rest go in gWideArena, which stores 32-bit indices and is
+ * only created when some mesh needs it, so one large model does not widen the
+ * indices of every other mesh. Each arena is sized to fit its meshes and is
+ * drawn with its own multi-draw. Cached meshes are uploaded straight from
+ * their file mappings.
+ *
+ * Every instance becomes a scene graph node. Its world matrix is computed by
+ * the first UUpdateSceneGraph call and reused until the node's transform
+ * changes. Every light goes into gLights with a range of
+ * LIGHT_UNBOUNDED_RANGE. The first point light's color sets the ambient light.
+ *
+ * @param description The loaded scene description.
+ * @param vertexFormat The layout the arena stores every vertex in.
+ * @param meshCacheDirectory The mesh cache directory, or null to always build the meshes.
+ * @return True if every model was imported, the arena was created, and every mesh fit in it, otherwise false.
+ */
+bool UCreateScene(const SceneDescription& description, VertexFormatId vertexFormat, const char* meshCacheDirectory)
+{
+    CPU_ZONE("UCreateScene");
+
+    static const char* const PRIMITIVE_NAMES[] = { "cube", "cylinder", "sphere", "plane", "model" };
+    const VertexFormat& format = UGetVertexFormat(vertexFormat);
+    bool caching = meshCacheDirectory && UCreateMeshCacheDirectory(meshCacheDirectory);
+
+    // Spheres and cylinders without a fixed tessellation get a chain of LOD_SEGMENTS levels
+    vector<MeshCache> meshCaches(description.meshCount);
+    vector<vector<MeshData>> meshLevels(description.meshCount);
+    vector<vector<unsigned int>> meshSegments(description.meshCount);
+    vector<bool> wideMeshes(description.meshCount, false);
+    size_t totalVertices[2] = { 0, 0 };     // narrow (16-bit) and wide (32-bit) arena
+    size_t totalIndices[2] = { 0, 0 };
+    bool built = true;
+    for (uint32_t i = 0; built && i < description.meshCount; ++i)
+    {
+        const SceneMeshRecord& record = description.meshes[i];
+        bool tessellated = record.primitive == SCENE_PRIMITIVE_CYLINDER || record.primitive == SCENE_PRIMITIVE_SPHERE;
+        int levelCount = tessellated && record.segments <= 2 ? LOD_MAX_LEVELS : 1;
+
+        // The cache key names everything the generator (or the model file) and the vertex format depend on
+        bool model = record.primitive == SCENE_PRIMITIVE_MODEL;
+        string source = model ? UModelCacheKey(record.source) : string();
+        string key = string(PRIMITIVE_NAMES[record.primitive]) + (model ? "-" + source : "") +
+            (!tessellated ? "" : levelCount > 1 ? "-lod" : "-" + to_string(record.segments)) +
+            (vertexFormat == VERTEX_FORMAT_COMPACT ? "-compact" : "-standard");
+        bool cached = caching && (!model || !source.empty());
+        string cachePath = cached ? UMeshCachePath(meshCacheDirectory, key) : string();
+
+        MeshCache& cache = meshCaches[i];
+        if (cached && UOpenMeshCache(cachePath.c_str(), key, format, cache))
+        {
+            for (uint32_t level = 0; level < cache.levelCount; ++level)
+                if (UChooseIndexType(cache.levels[level].vertexCount) == GL_UNSIGNED_INT)
+                    wideMeshes[i] = true;
+            for (uint32_t level = 0; level < cache.levelCount; ++level)
+            {
+                totalVertices[wideMeshes[i]] += cache.levels[level].vertexCount;
+                totalIndices[wideMeshes[i]] += cache.levels[level].indexCount;
+            }
+            cout << "INFO: Mesh " << record.name << ": " << cache.levelCount << " levels read from " << cachePath << endl;
+            continue;
+        }
+
+        meshLevels[i].resize(levelCount);
+        meshSegments[i].resize(levelCount);
+        for (int level = 0; level < levelCount; ++level)
+        {
+            unsigned int segments = 0;
+            if (tessellated)
+                segments = record.segments > 2 ? record.segments : LOD_SEGMENTS[level];
+            meshSegments[i][level] = segments;
+
+            MeshData& data = meshLevels[i][level];
+            switch (record.primitive)
+            {
+            case SCENE_PRIMITIVE_CUBE:
+                UBuildCube(data);
+                break;
+            case SCENE_PRIMITIVE_CYLINDER:
+                UBuildCylinder(data, (int)segments);
+                break;
+            case SCENE_PRIMITIVE_SPHERE:
+                UBuildSphere(data, segments);
+                break;
+            case SCENE_PRIMITIVE_MODEL:
+                built = UImportModel(record.source, data);
+                break;
+            default:
+                UBuildPlane(data);
+                break;
+            }
+            if (!built)
+                break;
+
+            // Weld, then reorder triangles and vertices for the vertex cache, overdraw, and vertex fetch
+            MeshOptimizationStats stats = UOptimizeMesh(data);
+            cout << "INFO: Mesh " << record.name << " level " << level << ": vertices " << stats.verticesBefore
+                << " -> " << stats.verticesAfter << ", ACMR " << fixed << setprecision(3)
+                << stats.before.acmr << " -> " << stats.after.acmr << ", ATVR " << stats.before.atvr
+                << " -> " << stats.after.atvr << defaultfloat << endl;
+
+            if (UChooseIndexType(stats.verticesAfter) == GL_UNSIGNED_INT)
+                wideMeshes[i] = true;
+        }
+        for (size_t level = 0; built && level < meshLevels[i].size(); ++level)
+        {
+            totalVertices[wideMeshes[i]] += meshLevels[i][level].vertices.size() / FLOATS_PER_VERTEX;
+            totalIndices[wideMeshes[i]] += meshLevels[i][level].indices.size();
+        }
+
+        // A cache that cannot be written only costs the next run its head start
+        if (cached && built)
+            UWriteMeshCache(cachePath.c_str(), key, format, meshLevels[i], meshSegments[i]);
+    }
+
+    // Arena sizes and offsets are GLsizei, so a scene past that many vertices or indices cannot load
+    const size_t arenaLimit = (size_t)numeric_limits<GLsizei>::max();
+    if (built && (totalVertices[0] > arenaLimit || totalIndices[0] > arenaLimit ||
+        totalVertices[1] > arenaLimit || totalIndices[1] > arenaLimit))
+    {
+        cout << "ERROR::SCENE::TOO_MANY_VERTICES" << endl;
+        built = false;
+    }
+
+    // Each arena is sized to fit its meshes exactly. Indices are relative to each
+    // mesh's base vertex, so only a mesh's own vertex count decides its arena.
+    bool added = built && UCreateGeometryArena((GLsizei)max(totalVertices[0], (size_t)1),
+        (GLsizei)max(totalIndices[0], (size_t)1), vertexFormat, GL_UNSIGNED_SHORT, gArena);
+    gWideArena.vao = 0;
+    if (added && totalVertices[1] > 0)
+        added = UCreateGeometryArena((GLsizei)totalVertices[1], (GLsizei)totalIndices[1], vertexFormat,
+            GL_UNSIGNED_INT, gWideArena);
+
+    gMeshLods.resize(description.meshCount);
+    for (uint32_t i = 0; added && i < description.meshCount; ++i)
+    {
+        const MeshCache& cache = meshCaches[i];
+        GLGeometryArena& arena = wideMeshes[i] ? gWideArena : gArena;
+        if (wideMeshes[i])
+            cout << "INFO: Mesh " << description.meshes[i].name << " has over 65536 vertices and uses 32-bit indices" << endl;
+        gMeshLods[i].levelCount = 0;
+        for (uint32_t level = 0; added && level < cache.levelCount; ++level)
+            added = UAddEncodedMeshLodLevel(arena, UMeshCacheLevel(cache, level), cache.levels[level].segments, gMeshLods[i]);
+        for (size_t level = 0; added && level < meshLevels[i].size(); ++level)
+            added = UAddMeshLodLevel(arena, meshLevels[i][level], meshSegments[i][level], gMeshLods[i]);
+    }
+
+    // The arena holds its own copy, so the mappings can go
+    for (MeshCache& cache : meshCaches)
+        UCloseMeshCache(cache);
+    if (!added)
+        return false;
+
+    // Instance parents always precede their children, matching the scene graph order
+    gSceneObjects.resize(description.instanceCount);
+    for (uint32_t i = 0; i < description.instanceCount; ++i)
+    {
+        const SceneInstanceRecord& record = description.instances[i];
+        uint32_t parent = record.parent == SCENE_NO_PARENT_INSTANCE ?
+            SCENE_NO_PARENT : gSceneObjects[record.parent].node;
+
+        SceneObject& object = gSceneObjects[i];
+        object.node = UAddSceneNode(gScene, parent,
+            glm::vec3(record.translation[0], record.translation[1], record.translation[2]),
+            glm::quat(record.rotation[3], record.rotation[0], record.rotation[1], record.rotation[2]),
+            glm::vec3(record.scale[0], record.scale[1], record.scale[2]));
+        object.lod = &gMeshLods[record.mesh];
+        object.lodLevel = 0;
+        object.layer = record.material;
+    }
+    UResizeCullingBounds(gCullingBounds, gSceneObjects.size());
+
+    // Scenes without a point light get no ambient light
+    memset(&gLightData, 0, sizeof(gLightData));
+    gLights.clear();
+
+    bool havePoint = false;
+    for (uint32_t i = 0; i < description.lightCount; ++i)
+    {
+        const SceneLightRecord& light = description.lights[i];
+        glm::vec3 position(light.position[0], light.position[1], light.position[2]);
+        glm::vec3 color(light.color[0], light.color[1], light.color[2]);
+        if (light.type == SCENE_LIGHT_POINT)
+        {
+            gLights.push_back(UMakePointLight(position, color, LIGHT_UNBOUNDED_RANGE));
+            if (!havePoint)
+                gLightData.ambientColor = 0.25f * color;
+            havePoint = true;
+        }
+        else if (light.type == SCENE_LIGHT_SPOT)
+        {
+            glm::vec3 direction(light.direction[0], light.direction[1], light.direction[2]);
+            gLights.push_back(UMakeSpotLight(position, direction, color,
+                light.cutOff, light.outerCutOff, LIGHT_UNBOUNDED_RANGE));
+        }
+    }
+    gSceneLightCount = gLights.size();
+
+    return true;
+}
+
+
+/**
+ * @brief Adds small point lights scattered over the scene, for stress testing.
+ *
+ * Each light gets a random color and a short range and circles its own anchor
+ * point. The generator is seeded the same way every run, so benchmarks and
+ * frame hashes of runs with the same count match.
+ *
+ * @param count The number of lights to add.
+ */
+void UAddStressLights(int count)
+{
+    uint32_t seed = 12345u;
+    auto random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (float)(seed >> 8) / 16777216.0f;
+    };
+
+    gLights.resize(gSceneLightCount);
+    gStressLightAnchors.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        gStressLightAnchors[i] = glm::vec3(-4.0f + 8.0f * random(), -0.3f + 1.5f * random(), -4.0f + 8.0f * random());
+        glm::vec3 color = 0.5f * glm::vec3(random(), random(), random());
+        gLights.push_back(UMakePointLight(gStressLightAnchors[i], color, 0.3f + 0.3f * random()));
+    }
+}
+
+
+/**
+ * @brief Moves the stress lights along their circles for the current frame.
+ *
+ * Positions follow gFrameCount rather than the clock, so replays and the
+ * benchmark light every frame the same way.
+ */
+void UAnimateStressLights()
+{
+    float time = 0.02f * (float)gFrameCount;
+    for (size_t i = 0; i < gStressLightAnchors.size(); ++i)
+    {
+        float angle = time + 0.37f * (float)i;
+        glm::vec3 offset(0.3f * cos(angle), 0.1f * sin(2.0f * angle), 0.3f * sin(angle));
+        gLights[gSceneLightCount + i].positionRange =
+            glm::vec4(gStressLightAnchors[i] + offset, gLights[gSceneLightCount + i].positionRange.w);
+    }
+}
+
+
 /**
  * @brief Renders the frame.
  *
  * This function is called to render each frame. It clears the frame and depth buffers,
- * sets up transformation matrices, updates shader uniforms, and draws the objects
- * (two cylinders, two cubes, a sphere, and a plane) in the scene.
+ * updates the scene graph and camera matrices, updates shader uniforms, culls the
+ * objects outside the view frustum, and draws the rest, each at the level of
+ * detail its size on screen calls for. Unless --no-occlusion is given, the
+ * instances hidden behind others are also culled on the GPU, in two phases
+ * around a depth pyramid built mid-frame. With the depth pre-pass on, those
+ * phases only write depth with a position-only program, and the scene is then
+ * shaded with GL_EQUAL so each pixel is lit once. Lights are binned into the
+ * clusters of the view frustum first, so each fragment only loops over the
+ * lights that reach it.
  */
 void URender()
 {
+    CPU_ZONE("URender");
+
+    // Count this frame's state calls and driver work from zero
+    UStateResetCounters();
+    UBeginRenderStatsFrame();
+
+    // Collect the GPU timings of an earlier frame and start timing this one
+    UBeginGPUFrame(gGpuProfiler);
+    UBeginGPUScope(gGpuProfiler, gGpuScopes.frame);
+
     // Enable depth testing
-    glEnable(GL_DEPTH_TEST);
+    UStateEnable(GL_DEPTH_TEST);
 
     // Clear the frame and depth buffers
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    UBeginGPUScope(gGpuProfiler, gGpuScopes.clear);
+    UStateClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    UEndGPUScope(gGpuProfiler);
 
-    // Define transformation matrices for each object
-    glm::mat4 modelCylinder = glm::translate(glm::vec3(-1.0f, 0.0f, -0.5f)) *
-        glm::rotate(1.5708f, glm::vec3(-1.5708f, 0.0f, 1.0f)) * 
-        glm::scale(glm::vec3(0.3f, 0.1f, 0.3f));
+    // Recompute the world matrices of nodes that moved and refresh their instance data and bounds
+    {
+        CPU_ZONE("UUpdateSceneGraph");
+        UUpdateSceneGraph(gScene);
+        for (size_t i = 0; i < gSceneObjects.size(); ++i)
+        {
+            SceneObject& object = gSceneObjects[i];
+            if (gScene.worldChanged[object.node])
+            {
+                object.instance = UMakeMeshInstance(object.lod->levels[object.lodLevel], gScene.worlds[object.node], object.layer);
+                USetCullingBounds(gCullingBounds, i, object.lod->levels[0], gScene.worlds[object.node]);
+            }
+        }
+    }
 
-    glm::mat4 modelCube = glm::translate(glm::vec3(-1.7f, 0.0f, -0.35f)) *
-        glm::rotate(1.0f, glm::vec3(0.0f, -0.5f, 0.0f)) *
-        glm::scale(glm::vec3(0.3f, 0.8f, 1.2f));
+    // Create view matrix with previously defined lookAt parameters
+    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 
-    glm::mat4 modelSphere = glm::translate(glm::vec3(-0.5f, -0.1501f, 1.0f)) *
-        glm::rotate(0.0f, glm::vec3(0.0f, 0.0f, 1.0f)) *
-        glm::scale(glm::vec3(0.5f, 0.5f, 0.5f));
+    // Create perspective and orthographic projection matrices
+    const float nearPlane = 0.1f, farPlane = 100.0f;
+    glm::mat4 perspectiveProjection = glm::perspective(glm::radians(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, nearPlane, farPlane);
+    glm::mat4 orthoProjection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, nearPlane, farPlane);
+
+
+    // Camera data for this frame, using the projection that matches the view mode
+    FrameData frameData;
+    frameData.view = view;
+    frameData.projection = isOrthoView ? orthoProjection : perspectiveProjection;
+    frameData.viewProjection = frameData.projection * view;
+    frameData.cameraPos = cameraPos;
+    frameData.padding = 0.0f;
+
+    // Grid the fragment shader finds its cluster with, matching UBinLights
+    gLightData.lightCount = (GLuint)gLights.size();
+    gLightData.clusterGrid = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, CLUSTER_MAX_LIGHTS);
+    gLightData.clusterDepth = glm::vec4(nearPlane, farPlane, (float)CLUSTER_GRID_Z / log(farPlane / nearPlane), 0.0f);
+    gLightData.tileSize = glm::vec2((float)gViewportWidth / CLUSTER_GRID_X, (float)gViewportHeight / CLUSTER_GRID_Y);
+
+    // Copy both blocks into this frame's ring buffer region and bind them in one call
+    {
+        CPU_ZONE("UBeginRingBufferFrame");
+        UBeginRingBufferFrame(gUniformRing);
+    }
 
-    glm::mat4 modelCylinder02 = glm::translate(glm::vec3(0.0f, -0.2f, 0.0f)) *
-        glm::rotate(1.0f, glm::vec3(0.0f, -0.5f, 0.0f)) * 
-        glm::scale(glm::vec3(0.3f, 0.201f, 0.3f));
+    GLuint blockBuffers[2] = { gUniformRing.buffer, gUniformRing.buffer };
+    GLintptr blockOffsets[2];
+    GLsizeiptr blockSizes[2] = { sizeof(FrameData), sizeof(LightData) };
+    blockOffsets[0] = UWriteRingBuffer(gUniformRing, &frameData, sizeof(FrameData));
+    blockOffsets[1] = UWriteRingBuffer(gUniformRing, &gLightData, sizeof(LightData));
+    glBindBuffersRange(GL_UNIFORM_BUFFER, UBO_BINDING_FRAME, 2, blockBuffers, blockOffsets, blockSizes);
 
-    glm::mat4 modelCube02 = glm::translate(glm::vec3(1.0f, -0.025f, 0.0f)) *
-        glm::rotate(1.5708f, glm::vec3(0.0f, 1.0f, 0.0f)) *
-        glm::scale(glm::vec3(0.3f, 0.05f, 0.8f));
+    // Move and upload the lights, then list the lights reaching each cluster
+    {
+        CPU_ZONE("UBinLights");
+        UAnimateStressLights();
+        UUploadLights(gClusteredLights, gLights.data(), (GLsizei)gLights.size());
+        UBeginGPUScope(gGpuProfiler, gGpuScopes.lightBinning);
+        UBinLights(gClusteredLights, view, frameData.projection, nearPlane, farPlane);
+        UEndGPUScope(gGpuProfiler);
+    }
 
-    glm::mat4 modelPlane = glm::translate(glm::vec3(0.0f, -0.4f, 0.0f)) *
-        glm::rotate(1.5708f, glm::vec3(0.0f, 1.0f, 0.0f)) *
-        glm::scale(glm::vec3(3.0f, 3.0f, 3.0f));
+    // Test every object's bounds against the view frustum
+    size_t visibleCount;
+    {
+        CPU_ZONE("UCullBounds");
+        glm::vec4 frustumPlanes[6];
+        UExtractFrustumPlanes(frameData.viewProjection, frustumPlanes);
+        visibleCount = UCullBounds(frustumPlanes, gCullingBounds);
+    }
+    UCountCulled((unsigned int)(gSceneObjects.size() - visibleCount));
 
-    // Create view matrix with previously defined lookAt parameters
-    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    // Pick each visible object's level of detail from its size on screen
+    {
+        CPU_ZONE("USelectLodLevel");
+        for (size_t i = 0; i < gSceneObjects.size(); ++i)
+        {
+            SceneObject& object = gSceneObjects[i];
+            if (!gCullingBounds.visible[i] || object.lod->levelCount == 1)
+                continue;
+
+            glm::vec3 center(gCullingBounds.centerX[i], gCullingBounds.centerY[i], gCullingBounds.centerZ[i]);
+            float diameter = UProjectedDiameter(frameData.viewProjection, frameData.projection[1][1],
+                (float)gViewportHeight, center, gCullingBounds.radius[i]);
+            int level = USelectLodLevel(*object.lod, diameter, object.lodLevel);
+
+            // Compact levels decode their positions through the instance's model matrix
+            if (level != object.lodLevel)
+            {
+                object.lodLevel = level;
+                object.instance = UMakeMeshInstance(object.lod->levels[level], gScene.worlds[object.node], object.layer);
+            }
+        }
+    }
 
-    // Create perspective and orthographic projection matrices
-    glm::mat4 perspectiveProjection = glm::perspective(glm::radians(45.0f), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
-    glm::mat4 orthoProjection = glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 100.0f);
-
-
-    // Sets the shader to be used
-    glUseProgram(gProgramId);
-
-    // Set camera position uniform
-    GLint cameraPosLoc = glGetUniformLocation(gProgramId, "u_CameraPos");
-    glUniform3fv(cameraPosLoc, 1, glm::value_ptr(cameraPos));
-
-    // Set the lighting uniforms
-    GLint lightPosLoc = glGetUniformLocation(gProgramId, "u_LightPos");
-    GLint lightColorLoc = glGetUniformLocation(gProgramId, "u_LightColor");
-
-    glUniform3f(lightPosLoc, 0.0f, 1.0f, 0.0f); // light position
-    glUniform3f(lightColorLoc, 1.0f, 1.0f, 0.8f); // light color
-
-    // Set the spotlight uniforms
-    GLint spotLightPosLoc = glGetUniformLocation(gProgramId, "u_SpotLightPos");
-    GLint spotLightColorLoc = glGetUniformLocation(gProgramId, "u_SpotLightColor");
-    GLint spotLightDirLoc = glGetUniformLocation(gProgramId, "u_SpotLightDirection");
-    GLint spotLightCutOffLoc = glGetUniformLocation(gProgramId, "u_SpotLightCutOff");
-    GLint spotLightOuterCutOffLoc = glGetUniformLocation(gProgramId, "u_SpotLightOuterCutOff");
-
-    glUniform3f(spotLightPosLoc, 3.0f, 3.0f, 1.0f);
-    glUniform3f(spotLightColorLoc, 1.0f, 0.6f, 0.06f);
-    glUniform3f(spotLightDirLoc, 3.0f, 3.0f, 1.0f);
-    glUniform1f(spotLightCutOffLoc, cos(glm::radians(12.5f)));
-    glUniform1f(spotLightOuterCutOffLoc, cos(glm::radians(17.5f)));
-
-    // Retrieve and pass transform matrices to the shader program
-    GLint modelLoc = glGetUniformLocation(gProgramId, "model");
-    GLint viewLoc = glGetUniformLocation(gProgramId, "view");
-    GLint projLoc = glGetUniformLocation(gProgramId, "projection");
-
-    // Draw the first cylinder
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelCylinder));
-    glBindVertexArray(gMeshCylinder.vao);
-    glActiveTexture(GL_TEXTURE0);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 0);
-    glBindTexture(GL_TEXTURE_2D, gTexture1);
-    glDrawElements(GL_TRIANGLES, 12 * 36, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    // Draw the first cube
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelCube));
-    glBindVertexArray(gMeshCube.vao);
-    glActiveTexture(GL_TEXTURE1);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 1);
-    glBindTexture(GL_TEXTURE_2D, gTexture2);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
-
-    // Draw the sphere
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelSphere));
-    glBindVertexArray(gMeshSphere.vao);
-    glActiveTexture(GL_TEXTURE3);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 3);
-    glBindTexture(GL_TEXTURE_2D, gTexture4);
-    glDrawElements(GL_TRIANGLES, 6 * 16 * 16, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    // Draw the second cylinder
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelCylinder02));
-    glBindVertexArray(gMeshCylinder.vao);
-    glActiveTexture(GL_TEXTURE4);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
-    glBindTexture(GL_TEXTURE_2D, gTexture5);
-    glDrawElements(GL_TRIANGLES, 12 * 36, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-
-    // Draw the second cube
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelCube02));
-    glBindVertexArray(gMeshCube.vao);
-    glActiveTexture(GL_TEXTURE4);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 4);
-    glBindTexture(GL_TEXTURE_2D, gTexture5);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
-
-    // Draw the plane
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelPlane));
-    glBindVertexArray(gMeshPlane.vao);
-    glActiveTexture(GL_TEXTURE2);
-    glUniform1i(glGetUniformLocation(gProgramId, "uTexture"), 2);
-    glBindTexture(GL_TEXTURE_2D, gTexture3);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-
-
-    // Pass view matrix to shader
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-    // Pass projection matrix to shader based on view mode
-    if (isOrthoView)
-    {
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(orthoProjection));
+    // Submit every visible object; the queue orders them by program, texture, VAO, and depth.
+    // All materials share one texture array, so each arena's meshes become a single multi-draw.
+    UBeginRenderQueue(gRenderQueue, cameraPos, 100.0f);
+    for (size_t i = 0; i < gSceneObjects.size(); ++i)
+    {
+        if (!gCullingBounds.visible[i])
+            continue;
+
+        const SceneObject& object = gSceneObjects[i];
+        USubmit(gRenderQueue, *object.lod->arena, object.lod->levels[object.lodLevel], gProgram.id, gMaterialTextures, object.instance);
+    }
+
+    // Sort and draw, only binding state that changed
+    UBeginGPUScope(gGpuProfiler, gGpuScopes.opaque);
+    {
+        CPU_ZONE("USortRenderQueue");
+        USortRenderQueue(gRenderQueue);
+    }
+    {
+        CPU_ZONE("UPrepareRenderQueue");
+        UPrepareRenderQueue(gRenderQueue);
+    }
+
+    // The overdraw view replaces lighting with an additive count of shaded fragments
+    UStateUseProgram(gProgram.id);
+    USetUniform(gUniforms.overdraw, gOverdrawView ? 1 : 0);
+    if (gOverdrawView)
+    {
+        UStateEnable(GL_BLEND);
+        UStateBlendFunc(GL_ONE, GL_ONE);
+    }
+
+    // Without occlusion culling, one pass draws everything; with it, the instances
+    // visible last frame are drawn, this frame's depth pyramid is built from them,
+    // and what that depth shows was wrongly rejected is drawn, so nothing pops in late.
+    // With the depth pre-pass those passes only write depth, and the commands are
+    // then restored to both phases' instances for shading.
+    if (gOcclusionCulling)
+    {
+        CPU_ZONE("UOcclusionCullFirstPhase");
+        UOcclusionCullFirstPhase(gOcclusionCuller, gRenderQueue);
+    }
+
+    if (gDepthPrepass)
+    {
+        UBeginGPUScope(gGpuProfiler, gGpuScopes.depthPrepass);
+        UDrawRenderQueueDepth(gRenderQueue, gDepthProgram.id);
+        UEndGPUScope(gGpuProfiler);
     }
     else
     {
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(perspectiveProjection));
+        CPU_ZONE("UDrawRenderQueue");
+        UDrawRenderQueue(gRenderQueue);
+    }
+
+    if (gOcclusionCulling)
+    {
+        CPU_ZONE("UOcclusionCullSecondPhase");
+        UBeginGPUScope(gGpuProfiler, gGpuScopes.occlusion);
+        UBuildDepthPyramid(gOcclusionCuller, frameData.viewProjection);
+        UOcclusionCullSecondPhase(gOcclusionCuller, gRenderQueue, frameData.viewProjection);
+        UEndGPUScope(gGpuProfiler);
+
+        if (gDepthPrepass)
+        {
+            UBeginGPUScope(gGpuProfiler, gGpuScopes.depthPrepass);
+            UDrawRenderQueueDepth(gRenderQueue, gDepthProgram.id);
+            UEndGPUScope(gGpuProfiler);
+            UOcclusionRestoreVisible(gOcclusionCuller, gRenderQueue);
+        }
+        else
+            UDrawRenderQueue(gRenderQueue, false);
+    }
+
+    // Shade every visible instance once the depth is final: only the nearest
+    // fragment of each pixel passes GL_EQUAL, so lighting runs once per pixel
+    if (gDepthPrepass)
+    {
+        CPU_ZONE("UDrawRenderQueue");
+        UStateDepthFunc(GL_EQUAL);
+        UStateDepthMask(GL_FALSE);
+        UDrawRenderQueue(gRenderQueue);
+        UStateDepthFunc(GL_LESS);
+        UStateDepthMask(GL_TRUE); // glClear only clears depth while writes are on
+    }
+
+    if (gOverdrawView)
+        UStateDisable(GL_BLEND);
+    UEndGPUScope(gGpuProfiler);
+
+    // Report the state change counts once, on the first steady-state frame
+    if (gFrameCount == 1)
+    {
+        const RenderQueueStats& stats = gRenderQueue.stats;
+        cout << "INFO: Render queue: " << stats.items << " items, " << stats.drawCalls << " draw calls, "
+            << stats.stateChanges << " state changes issued, "
+            << stats.naiveStateChanges - stats.stateChanges << " redundant state changes elided" << endl;
+
+        GLStateCounters counters = UStateCounters();
+        cout << "INFO: State cache: " << counters.issued << " calls issued, " << counters.elided << " elided" << endl;
+    }
+    ++gFrameCount;
+
+    // Fence this frame's uniform region so it is not overwritten while in use
+    UEndRingBufferFrame(gUniformRing);
+
+    UEndGPUScope(gGpuProfiler);
+    UEndGPUFrame(gGpuProfiler);
+
+    // Keep this frame's counters for the overlay and the log
+    UEndRenderStatsFrame();
+}
+
+
+/**
+ * @brief Places the camera along the benchmark's scripted path.
+ *
+ * The camera circles the scene once over the benchmark while bobbing up and
+ * down, always looking at the origin, so every run sees the same views.
+ *
+ * @param frame The index of the frame being rendered.
+ * @param frameCount The number of frames in the path.
+ */
+void UBenchmarkCamera(int frame, int frameCount)
+{
+    float t = (float)frame / (float)frameCount;
+    float angle = t * glm::two_pi<float>();
+
+    cameraPos = glm::vec3(4.0f * sin(angle), 1.0f + 0.5f * sin(2.0f * angle), 4.0f * cos(angle));
+    cameraFront = glm::normalize(-cameraPos);
+    cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+
+/**
+ * @brief Renders the benchmark and writes its report.
+ *
+ * This function renders BENCHMARK_WARMUP_FRAMES unrecorded frames and then
+ * options.benchmarkFrames recorded ones along the scripted camera path. When
+ * input is being replayed, the recording drives the camera instead and sets
+ * the number of recorded frames. The CPU time of each frame is measured around
+ * URender. The GPU time comes from a GL_TIME_ELAPSED query per frame; the
+ * queries are only read back after the last frame, so collecting them never
+ * stalls the pipeline.
+ *
+ * @param options The command line options.
+ * @return True if the report was written, otherwise false.
+ */
+bool URunBenchmark(const AppOptions& options)
+{
+    int recordedFrames = gReplayingInput ? (int)gInputRecording.frameCount : options.benchmarkFrames;
+    int totalFrames = BENCHMARK_WARMUP_FRAMES + recordedFrames;
+
+    BenchmarkResults results;
+    results.renderer = (const char*)glGetString(GL_RENDERER);
+    results.version = (const char*)glGetString(GL_VERSION);
+    results.warmupFrames = BENCHMARK_WARMUP_FRAMES;
+    results.cpuMs.reserve(recordedFrames);
+    results.gpuMs.reserve(recordedFrames);
+
+    vector<GLuint> queries(recordedFrames);
+    glGenQueries((GLsizei)queries.size(), queries.data());
+
+    gDeltaTime = INPUT_REPLAY_DELTA_TIME;
+
+    for (int frame = 0; frame < totalFrames; ++frame)
+    {
+        int recorded = frame - BENCHMARK_WARMUP_FRAMES;
+
+        // Warm-up frames keep the initial camera during a replay
+        if (!gReplayingInput)
+            UBenchmarkCamera(frame, totalFrames);
+        else if (recorded >= 0)
+        {
+            UReplayInputFrame(gInputRecording, nullptr, UMousePositionCallback, UMouseScrollCallback);
+            UProcessInput(gWindow);
+        }
+
+        if (recorded >= 0)
+            glBeginQuery(GL_TIME_ELAPSED, queries[recorded]);
+
+        CPU_ZONE("frame");
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        URender();
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+        if (recorded >= 0)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            results.cpuMs.push_back(chrono::duration<double, milli>(end - start).count());
+
+            if (gHashingFrames)
+                UCaptureFrame(gFrameHasher);
+        }
+    }
+
+    // Every query is complete once the GPU has finished
+    glFinish();
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+        results.gpuMs.push_back(elapsed / 1.0e6);
     }
+    glDeleteQueries((GLsizei)queries.size(), queries.data());
 
-    // Swap buffers and poll for IO events
-    glfwSwapBuffers(gWindow);
+    return UWriteBenchmarkReport(results, options.benchmarkOutput);
 }
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "mappedfile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+/**
+ * @brief Maps a whole file into memory for reading.
+ *
+ * The operating system pages the file in on demand, so loaders can read their
+ * records straight out of the mapping without copying the file first.
+ *
+ * @param filename The path of the file to map.
+ * @param file The MappedFile structure to hold the mapping.
+ * @return True if the file was opened and mapped, otherwise false.
+ */
+bool UOpenMappedFile(const char* filename, MappedFile& file)
+{
+    file.data = nullptr;
+    file.size = 0;
+    file.fileHandle = nullptr;
+    file.mappingHandle = nullptr;
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        cout << "ERROR::MAPPEDFILE::OPEN_FAILED " << filename << endl;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size))
+    {
+        CloseHandle(handle);
+        cout << "ERROR::MAPPEDFILE::OPEN_FAILED " << filename << endl;
+        return false;
+    }
+
+    file.fileHandle = handle;
+    file.size = (size_t)size.QuadPart;
+
+    // Empty files cannot be mapped but are still valid
+    if (file.size == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        UCloseMappedFile(file);
+        cout << "ERROR::MAPPEDFILE::MAPPING_FAILED " << filename << endl;
+        return false;
+    }
+
+    file.mappingHandle = mapping;
+    file.data = (const unsigned char*)view;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        cout << "ERROR::MAPPEDFILE::OPEN_FAILED " << filename << endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        cout << "ERROR::MAPPEDFILE::OPEN_FAILED " << filename << endl;
+        return false;
+    }
+
+    file.size = (size_t)info.st_size;
+
+    // Empty files cannot be mapped but are still valid
+    if (file.size == 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* view = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        file.size = 0;
+        cout << "ERROR::MAPPEDFILE::MAPPING_FAILED " << filename << endl;
+        return false;
+    }
+
+    file.data = (const unsigned char*)view;
+#endif
+
+    return true;
+}
+
+/**
+ * @brief Unmaps a file mapped by UOpenMappedFile.
+ *
+ * @param file The MappedFile structure to be closed.
+ */
+void UCloseMappedFile(MappedFile& file)
+{
+#ifdef _WIN32
+    if (file.data)
+        UnmapViewOfFile(file.data);
+    if (file.mappingHandle)
+        CloseHandle((HANDLE)file.mappingHandle);
+    if (file.fileHandle)
+        CloseHandle((HANDLE)file.fileHandle);
+#else
+    if (file.data)
+        munmap((void*)file.data, file.size);
+#endif
+
+    file.data = nullptr;
+    file.size = 0;
+    file.fileHandle = nullptr;
+    file.mappingHandle = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+// Struct to hold a read-only memory mapping of a whole file
+struct MappedFile {
+    const unsigned char* data;  // first byte of the file (nullptr when empty or closed)
+    size_t size;                // file size in bytes
+    void* fileHandle;           // platform file handle (HANDLE on Windows, unused elsewhere)
+    void* mappingHandle;        // platform mapping handle (HANDLE on Windows, unused elsewhere)
+};
+
+bool UOpenMappedFile(const char* filename, MappedFile& file);
+void UCloseMappedFile(MappedFile& file);
\ No newline at end of file
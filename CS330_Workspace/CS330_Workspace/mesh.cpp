@@ -1,25 +1,28 @@
 #include "mesh.h"
 #include <vector>
 #include <glm/glm.hpp>
-#include <iostream>
 #include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/simd/matrix.h>
+#include <cstddef>
+#include <cstring>
 using namespace std;
 
 /**
- * @brief Creates a 3D cylinder mesh.
+ * @brief Builds the geometry of a 3D cylinder.
  *
  * This function generates the vertices, normals, texture coordinates, and indices
- * for a 3D cylinder mesh and uploads them to the GPU. The cylinder is centered at
- * the origin, with its height extending along the y-axis.
+ * for a 3D cylinder mesh. The cylinder is centered at the origin, with its height
+ * extending along the y-axis.
  *
- * @param mesh The GLMesh structure to hold the mesh data.
+ * @param data The MeshData structure to hold the generated geometry.
+ * @param segments The number of segments around the cylinder.
  */
-void UCreateCylinder(GLMesh& mesh) {
-    const int segments = 36;
+void UBuildCylinder(MeshData& data, int segments) {
     const float radius = 1.0f;
     const float height = 2.0f;
-    std::vector<GLfloat> vertices;
-    std::vector<GLuint> indices;
+    std::vector<GLfloat>& vertices = data.vertices;
+    std::vector<GLuint>& indices = data.indices;
 
     float angleStep = 2.0f * glm::pi<float>() / segments;
 
@@ -107,139 +110,77 @@ void UCreateCylinder(GLMesh& mesh) {
         indices.push_back(centerBottomIndex);
         indices.push_back(bottom2);
     }
-
-    // sets the number of positional, normal, and texture coordinate data points
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormal = 3;
-    const GLuint floatsPerUV = 2;
-
-    glGenVertexArrays(1, &mesh.vao);
-    glBindVertexArray(mesh.vao);
-
-    // creates 2 buffers: first one for vertex data; second one for indices
-    glGenBuffers(2, mesh.vbos);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
-
-    // 8 strides between vertex coordinates (x, y, z, nx, ny, nz, u, v)
-    GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
-
-    // creates vertex attribute pointers
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0);
 }
 
 /**
- * @brief Creates a 3D cube mesh.
+ * @brief Builds the geometry of a 3D cube.
  *
- * This function generates the vertices, normals, and texture coordinates for a 3D cube mesh
- * and uploads them to the GPU. The cube is centered at the origin.
+ * This function generates the vertices, normals, texture coordinates, and indices
+ * for a 3D cube mesh. The cube is centered at the origin. Each face has its own
+ * four vertices (so normals and texture coordinates stay per-face) and is drawn
+ * as two indexed triangles.
  *
- * @param mesh The GLMesh structure to hold the mesh data.
+ * @param data The MeshData structure to hold the generated geometry.
  */
-void UCreateCube(GLMesh& mesh)
+void UBuildCube(MeshData& data)
 {
     // Vertex data for a cube, including positions, normals, and texture coordinates
     GLfloat verts[] = {
         // vertex positions  // normals        // texture coordinates
          0.5f, -0.5f, 0.0f,  0.0f, -1.0f, 0.0f,  1.0f, 1.0f, // front right (bottom face) Vertex 0
         -0.5f, -0.5f, 0.0f,  0.0f, -1.0f, 0.0f,  0.0f, 1.0f, // front left (bottom face) Vertex 1
-        -0.5f, -0.5f, -1.0f,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f, // back left (bottom face) Vertex 3
-         0.5f, -0.5f, 0.0f,  0.0f, -1.0f, 0.0f,  1.0f, 1.0f, // front right (bottom face) Vertex 0
-         0.5f, -0.5f, -1.0f,  0.0f, -1.0f, 0.0f,  1.0f, 0.0f, // back right (bottom face) Vertex 2
-        -0.5f, -0.5f, -1.0f,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f, // back left (bottom face) Vertex 3
-
-       -0.5f,  0.5f, 0.0f,  -1.0f, 0.0f, 0.0f,  1.0f, 1.0f, // front top (left face) Vertex 0
-       -0.5f,  0.5f, -1.0f,  -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, // back top (left face) Vertex 1
-       -0.5f, -0.5f, -1.0f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f, // back bottom (left face) Vertex 3
-       -0.5f,  0.5f, 0.0f,  -1.0f, 0.0f, 0.0f,  1.0f, 1.0f, // front top (left face) Vertex 0
-       -0.5f, -0.5f, 0.0f,  -1.0f, 0.0f, 0.0f,  1.0f, 0.0f, // front bottom (left face) Vertex 2
-       -0.5f, -0.5f, -1.0f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f, // back bottom (left face) Vertex 3
-
-        0.5f,  0.5f, -1.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, // back top (right face) Vertex 0
-        0.5f,  0.5f,  0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 1.0f, // front top (right face) Vertex 1
-        0.5f, -0.5f,  0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, // front bottom (right face) Vertex 3
-        0.5f,  0.5f, -1.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, // back top (right face) Vertex 0
-        0.5f, -0.5f, -1.0f,  1.0f, 0.0f, 0.0f,  1.0f, 0.0f, // back bottom (right face) Vertex 2
-        0.5f, -0.5f,  0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, // front bottom (right face) Vertex 3
-
-        0.5f,  0.5f,  0.0f,  0.0f, 1.0f, 0.0f,  1.0f, 4.0f, // front right (top face) Vertex 0
-       -0.5f,  0.5f,  0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 4.0f, // front left (top face) Vertex 1
-       -0.5f,  0.5f, -1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, // back left (top face) Vertex 3
-        0.5f,  0.5f,  0.0f,  0.0f, 1.0f, 0.0f,  1.0f, 4.0f, // front right (top face) Vertex 0
-        0.5f,  0.5f, -1.0f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f, // back right (top face) Vertex 2
-       -0.5f,  0.5f, -1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, // back left (top face) Vertex 3
-
-        0.5f,  0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  1.0f, 3.0f, // top right (back face) Vertex 0
-       -0.5f,  0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 3.0f, // top left (back face) Vertex 1
-       -0.5f, -0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f, // bottom left (back face) Vertex 3
-        0.5f,  0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  1.0f, 3.0f, // top right (back face) Vertex 0
-        0.5f, -0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  1.0f, 0.0f, // bottom right (back face) Vertex 2
-       -0.5f, -0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f, // bottom left (back face) Vertex 3
-
-        0.5f,  0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 3.0f, // top right (front face) Vertex 0
-       -0.5f,  0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 3.0f, // top left (front face) Vertex 1
-       -0.5f, -0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f, // bottom left (front face) Vertex 3
-        0.5f,  0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 3.0f, // top right (front face) Vertex 0
-        0.5f, -0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f, // bottom right (front face) Vertex 2
-       -0.5f, -0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f // bottom left (front face) Vertex 3
+        -0.5f, -0.5f, -1.0f,  0.0f, -1.0f, 0.0f,  0.0f, 0.0f, // back left (bottom face) Vertex 2
+         0.5f, -0.5f, -1.0f,  0.0f, -1.0f, 0.0f,  1.0f, 0.0f, // back right (bottom face) Vertex 3
+
+        -0.5f,  0.5f, 0.0f,  -1.0f, 0.0f, 0.0f,  1.0f, 1.0f, // front top (left face) Vertex 0
+        -0.5f,  0.5f, -1.0f,  -1.0f, 0.0f, 0.0f,  0.0f, 1.0f, // back top (left face) Vertex 1
+        -0.5f, -0.5f, -1.0f,  -1.0f, 0.0f, 0.0f,  0.0f, 0.0f, // back bottom (left face) Vertex 2
+        -0.5f, -0.5f, 0.0f,  -1.0f, 0.0f, 0.0f,  1.0f, 0.0f, // front bottom (left face) Vertex 3
+
+         0.5f,  0.5f, -1.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, // back top (right face) Vertex 0
+         0.5f,  0.5f,  0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 1.0f, // front top (right face) Vertex 1
+         0.5f, -0.5f,  0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 0.0f, // front bottom (right face) Vertex 2
+         0.5f, -0.5f, -1.0f,  1.0f, 0.0f, 0.0f,  1.0f, 0.0f, // back bottom (right face) Vertex 3
+
+         0.5f,  0.5f,  0.0f,  0.0f, 1.0f, 0.0f,  1.0f, 4.0f, // front right (top face) Vertex 0
+        -0.5f,  0.5f,  0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 4.0f, // front left (top face) Vertex 1
+        -0.5f,  0.5f, -1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, // back left (top face) Vertex 2
+         0.5f,  0.5f, -1.0f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f, // back right (top face) Vertex 3
+
+         0.5f,  0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  1.0f, 3.0f, // top right (back face) Vertex 0
+        -0.5f,  0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 3.0f, // top left (back face) Vertex 1
+        -0.5f, -0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f, // bottom left (back face) Vertex 2
+         0.5f, -0.5f, -1.0f,  0.0f, 0.0f, -1.0f,  1.0f, 0.0f, // bottom right (back face) Vertex 3
+
+         0.5f,  0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 3.0f, // top right (front face) Vertex 0
+        -0.5f,  0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 3.0f, // top left (front face) Vertex 1
+        -0.5f, -0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  0.0f, 0.0f, // bottom left (front face) Vertex 2
+         0.5f, -0.5f,  0.0f,  0.0f, 0.0f, 1.0f,  1.0f, 0.0f, // bottom right (front face) Vertex 3
     };
 
-    // Sets the number of positional, normal, and texture coordinate data points
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormal = 3;
-    const GLuint floatsPerUV = 2;
-
-    // Generate and bind the vertex array object (VAO)
-    glGenVertexArrays(1, &mesh.vao);
-    glBindVertexArray(mesh.vao);
+    data.vertices.assign(verts, verts + sizeof(verts) / sizeof(verts[0]));
 
-    // Creates 2 buffers: first one for vertex data; second one for indices
-    glGenBuffers(1, mesh.vbos);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-
-    // 8 strides between vertex coordinates (x, y, z, nx, ny, nz, u, v)
-    GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
-
-    // Creates vertex attribute pointers
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
-
-    // Unbind the VAO
-    glBindVertexArray(0);
+    // Two triangles per face: vertices 0-1-2 and 0-3-2
+    for (GLuint face = 0; face < 6; ++face)
+    {
+        GLuint base = face * 4;
+        GLuint faceIndices[] = { base, base + 1, base + 2, base, base + 3, base + 2 };
+        data.indices.insert(data.indices.end(), faceIndices, faceIndices + 6);
+    }
 }
 
 /**
- * @brief Creates a 3D sphere mesh.
+ * @brief Builds the geometry of a 3D sphere.
  *
- * This function generates the vertices, normals, and texture coordinates for a 3D sphere mesh
- * and uploads them to the GPU. The sphere is centered at the origin.
+ * This function generates the vertices, normals, texture coordinates, and indices
+ * for a 3D sphere mesh. The sphere is centered at the origin.
  *
- * @param mesh The GLMesh structure to hold the mesh data.
+ * @param data The MeshData structure to hold the generated geometry.
+ * @param numSegments The number of segments around and from pole to pole.
  */
-void UCreateSphere(GLMesh& mesh)
+void UBuildSphere(MeshData& data, unsigned int numSegments)
 {
-    unsigned int numSegments = 16; // Number of segments for the sphere
-
-    vector<GLfloat> verts; // Vector to store vertex data
+    vector<GLfloat>& verts = data.vertices; // Vector to store vertex data
 
     float radius = 0.5f; // Radius of the sphere
 
@@ -270,7 +211,7 @@ void UCreateSphere(GLMesh& mesh)
         }
     }
 
-    vector<GLuint> indices; // Vector to store indices
+    vector<GLuint>& indices = data.indices; // Vector to store indices
 
     // Generate indices for the sphere
     for (unsigned int i = 0; i < numSegments; ++i)
@@ -289,108 +230,244 @@ void UCreateSphere(GLMesh& mesh)
             indices.push_back(first + 1);
         }
     }
+}
+
 
-    // Sets the number of positional, normal, and texture coordinate data points
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormal = 3;
-    const GLuint floatsPerUV = 2;
+/**
+ * @brief Builds the geometry of a 3D plane.
+ *
+ * This function generates the vertices, normals, texture coordinates, and indices
+ * for a 3D plane mesh. The plane lies flat on the XZ plane.
+ *
+ * @param data The MeshData structure to hold the generated geometry.
+ */
+void UBuildPlane(MeshData& data)
+{
+    // Define vertices for the plane, including positions, normals, and texture coordinates
+    GLfloat verts[] = {
+        // vertex positions   // normals        // texture coordinates
+         1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f, // front right Vertex 0
+        -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, // front left Vertex 1
+        -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f, // back left Vertex 2
+         1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f, // back right Vertex 3
+    };
 
-    // Generate and bind the vertex array object (VAO)
-    glGenVertexArrays(1, &mesh.vao);
-    glBindVertexArray(mesh.vao);
+    // Two triangles: vertices 0-1-2 and 0-3-2
+    GLuint indices[] = { 0, 1, 2, 0, 3, 2 };
 
-    // Creates 2 buffers: first one for vertex data; second one for indices
-    glGenBuffers(2, mesh.vbos);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(), &verts[0], GL_STATIC_DRAW);
+    data.vertices.assign(verts, verts + sizeof(verts) / sizeof(verts[0]));
+    data.indices.assign(indices, indices + 6);
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
 
-    // 8 strides between vertex coordinates (x, y, z, nx, ny, nz, u, v)
-    GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
+/**
+ * @brief Computes the normal matrix of a model matrix.
+ *
+ * The normal matrix is the upper 3x3 of transpose(inverse(model)). Computing it
+ * here once per object, with glm's SSE matrix inverse when it is available,
+ * replaces a full 4x4 inverse that the vertex shader used to run per vertex.
+ *
+ * @param model The model (object to world) matrix.
+ * @return The matrix that transforms object-space normals to world space.
+ */
+glm::mat3 UComputeNormalMatrix(const glm::mat4& model)
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    glm_vec4 columns[4];
+    glm_vec4 inverse[4];
+    for (int c = 0; c < 4; ++c)
+        columns[c] = _mm_loadu_ps(&model[c][0]);
 
-    // Creates vertex attribute pointers
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
+    glm_mat4_inverse(columns, inverse);
 
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
+    float inv[4][4];
+    for (int c = 0; c < 4; ++c)
+        _mm_storeu_ps(inv[c], inverse[c]);
 
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
+    // Transposes while keeping the upper 3x3
+    glm::mat3 normalMatrix;
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int r = 0; r < 3; ++r)
+            normalMatrix[c][r] = inv[r][c];
+    }
+    return normalMatrix;
+#else
+    return glm::mat3(glm::transpose(glm::inverse(model)));
+#endif
+}
 
-    // Unbind the VAO
-    glBindVertexArray(0);
+/**
+ * @brief Builds the per-instance record for an object.
+ *
+ * @param model The model (object to world) matrix.
+ * @param layer The texture layer index of the object's material.
+ * @return The GLInstance record, including the precomputed normal matrix.
+ */
+GLInstance UMakeInstance(const glm::mat4& model, GLuint layer)
+{
+    GLInstance instance;
+    instance.model = model;
+    instance.normalMatrix = UComputeNormalMatrix(model);
+    instance.layer = layer;
+    instance.texCoordTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+    return instance;
 }
 
+/**
+ * @brief Builds the per-instance record for an object drawn with a given mesh.
+ *
+ * The mesh's position scale and bias are folded into the model matrix, so the
+ * transform that places the object also decodes quantized positions. The
+ * normal matrix still comes from the object's own model matrix, and the
+ * mesh's texture coordinate scale and bias are copied into the record.
+ *
+ * @param mesh The mesh the instance is drawn with.
+ * @param model The model (object to world) matrix.
+ * @param layer The texture layer index of the object's material.
+ * @return The GLInstance record.
+ */
+GLInstance UMakeMeshInstance(const GLMesh& mesh, const glm::mat4& model, GLuint layer)
+{
+    GLInstance instance = UMakeInstance(model, layer);
+    if (mesh.positionScale != glm::vec3(1.0f) || mesh.positionBias != glm::vec3(0.0f))
+        instance.model = model * glm::translate(glm::mat4(1.0f), mesh.positionBias) * glm::scale(glm::mat4(1.0f), mesh.positionScale);
+    instance.texCoordTransform = glm::vec4(mesh.texCoordScale, mesh.texCoordBias);
+    return instance;
+}
 
 /**
- * @brief Creates a 3D plane mesh.
+ * @brief Sets up the per-instance attributes of the bound VAO.
  *
- * This function generates the vertices, normals, and texture coordinates for a 3D plane mesh
- * and uploads them to the GPU. The plane lies flat on the XZ plane.
+ * This function points INSTANCE_MODEL_LOCATION (a mat4 over four locations),
+ * INSTANCE_NORMAL_LOCATION (a mat3 over three locations),
+ * INSTANCE_LAYER_LOCATION, and INSTANCE_TEXCOORD_LOCATION at the GLInstance
+ * records in instanceBuffer, with an attribute divisor of 1 so each instance
+ * reads one record.
  *
- * @param mesh The GLMesh structure to hold the mesh data.
+ * @param instanceBuffer The buffer holding GLInstance records.
  */
-void UCreatePlane(GLMesh& mesh)
+void UBindInstanceAttributes(GLuint instanceBuffer)
 {
-    // Define vertices for the plane, including positions, normals, and texture coordinates
-    GLfloat verts[] = {
-        // vertex positions   // normals        // texture coordinates
-         1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f, // front right Vertex 0
-        -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, // front left Vertex 1
-        -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f, // back left Vertex 3
-         1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f, // front right Vertex 0
-         1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f, // back right Vertex 2
-        -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f, // back left Vertex 3
-    };
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
 
-    // Sets the number of positional, normal, and texture coordinate data points
-    const GLuint floatsPerVertex = 3;
-    const GLuint floatsPerNormal = 3;
-    const GLuint floatsPerUV = 2;
+    GLint stride = sizeof(GLInstance);
 
-    // Generate and bind the vertex array object (VAO)
-    glGenVertexArrays(1, &mesh.vao);
-    glBindVertexArray(mesh.vao);
+    // The model matrix is passed as four vec4 columns
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        GLuint location = INSTANCE_MODEL_LOCATION + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
 
-    // Creates 2 buffers: first one for vertex data; second one for indices
-    glGenBuffers(1, mesh.vbos);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+    // The normal matrix is passed as three vec3 columns
+    for (GLuint column = 0; column < 3; ++column)
+    {
+        GLuint location = INSTANCE_NORMAL_LOCATION + column;
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride,
+            (void*)(offsetof(GLInstance, normalMatrix) + sizeof(glm::vec3) * column));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+
+    glVertexAttribIPointer(INSTANCE_LAYER_LOCATION, 1, GL_UNSIGNED_INT, stride, (void*)offsetof(GLInstance, layer));
+    glVertexAttribDivisor(INSTANCE_LAYER_LOCATION, 1);
+    glEnableVertexAttribArray(INSTANCE_LAYER_LOCATION);
 
-    // 8 strides between vertex coordinates (x, y, z, nx, ny, nz, u, v)
-    GLint stride = sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV);
+    glVertexAttribPointer(INSTANCE_TEXCOORD_LOCATION, 4, GL_FLOAT, GL_FALSE, stride,
+        (void*)offsetof(GLInstance, texCoordTransform));
+    glVertexAttribDivisor(INSTANCE_TEXCOORD_LOCATION, 1);
+    glEnableVertexAttribArray(INSTANCE_TEXCOORD_LOCATION);
+}
+
+/**
+ * @brief Computes a mesh's bounding box and bounding sphere from its vertices.
+ *
+ * The sphere is centered on the box and reaches the farthest vertex, so it is
+ * never larger than the box's circumscribed sphere and often much tighter.
+ *
+ * @param data The MeshData structure holding the geometry.
+ * @param mesh The GLMesh structure receiving the bounds.
+ */
+void UComputeMeshBounds(const MeshData& data, GLMesh& mesh)
+{
+    size_t numVertices = data.vertices.size() / FLOATS_PER_VERTEX;
+    if (numVertices == 0)
+    {
+        mesh.boundsMin = mesh.boundsMax = mesh.boundsCenter = glm::vec3(0.0f);
+        mesh.boundsRadius = 0.0f;
+        return;
+    }
 
-    // creates vertex attribute pointers
-    glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
-    glEnableVertexAttribArray(0);
+    const GLfloat* v = &data.vertices[0];
+    glm::vec3 lo(v[0], v[1], v[2]);
+    glm::vec3 hi = lo;
+    for (size_t i = 1; i < numVertices; ++i)
+    {
+        const GLfloat* p = v + i * FLOATS_PER_VERTEX;
+        lo = glm::min(lo, glm::vec3(p[0], p[1], p[2]));
+        hi = glm::max(hi, glm::vec3(p[0], p[1], p[2]));
+    }
 
-    glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * floatsPerVertex));
-    glEnableVertexAttribArray(1);
+    glm::vec3 center = (lo + hi) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        const GLfloat* p = v + i * FLOATS_PER_VERTEX;
+        glm::vec3 offset = glm::vec3(p[0], p[1], p[2]) - center;
+        radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+    }
 
-    glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
-    glEnableVertexAttribArray(2);
+    mesh.boundsMin = lo;
+    mesh.boundsMax = hi;
+    mesh.boundsCenter = center;
+    mesh.boundsRadius = sqrt(radiusSquared);
+}
 
-    // Unbind the VAO
-    glBindVertexArray(0);
+/**
+ * @brief Picks the smallest index type that can address every vertex of a mesh.
+ *
+ * @param vertexCount The number of vertices the indices refer to.
+ * @return GL_UNSIGNED_SHORT if 16 bits are enough, otherwise GL_UNSIGNED_INT.
+ */
+GLenum UChooseIndexType(size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 }
 
+/**
+ * @brief Returns the size in bytes of one index of the given type.
+ *
+ * @param indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ * @return The index size.
+ */
+GLsizei UIndexSize(GLenum indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
 
 /**
- * @brief Cleans up the buffers and vertex arrays used by a mesh.
+ * @brief Converts indices to the bytes of an index buffer of the given type.
  *
- * This function deletes the vertex array object (VAO) and the vertex buffer objects (VBOs)
- * associated with the provided mesh, freeing up GPU resources.
+ * Every index must fit the type; pick it with UChooseIndexType.
  *
- * @param mesh The GLMesh structure containing the VAO and VBOs to be deleted.
+ * @param indices The indices to convert.
+ * @param indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+ * @param bytes The buffer receiving UIndexSize(indexType) bytes per index.
  */
-void UDestroyMesh(GLMesh& mesh)
+void UEncodeIndices(const vector<GLuint>& indices, GLenum indexType, vector<unsigned char>& bytes)
 {
-    // Delete the vertex array object (VAO)
-    glDeleteVertexArrays(1, &mesh.vao);
+    bytes.resize(UIndexSize(indexType) * indices.size());
+    if (indexType != GL_UNSIGNED_SHORT)
+    {
+        if (!indices.empty())
+            memcpy(bytes.data(), indices.data(), bytes.size());
+        return;
+    }
 
-    // Delete the vertex buffer objects (VBOs)
-    glDeleteBuffers(2, mesh.vbos);
-}
\ No newline at end of file
+    GLushort* out = (GLushort*)bytes.data();
+    for (size_t i = 0; i < indices.size(); ++i)
+        out[i] = (GLushort)indices[i];
+}
@@ -1,17 +1,58 @@
 #pragma once
 
 #include <GL/glew.h>  // Include OpenGL types
+#include <glm/glm.hpp>
+#include <vector>
 
-// Struct to hold mesh data
+// Number of floats per vertex in MeshData (x, y, z, nx, ny, nz, u, v)
+const GLuint FLOATS_PER_VERTEX = 8;
+
+// Attribute locations of the per-instance data (a matN takes N consecutive locations)
+const GLuint INSTANCE_MODEL_LOCATION = 3;
+const GLuint INSTANCE_NORMAL_LOCATION = 7;
+const GLuint INSTANCE_LAYER_LOCATION = 10;
+const GLuint INSTANCE_TEXCOORD_LOCATION = 11;
+
+// Struct to hold the per-instance attributes read by the vertex shader
+struct GLInstance {
+    glm::mat4 model;         // model (object to world) matrix
+    glm::mat3 normalMatrix;  // transpose(inverse(model)), computed once on the CPU
+    GLuint layer;            // texture layer index of the instance's material
+    glm::vec4 texCoordTransform; // texture coordinate = stored coordinate * xy + zw (the mesh's scale and bias)
+};
+
+// Struct to hold CPU-side geometry before it is uploaded
+struct MeshData {
+    std::vector<GLfloat> vertices;  // FLOATS_PER_VERTEX floats per vertex
+    std::vector<GLuint> indices;    // triangle list
+};
+
+// Struct to hold a mesh suballocated from a GLGeometryArena
 struct GLMesh {
-    GLuint vao;
-    GLuint vbos[2];
-    GLuint nIndices;
+    GLuint nIndices;           // number of indices
+    GLenum indexType;          // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLuint firstIndex;         // offset of the first index in the index buffer
+    GLint baseVertex;          // offset added to every index
+    glm::vec3 boundsMin;       // object-space axis-aligned bounding box
+    glm::vec3 boundsMax;
+    glm::vec3 boundsCenter;    // object-space bounding sphere (centered on the box)
+    float boundsRadius;
+    glm::vec3 positionScale;   // stored position * positionScale + positionBias = object position
+    glm::vec3 positionBias;    // (1 and 0 unless the vertices are quantized)
+    glm::vec2 texCoordScale;   // stored texture coordinate * texCoordScale + texCoordBias = texture coordinate
+    glm::vec2 texCoordBias;
 };
 
 // Function declarations
-void UCreateCylinder(GLMesh& mesh);
-void UCreateCube(GLMesh& mesh);
-void UCreateSphere(GLMesh& mesh);
-void UCreatePlane(GLMesh& mesh);
-void UDestroyMesh(GLMesh& mesh);
\ No newline at end of file
+void UBuildCylinder(MeshData& data, int segments = 36);
+void UBuildCube(MeshData& data);
+void UBuildSphere(MeshData& data, unsigned int numSegments = 16);
+void UBuildPlane(MeshData& data);
+glm::mat3 UComputeNormalMatrix(const glm::mat4& model);
+GLInstance UMakeInstance(const glm::mat4& model, GLuint layer);
+GLInstance UMakeMeshInstance(const GLMesh& mesh, const glm::mat4& model, GLuint layer);
+void UComputeMeshBounds(const MeshData& data, GLMesh& mesh);
+GLenum UChooseIndexType(size_t vertexCount);
+GLsizei UIndexSize(GLenum indexType);
+void UEncodeIndices(const std::vector<GLuint>& indices, GLenum indexType, std::vector<unsigned char>& bytes);
+void UBindInstanceAttributes(GLuint instanceBuffer);
\ No newline at end of file
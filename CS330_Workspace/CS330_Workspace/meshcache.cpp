@@ -0,0 +1,352 @@
+#include "meshcache.h"
+#include "cpuprofiler.h"
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+using namespace std;
+
+// unnamed namespace to hold the file layout helpers
+namespace
+{
+    /**
+     * @brief Rounds an offset up to the next multiple of MESH_CACHE_ALIGNMENT.
+     */
+    uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+    }
+
+    /**
+     * @brief Returns true if count elements of a given size at offset fit inside the file.
+     */
+    bool rangeInFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+    {
+        return offset <= fileSize && count * elementSize <= fileSize - offset;
+    }
+
+    /**
+     * @brief Returns true if every index of a blob names one of the level's vertices.
+     */
+    template <typename Index>
+    bool indicesInRange(const unsigned char* blob, uint32_t indexCount, uint32_t vertexCount)
+    {
+        const Index* indices = (const Index*)blob;
+        for (uint32_t i = 0; i < indexCount; ++i)
+            if (indices[i] >= vertexCount)
+                return false;
+        return true;
+    }
+
+    /**
+     * @brief Describes a vertex format the way mesh cache files record it.
+     */
+    MeshCacheFormatRecord formatRecord(const VertexFormat& format)
+    {
+        MeshCacheFormatRecord record;
+        memset(&record, 0, sizeof(record));
+        record.id = format.id;
+        record.stride = format.stride;
+        record.positionStride = format.positionStride;
+        for (int i = 0; i < 3; ++i)
+        {
+            const VertexAttribute& attribute = format.attributes[i];
+            record.attributes[i].location = attribute.location;
+            record.attributes[i].components = attribute.components;
+            record.attributes[i].type = attribute.type;
+            record.attributes[i].normalized = attribute.normalized;
+            record.attributes[i].offset = attribute.offset;
+        }
+        return record;
+    }
+
+    /**
+     * @brief Writes zero bytes up to an offset.
+     */
+    void padTo(ofstream& out, uint32_t offset)
+    {
+        static const char zeros[MESH_CACHE_ALIGNMENT] = {};
+        streamoff position = out.tellp();
+        if (position >= 0 && position < (streamoff)offset)
+            out.write(zeros, (streamsize)(offset - position));
+    }
+}
+
+
+/**
+ * @brief Returns the path a mesh cache key is stored at.
+ *
+ * Characters that are not letters, digits, '-', or '.' become '_'. The key
+ * itself is also stored in the file, so two keys that map to the same name
+ * cannot be mistaken for each other.
+ *
+ * @param directory The mesh cache directory.
+ * @param key The generator and parameters of the mesh.
+ * @return The file path.
+ */
+string UMeshCachePath(const char* directory, const string& key)
+{
+    string name = key;
+    for (char& c : name)
+    {
+        if (!isalnum((unsigned char)c) && c != '-' && c != '.')
+            c = '_';
+    }
+    return string(directory) + "/" + name + ".mesh";
+}
+
+/**
+ * @brief Creates the mesh cache directory if it does not exist yet.
+ *
+ * @param directory The directory to create.
+ * @return True if the directory exists afterwards, otherwise false.
+ */
+bool UCreateMeshCacheDirectory(const char* directory)
+{
+#ifdef _WIN32
+    struct _stat info;
+    if (_stat(directory, &info) == 0 && (info.st_mode & _S_IFDIR))
+        return true;
+    if (_mkdir(directory) == 0)
+        return true;
+#else
+    struct stat info;
+    if (stat(directory, &info) == 0 && S_ISDIR(info.st_mode))
+        return true;
+    if (mkdir(directory, 0755) == 0)
+        return true;
+#endif
+
+    cout << "ERROR::MESH_CACHE::DIRECTORY_FAILED " << directory << endl;
+    return false;
+}
+
+/**
+ * @brief Encodes a mesh's levels and writes them to a mesh cache file.
+ *
+ * The file holds a header with the key and the vertex format descriptor, a
+ * level table, and for every level its vertex, position, and index blobs,
+ * each aligned to MESH_CACHE_ALIGNMENT. The blobs are exactly what the
+ * geometry arena stores, so UOpenMeshCache can hand them to it unchanged:
+ * vertices in the given format and indices in the smallest type that fits.
+ *
+ * @param filename The path of the file to create.
+ * @param key The generator and parameters the levels were built from.
+ * @param format The layout to encode the vertices in.
+ * @param levels The levels' geometry, finest first, already optimized.
+ * @param segments The levels' tessellations.
+ * @return True if every level fit the format and the file was written, otherwise false.
+ */
+bool UWriteMeshCache(const char* filename, const string& key, const VertexFormat& format,
+    const vector<MeshData>& levels, const vector<unsigned int>& segments)
+{
+    CPU_ZONE("UWriteMeshCache");
+
+    if (key.size() >= (size_t)MESH_CACHE_KEY_LENGTH)
+    {
+        cout << "ERROR::MESH_CACHE::KEY_TOO_LONG " << key << endl;
+        return false;
+    }
+
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    memcpy(header.key, key.c_str(), key.size());
+    header.format = formatRecord(format);
+    header.levelCount = (uint32_t)levels.size();
+    header.levelOffset = sizeof(MeshCacheHeader);
+
+    // Encode every level first so the level table can record the blob offsets
+    vector<EncodedVertices> encoded(levels.size());
+    vector<vector<unsigned char>> indices(levels.size());
+    vector<MeshCacheLevelRecord> records(levels.size());
+    uint64_t offset = header.levelOffset + sizeof(MeshCacheLevelRecord) * levels.size();
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        const MeshData& data = levels[i];
+        UEncodeVertices(format, data, encoded[i]);
+
+        MeshCacheLevelRecord& record = records[i];
+        memset(&record, 0, sizeof(record));
+        record.segments = segments[i];
+        record.vertexCount = (uint32_t)(data.vertices.size() / FLOATS_PER_VERTEX);
+        record.indexCount = (uint32_t)data.indices.size();
+        record.indexType = UChooseIndexType(record.vertexCount);
+        UEncodeIndices(data.indices, record.indexType, indices[i]);
+
+        // Offsets are 32-bit, so a file holds at most 4 GB
+        uint64_t vertexOffset = alignOffset(offset);
+        uint64_t positionOffset = alignOffset(vertexOffset + encoded[i].vertices.size());
+        uint64_t indexOffset = alignOffset(positionOffset + encoded[i].positions.size());
+        offset = indexOffset + indices[i].size();
+        if (offset > 0xFFFFFFFFu)
+        {
+            cout << "ERROR::MESH_CACHE::TOO_LARGE " << filename << endl;
+            return false;
+        }
+        record.vertexOffset = (uint32_t)vertexOffset;
+        record.positionOffset = (uint32_t)positionOffset;
+        record.indexOffset = (uint32_t)indexOffset;
+
+        GLMesh bounds;
+        UComputeMeshBounds(data, bounds);
+        memcpy(record.positionScale, &encoded[i].positionScale, sizeof(record.positionScale));
+        memcpy(record.positionBias, &encoded[i].positionBias, sizeof(record.positionBias));
+        memcpy(record.texCoordScale, &encoded[i].texCoordScale, sizeof(record.texCoordScale));
+        memcpy(record.texCoordBias, &encoded[i].texCoordBias, sizeof(record.texCoordBias));
+        memcpy(record.boundsMin, &bounds.boundsMin, sizeof(record.boundsMin));
+        memcpy(record.boundsMax, &bounds.boundsMax, sizeof(record.boundsMax));
+        memcpy(record.boundsCenter, &bounds.boundsCenter, sizeof(record.boundsCenter));
+        record.boundsRadius = bounds.boundsRadius;
+    }
+
+    ofstream out(filename, ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)records.data(), sizeof(MeshCacheLevelRecord) * records.size());
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        padTo(out, records[i].vertexOffset);
+        out.write((const char*)encoded[i].vertices.data(), encoded[i].vertices.size());
+        padTo(out, records[i].positionOffset);
+        out.write((const char*)encoded[i].positions.data(), encoded[i].positions.size());
+        padTo(out, records[i].indexOffset);
+        out.write((const char*)indices[i].data(), indices[i].size());
+    }
+
+    if (!out)
+    {
+        cout << "ERROR::MESH_CACHE::WRITE_FAILED " << filename << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Maps a mesh cache file and checks that it matches what the caller would build.
+ *
+ * A missing file is a silent miss. A file written by another version, for
+ * another key, in another vertex format, cut short, or with an index past
+ * its level's vertices is reported and rejected, and the caller rebuilds the
+ * mesh. Nothing is copied: the indices are checked in place, and the level
+ * records and blobs are read straight out of the mapping, which stays open
+ * until UCloseMeshCache.
+ *
+ * @param filename The path of the file to open.
+ * @param key The generator and parameters the caller would build the mesh from.
+ * @param format The layout the caller stores vertices in.
+ * @param cache The MeshCache structure to hold the mapping.
+ * @return True if the file is a valid cache of the key in the format, otherwise false.
+ */
+bool UOpenMeshCache(const char* filename, const string& key, const VertexFormat& format, MeshCache& cache)
+{
+    CPU_ZONE("UOpenMeshCache");
+
+    cache.header = nullptr;
+    cache.levels = nullptr;
+    cache.levelCount = 0;
+    cache.file.data = nullptr;
+    cache.file.size = 0;
+    cache.file.fileHandle = nullptr;
+    cache.file.mappingHandle = nullptr;
+
+    // A cache that was never written is not an error
+    if (!ifstream(filename, ios::binary))
+        return false;
+
+    if (!UOpenMappedFile(filename, cache.file))
+        return false;
+
+    const MappedFile& file = cache.file;
+    const MeshCacheHeader* header = (const MeshCacheHeader*)file.data;
+    MeshCacheFormatRecord expected = formatRecord(format);
+
+    bool valid = file.size >= sizeof(MeshCacheHeader) && header->magic == MESH_CACHE_MAGIC &&
+        header->version == MESH_CACHE_VERSION &&
+        strncmp(header->key, key.c_str(), MESH_CACHE_KEY_LENGTH) == 0 &&
+        memcmp(&header->format, &expected, sizeof(expected)) == 0 &&
+        header->levelOffset % sizeof(uint32_t) == 0 &&
+        rangeInFile(header->levelOffset, header->levelCount, sizeof(MeshCacheLevelRecord), file.size);
+
+    const MeshCacheLevelRecord* levels = valid ? (const MeshCacheLevelRecord*)(file.data + header->levelOffset) : nullptr;
+    for (uint32_t i = 0; valid && i < header->levelCount; ++i)
+    {
+        const MeshCacheLevelRecord& level = levels[i];
+        valid = (level.indexType == GL_UNSIGNED_SHORT || level.indexType == GL_UNSIGNED_INT) &&
+            level.vertexOffset % MESH_CACHE_ALIGNMENT == 0 &&
+            level.positionOffset % MESH_CACHE_ALIGNMENT == 0 &&
+            level.indexOffset % MESH_CACHE_ALIGNMENT == 0 &&
+            rangeInFile(level.vertexOffset, level.vertexCount, format.stride, file.size) &&
+            rangeInFile(level.positionOffset, level.vertexCount, format.positionStride, file.size) &&
+            rangeInFile(level.indexOffset, level.indexCount, UIndexSize(level.indexType), file.size);
+
+        // The indices go straight to the GPU, so one past the level's vertices would read another mesh
+        if (valid)
+            valid = level.indexType == GL_UNSIGNED_SHORT ?
+                indicesInRange<GLushort>(file.data + level.indexOffset, level.indexCount, level.vertexCount) :
+                indicesInRange<GLuint>(file.data + level.indexOffset, level.indexCount, level.vertexCount);
+    }
+
+    if (!valid)
+    {
+        cout << "ERROR::MESH_CACHE::STALE " << filename << endl;
+        UCloseMeshCache(cache);
+        return false;
+    }
+
+    cache.header = header;
+    cache.levels = levels;
+    cache.levelCount = header->levelCount;
+    return true;
+}
+
+/**
+ * @brief Describes one level of an open mesh cache for UArenaAddEncodedMesh.
+ *
+ * @param cache The MeshCache structure holding the mapping.
+ * @param level The level, finest first.
+ * @return A view whose streams point into the mapping.
+ */
+EncodedMeshView UMeshCacheLevel(const MeshCache& cache, uint32_t level)
+{
+    const MeshCacheLevelRecord& record = cache.levels[level];
+
+    EncodedMeshView view;
+    view.vertices = cache.file.data + record.vertexOffset;
+    view.positions = cache.file.data + record.positionOffset;
+    view.indices = cache.file.data + record.indexOffset;
+    view.indexType = record.indexType;
+    view.vertexCount = (GLsizei)record.vertexCount;
+    view.indexCount = (GLsizei)record.indexCount;
+    view.positionScale = glm::vec3(record.positionScale[0], record.positionScale[1], record.positionScale[2]);
+    view.positionBias = glm::vec3(record.positionBias[0], record.positionBias[1], record.positionBias[2]);
+    view.texCoordScale = glm::vec2(record.texCoordScale[0], record.texCoordScale[1]);
+    view.texCoordBias = glm::vec2(record.texCoordBias[0], record.texCoordBias[1]);
+    view.boundsMin = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+    view.boundsMax = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+    view.boundsCenter = glm::vec3(record.boundsCenter[0], record.boundsCenter[1], record.boundsCenter[2]);
+    view.boundsRadius = record.boundsRadius;
+    return view;
+}
+
+/**
+ * @brief Unmaps a mesh cache opened by UOpenMeshCache.
+ *
+ * Views returned by UMeshCacheLevel become invalid; meshes already added to
+ * an arena are not affected.
+ *
+ * @param cache The MeshCache structure to be closed.
+ */
+void UCloseMeshCache(MeshCache& cache)
+{
+    UCloseMappedFile(cache.file);
+    cache.header = nullptr;
+    cache.levels = nullptr;
+    cache.levelCount = 0;
+}
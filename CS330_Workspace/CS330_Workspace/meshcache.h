@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "mappedfile.h"
+#include "mesh.h"
+#include "vertexformat.h"
+
+// Mesh cache files start with MESH_CACHE_MAGIC ("MSH1" in file order)
+const uint32_t MESH_CACHE_MAGIC = 0x3148534D;
+
+// Bump whenever the generators, the optimizer, or the layout below change, so stale caches are rebuilt
+const uint32_t MESH_CACHE_VERSION = 2;
+
+// Every blob starts on a multiple of this many bytes
+const uint32_t MESH_CACHE_ALIGNMENT = 64;
+
+const int MESH_CACHE_KEY_LENGTH = 128;
+
+// A mesh cache file is a MeshCacheHeader, its level table, and the blobs the
+// table points to. UOpenMeshCache uses the header and table straight from the
+// mapping, so the fields below stay 4-byte aligned with nothing implicit
+// between them; change any of them and MESH_CACHE_VERSION must change too.
+
+// Struct to hold one attribute of the vertex format the blobs are encoded in
+struct MeshCacheAttributeRecord {
+    uint32_t location;
+    uint32_t components;
+    uint32_t type;              // GL component type
+    uint32_t normalized;
+    uint32_t offset;            // bytes from the start of the vertex
+};
+
+// Struct to hold the vertex format the blobs are encoded in
+struct MeshCacheFormatRecord {
+    uint32_t id;                // VertexFormatId
+    uint32_t stride;
+    uint32_t positionStride;
+    MeshCacheAttributeRecord attributes[3];
+};
+
+// Struct to hold one level of detail; offsets are from the start of the file
+struct MeshCacheLevelRecord {
+    uint32_t segments;          // the level's tessellation (0 for untessellated meshes)
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexType;         // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t vertexOffset;      // vertexCount * stride bytes
+    uint32_t positionOffset;    // vertexCount * positionStride bytes
+    uint32_t indexOffset;       // indexCount indices of indexType
+    float positionScale[3];     // object position = stored position * scale + bias
+    float positionBias[3];
+    float texCoordScale[2];     // texture coordinate = stored coordinate * scale + bias
+    float texCoordBias[2];
+    float boundsMin[3];
+    float boundsMax[3];
+    float boundsCenter[3];
+    float boundsRadius;
+};
+
+// Struct to hold the header of a mesh cache file
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    char key[MESH_CACHE_KEY_LENGTH];  // the generator and parameters the file was built from
+    MeshCacheFormatRecord format;
+    uint32_t levelCount;
+    uint32_t levelOffset;       // levelCount MeshCacheLevelRecord records, finest first
+};
+
+// Struct to hold an open mesh cache; the records and blobs point into the file mapping
+struct MeshCache {
+    const MeshCacheHeader* header;
+    const MeshCacheLevelRecord* levels;
+    uint32_t levelCount;
+    MappedFile file;
+};
+
+std::string UMeshCachePath(const char* directory, const std::string& key);
+bool UCreateMeshCacheDirectory(const char* directory);
+bool UWriteMeshCache(const char* filename, const std::string& key, const VertexFormat& format,
+    const std::vector<MeshData>& levels, const std::vector<unsigned int>& segments);
+bool UOpenMeshCache(const char* filename, const std::string& key, const VertexFormat& format, MeshCache& cache);
+EncodedMeshView UMeshCacheLevel(const MeshCache& cache, uint32_t level);
+void UCloseMeshCache(MeshCache& cache);
@@ -0,0 +1,1188 @@
+#include "meshimport.h"
+#include "cpuprofiler.h"
+#include "mappedfile.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+using namespace std;
+
+// unnamed namespace to hold the OBJ tokenizer and the glTF reader
+namespace
+{
+    // Struct to hold one OBJ face corner: its position, texture coordinate, and normal indices (-1 if absent)
+    struct ObjCorner {
+        int position;
+        int texCoord;
+        int normal;
+
+        bool operator==(const ObjCorner& other) const
+        {
+            return position == other.position && texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+
+    // Hashes an ObjCorner by combining its indices
+    struct ObjCornerHash {
+        size_t operator()(const ObjCorner& corner) const
+        {
+            size_t seed = hash<int>()(corner.position);
+            seed ^= hash<int>()(corner.texCoord) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            seed ^= hash<int>()(corner.normal) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    /**
+     * @brief Skips spaces, tabs, and carriage returns.
+     */
+    const char* skipSpaces(const char* p, const char* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+        return p;
+    }
+
+    /**
+     * @brief Parses a float at the cursor with from_chars and moves past it.
+     */
+    bool parseFloat(const char*& p, const char* end, float& value)
+    {
+        p = skipSpaces(p, end);
+        if (p < end && *p == '+')
+            ++p;
+        from_chars_result result = from_chars(p, end, value);
+        if (result.ec != errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    /**
+     * @brief Parses an OBJ index at the cursor and resolves it against the element count.
+     *
+     * OBJ indices count from 1, and negative ones count back from the last element.
+     *
+     * @return False if the index is malformed or out of range.
+     */
+    bool parseObjIndex(const char*& p, const char* end, size_t count, int& index)
+    {
+        long value = 0;
+        from_chars_result result = from_chars(p, end, value);
+        if (result.ec != errc() || value == 0)
+            return false;
+        p = result.ptr;
+
+        long resolved = value > 0 ? value - 1 : (long)count + value;
+        if (resolved < 0 || resolved >= (long)count)
+            return false;
+        index = (int)resolved;
+        return true;
+    }
+
+    /**
+     * @brief Adds a triangle's area-weighted normal to each of its corners' accumulators.
+     */
+    void accumulateFaceNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+        glm::vec3& na, glm::vec3& nb, glm::vec3& nc)
+    {
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        na += normal;
+        nb += normal;
+        nc += normal;
+    }
+
+    /**
+     * @brief Normalizes an accumulated normal, falling back to +Y for degenerate ones.
+     */
+    glm::vec3 finishNormal(const glm::vec3& sum)
+    {
+        float length = glm::length(sum);
+        return length > 0.0f ? sum / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    /**
+     * @brief Appends one vertex in the standard layout.
+     */
+    void appendVertex(MeshData& data, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoord)
+    {
+        GLfloat vertex[FLOATS_PER_VERTEX] = {
+            position.x, position.y, position.z,
+            normal.x, normal.y, normal.z,
+            texCoord.x, texCoord.y
+        };
+        data.vertices.insert(data.vertices.end(), vertex, vertex + FLOATS_PER_VERTEX);
+    }
+
+    // Struct to hold one parsed JSON value; only the fields of its type are set
+    struct JsonValue {
+        enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+        Type type = NUL;
+        bool boolean = false;
+        double number = 0.0;
+        string text;
+        vector<string> keys;        // object member names, parallel to items
+        vector<JsonValue> items;    // array elements or object member values
+    };
+
+    // Struct to hold the cursor of the JSON parser
+    struct JsonParser {
+        const char* p;
+        const char* end;
+        int depth;
+    };
+
+    // Deepest nesting the JSON parser accepts, so malformed files cannot exhaust the stack
+    const int JSON_MAX_DEPTH = 64;
+
+    /**
+     * @brief Skips JSON whitespace.
+     */
+    void skipJsonSpaces(JsonParser& parser)
+    {
+        while (parser.p < parser.end && isspace((unsigned char)*parser.p))
+            ++parser.p;
+    }
+
+    /**
+     * @brief Appends a code point to a string as UTF-8.
+     */
+    void appendUtf8(string& text, unsigned int code)
+    {
+        if (code < 0x80)
+            text += (char)code;
+        else if (code < 0x800)
+        {
+            text += (char)(0xC0 | (code >> 6));
+            text += (char)(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000)
+        {
+            text += (char)(0xE0 | (code >> 12));
+            text += (char)(0x80 | ((code >> 6) & 0x3F));
+            text += (char)(0x80 | (code & 0x3F));
+        }
+        else
+        {
+            text += (char)(0xF0 | (code >> 18));
+            text += (char)(0x80 | ((code >> 12) & 0x3F));
+            text += (char)(0x80 | ((code >> 6) & 0x3F));
+            text += (char)(0x80 | (code & 0x3F));
+        }
+    }
+
+    /**
+     * @brief Parses four hexadecimal digits of a \u escape.
+     */
+    bool parseHex4(JsonParser& parser, unsigned int& code)
+    {
+        if (parser.end - parser.p < 4)
+            return false;
+        from_chars_result result = from_chars(parser.p, parser.p + 4, code, 16);
+        if (result.ec != errc() || result.ptr != parser.p + 4)
+            return false;
+        parser.p += 4;
+        return true;
+    }
+
+    /**
+     * @brief Parses a JSON string, the cursor being on its opening quote.
+     */
+    bool parseJsonString(JsonParser& parser, string& text)
+    {
+        ++parser.p;
+        text.clear();
+        while (parser.p < parser.end && *parser.p != '"')
+        {
+            char c = *parser.p++;
+            if (c != '\\')
+            {
+                text += c;
+                continue;
+            }
+            if (parser.p >= parser.end)
+                return false;
+
+            char escape = *parser.p++;
+            unsigned int code = 0;
+            switch (escape)
+            {
+            case 'b': text += '\b'; break;
+            case 'f': text += '\f'; break;
+            case 'n': text += '\n'; break;
+            case 'r': text += '\r'; break;
+            case 't': text += '\t'; break;
+            case 'u':
+                if (!parseHex4(parser, code))
+                    return false;
+                // A high surrogate must be followed by the low one
+                if (code >= 0xD800 && code < 0xDC00)
+                {
+                    unsigned int low = 0;
+                    if (parser.end - parser.p < 2 || parser.p[0] != '\\' || parser.p[1] != 'u')
+                        return false;
+                    parser.p += 2;
+                    if (!parseHex4(parser, low) || low < 0xDC00 || low >= 0xE000)
+                        return false;
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(text, code);
+                break;
+            default:
+                text += escape;
+                break;
+            }
+        }
+        if (parser.p >= parser.end)
+            return false;
+        ++parser.p;
+        return true;
+    }
+
+    /**
+     * @brief Parses one JSON value at the cursor.
+     */
+    bool parseJsonValue(JsonParser& parser, JsonValue& value)
+    {
+        skipJsonSpaces(parser);
+        if (parser.p >= parser.end || parser.depth > JSON_MAX_DEPTH)
+            return false;
+
+        char c = *parser.p;
+        if (c == '{' || c == '[')
+        {
+            bool object = c == '{';
+            char close = object ? '}' : ']';
+            value.type = object ? JsonValue::OBJECT : JsonValue::ARRAY;
+            ++parser.p;
+            ++parser.depth;
+
+            skipJsonSpaces(parser);
+            if (parser.p < parser.end && *parser.p == close)
+            {
+                ++parser.p;
+                --parser.depth;
+                return true;
+            }
+
+            while (true)
+            {
+                if (object)
+                {
+                    skipJsonSpaces(parser);
+                    value.keys.emplace_back();
+                    if (parser.p >= parser.end || *parser.p != '"' || !parseJsonString(parser, value.keys.back()))
+                        return false;
+                    skipJsonSpaces(parser);
+                    if (parser.p >= parser.end || *parser.p++ != ':')
+                        return false;
+                }
+
+                value.items.emplace_back();
+                if (!parseJsonValue(parser, value.items.back()))
+                    return false;
+
+                skipJsonSpaces(parser);
+                if (parser.p >= parser.end)
+                    return false;
+                char next = *parser.p++;
+                if (next == close)
+                    break;
+                if (next != ',')
+                    return false;
+            }
+
+            --parser.depth;
+            return true;
+        }
+
+        if (c == '"')
+        {
+            value.type = JsonValue::STRING;
+            return parseJsonString(parser, value.text);
+        }
+
+        static const char* const LITERALS[] = { "true", "false", "null" };
+        for (int i = 0; i < 3; ++i)
+        {
+            size_t length = strlen(LITERALS[i]);
+            if ((size_t)(parser.end - parser.p) >= length && memcmp(parser.p, LITERALS[i], length) == 0)
+            {
+                value.type = i == 2 ? JsonValue::NUL : JsonValue::BOOLEAN;
+                value.boolean = i == 0;
+                parser.p += length;
+                return true;
+            }
+        }
+
+        value.type = JsonValue::NUMBER;
+        from_chars_result result = from_chars(parser.p, parser.end, value.number);
+        if (result.ec != errc())
+            return false;
+        parser.p = result.ptr;
+        return true;
+    }
+
+    /**
+     * @brief Returns an object's member, or nullptr if the value is not an object or has no such member.
+     */
+    const JsonValue* member(const JsonValue* object, const char* key)
+    {
+        if (!object || object->type != JsonValue::OBJECT)
+            return nullptr;
+        for (size_t i = 0; i < object->keys.size(); ++i)
+        {
+            if (object->keys[i] == key)
+                return &object->items[i];
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Returns an array's element, or nullptr if the value is not an array or is too short.
+     */
+    const JsonValue* element(const JsonValue* array, size_t index)
+    {
+        if (!array || array->type != JsonValue::ARRAY || index >= array->items.size())
+            return nullptr;
+        return &array->items[index];
+    }
+
+    /**
+     * @brief Reads a JSON number as an index, count, or byte offset.
+     *
+     * Missing values give the fallback. Doubles are only converted once they
+     * are known to be whole numbers that a size_t holds and a double stores
+     * exactly (below 2^53).
+     *
+     * @return False if the value is present but not such a number.
+     */
+    bool sizeOr(const JsonValue* value, size_t fallback, size_t& result)
+    {
+        result = fallback;
+        if (!value)
+            return true;
+
+        double number = value->type == JsonValue::NUMBER ? value->number : -1.0;
+        if (!(number >= 0.0) || number >= 9007199254740992.0 || number > (double)SIZE_MAX || number != floor(number))
+            return false;
+
+        result = (size_t)number;
+        return true;
+    }
+
+    /**
+     * @brief Reads a JSON array of numbers into floats.
+     */
+    bool readNumbers(const JsonValue* array, float* out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const JsonValue* number = element(array, i);
+            if (!number || number->type != JsonValue::NUMBER)
+                return false;
+            out[i] = (float)number->number;
+        }
+        return true;
+    }
+
+    // Struct to hold a byte range the accessors read from
+    struct BufferSpan {
+        const unsigned char* data;
+        size_t size;
+    };
+
+    // Struct to hold a glTF document and the buffers its accessors read from
+    struct GltfFile {
+        JsonValue json;
+        vector<BufferSpan> buffers;
+        MappedFile file;                        // the .gltf or .glb file
+        vector<MappedFile> externalFiles;       // .bin buffers, mapped
+        vector<vector<unsigned char>> decoded;  // base64 data URI buffers
+    };
+
+    // glTF accessor component types
+    const int GLTF_BYTE = 5120;
+    const int GLTF_UNSIGNED_BYTE = 5121;
+    const int GLTF_SHORT = 5122;
+    const int GLTF_UNSIGNED_SHORT = 5123;
+    const int GLTF_UNSIGNED_INT = 5125;
+    const int GLTF_FLOAT = 5126;
+
+    // glTF primitive mode for triangle lists
+    const int GLTF_TRIANGLES = 4;
+
+    /**
+     * @brief Returns the size in bytes of a glTF component type, or 0 if it is unknown.
+     */
+    size_t componentSize(int componentType)
+    {
+        switch (componentType)
+        {
+        case GLTF_BYTE:
+        case GLTF_UNSIGNED_BYTE:
+            return 1;
+        case GLTF_SHORT:
+        case GLTF_UNSIGNED_SHORT:
+            return 2;
+        case GLTF_UNSIGNED_INT:
+        case GLTF_FLOAT:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Decodes the base64 payload of a data URI.
+     */
+    bool decodeDataUri(const string& uri, vector<unsigned char>& bytes)
+    {
+        size_t start = uri.find(";base64,");
+        if (start == string::npos)
+            return false;
+
+        unsigned int bits = 0;
+        int bitCount = 0;
+        for (size_t i = start + 8; i < uri.size() && uri[i] != '='; ++i)
+        {
+            char c = uri[i];
+            int sextet = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 :
+                c >= '0' && c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+            if (sextet < 0)
+                return false;
+
+            bits = (bits << 6) | (unsigned int)sextet;
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                bytes.push_back((unsigned char)(bits >> bitCount));
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Unmaps a glTF file and its external buffers.
+     */
+    void closeGltf(GltfFile& gltf)
+    {
+        for (MappedFile& external : gltf.externalFiles)
+            UCloseMappedFile(external);
+        gltf.externalFiles.clear();
+        UCloseMappedFile(gltf.file);
+    }
+
+    /**
+     * @brief Maps a .gltf or .glb file, parses its JSON, and resolves its buffers.
+     *
+     * GLB binary chunks and external .bin files stay memory mapped and are read
+     * in place; only base64 data URIs are decoded into memory.
+     */
+    bool openGltf(const char* filename, GltfFile& gltf)
+    {
+        if (!UOpenMappedFile(filename, gltf.file))
+            return false;
+
+        const unsigned char* json = gltf.file.data;
+        size_t jsonSize = gltf.file.size;
+        BufferSpan binChunk = { nullptr, 0 };
+
+        // GLB: a 12-byte header, a JSON chunk, and an optional binary chunk
+        uint32_t magic = 0;
+        if (gltf.file.size >= sizeof(magic))
+            memcpy(&magic, gltf.file.data, sizeof(magic));
+        if (magic == GLB_MAGIC)
+        {
+            uint32_t header[3];
+            uint32_t chunk[2];
+            if (gltf.file.size < sizeof(header) + sizeof(chunk))
+                return false;
+            memcpy(header, gltf.file.data, sizeof(header));
+            memcpy(chunk, gltf.file.data + sizeof(header), sizeof(chunk));
+            if (header[1] != 2 || chunk[1] != 0x4E4F534A || chunk[0] > gltf.file.size - sizeof(header) - sizeof(chunk))
+                return false;
+
+            json = gltf.file.data + sizeof(header) + sizeof(chunk);
+            jsonSize = chunk[0];
+
+            size_t binOffset = sizeof(header) + sizeof(chunk) + ((chunk[0] + 3) & ~3u);
+            if (binOffset + sizeof(chunk) <= gltf.file.size)
+            {
+                memcpy(chunk, gltf.file.data + binOffset, sizeof(chunk));
+                if (chunk[1] == 0x004E4942 && chunk[0] <= gltf.file.size - binOffset - sizeof(chunk))
+                    binChunk = { gltf.file.data + binOffset + sizeof(chunk), chunk[0] };
+            }
+        }
+
+        JsonParser parser = { (const char*)json, (const char*)json + jsonSize, 0 };
+        if (!parseJsonValue(parser, gltf.json) || gltf.json.type != JsonValue::OBJECT)
+        {
+            cout << "ERROR::IMPORT::GLTF_JSON_INVALID " << filename << endl;
+            return false;
+        }
+
+        // External buffers are relative to the directory of the glTF file
+        string path(filename);
+        size_t slash = path.find_last_of("/\\");
+        string directory = slash == string::npos ? string() : path.substr(0, slash + 1);
+
+        const JsonValue* buffers = member(&gltf.json, "buffers");
+        size_t bufferCount = buffers && buffers->type == JsonValue::ARRAY ? buffers->items.size() : 0;
+        gltf.decoded.reserve(bufferCount);
+        for (size_t i = 0; i < bufferCount; ++i)
+        {
+            const JsonValue* uri = member(element(buffers, i), "uri");
+            BufferSpan span = { nullptr, 0 };
+            if (!uri)
+                span = binChunk;
+            else if (uri->type == JsonValue::STRING && uri->text.compare(0, 5, "data:") == 0)
+            {
+                gltf.decoded.emplace_back();
+                if (!decodeDataUri(uri->text, gltf.decoded.back()))
+                {
+                    cout << "ERROR::IMPORT::GLTF_BUFFER_INVALID " << filename << endl;
+                    return false;
+                }
+                span = { gltf.decoded.back().data(), gltf.decoded.back().size() };
+            }
+            else if (uri->type == JsonValue::STRING)
+            {
+                gltf.externalFiles.emplace_back();
+                if (!UOpenMappedFile((directory + uri->text).c_str(), gltf.externalFiles.back()))
+                    return false;
+                span = { gltf.externalFiles.back().data, gltf.externalFiles.back().size };
+            }
+            gltf.buffers.push_back(span);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Finds the bytes of an accessor's elements.
+     *
+     * @param gltf The open glTF file.
+     * @param index The accessor index.
+     * @param components The number of components each element must have.
+     * @param first Receives the first element's bytes (nullptr for accessors without a buffer view).
+     * @param stride Receives the bytes between elements.
+     * @param componentType Receives the glTF component type.
+     * @param normalized Receives whether integer components map to [0, 1] or [-1, 1].
+     * @param count Receives the number of elements.
+     * @return False if the accessor is malformed, sparse, or reaches past its buffer.
+     */
+    bool findAccessor(const GltfFile& gltf, size_t index, int components, const unsigned char*& first,
+        size_t& stride, int& componentType, bool& normalized, size_t& count)
+    {
+        const JsonValue* accessor = element(member(&gltf.json, "accessors"), index);
+        const JsonValue* type = member(accessor, "type");
+        if (!accessor || member(accessor, "sparse") || !type || type->type != JsonValue::STRING)
+            return false;
+
+        int typeComponents = type->text == "SCALAR" ? 1 : type->text == "VEC2" ? 2 : type->text == "VEC3" ? 3 :
+            type->text == "VEC4" ? 4 : 0;
+        size_t typeId;
+        if (!sizeOr(member(accessor, "componentType"), 0, typeId) || !sizeOr(member(accessor, "count"), 0, count))
+            return false;
+        componentType = typeId <= 0xFFFF ? (int)typeId : 0;  // unknown types have no size
+        normalized = member(accessor, "normalized") && member(accessor, "normalized")->boolean;
+        size_t elementSize = componentSize(componentType) * typeComponents;
+        if (typeComponents != components || elementSize == 0)
+            return false;
+
+        first = nullptr;
+        stride = elementSize;
+        const JsonValue* viewIndex = member(accessor, "bufferView");
+        if (!viewIndex)
+            return true;
+
+        // A view without a buffer gets SIZE_MAX, which no buffer index matches
+        size_t viewNumber, buffer, viewOffset, viewLength, accessorOffset;
+        if (!sizeOr(viewIndex, 0, viewNumber))
+            return false;
+        const JsonValue* view = element(member(&gltf.json, "bufferViews"), viewNumber);
+        if (!view || !sizeOr(member(view, "buffer"), SIZE_MAX, buffer) || buffer >= gltf.buffers.size() ||
+            !sizeOr(member(view, "byteOffset"), 0, viewOffset) || !sizeOr(member(view, "byteLength"), 0, viewLength) ||
+            !sizeOr(member(accessor, "byteOffset"), 0, accessorOffset) || !sizeOr(member(view, "byteStride"), elementSize, stride))
+            return false;
+        const BufferSpan& span = gltf.buffers[buffer];
+
+        if (stride < elementSize || viewOffset > span.size || viewLength > span.size - viewOffset ||
+            (count > 0 && (accessorOffset > viewLength ||
+                (count - 1) * stride + elementSize > viewLength - accessorOffset)))
+            return false;
+
+        first = span.data + viewOffset + accessorOffset;
+        return true;
+    }
+
+    /**
+     * @brief Reads one component of an accessor element as a float.
+     */
+    float readComponent(const unsigned char* p, int componentType, bool normalized)
+    {
+        int8_t i8;
+        uint8_t u8;
+        int16_t i16;
+        uint16_t u16;
+        uint32_t u32;
+        float f;
+        switch (componentType)
+        {
+        case GLTF_BYTE:
+            memcpy(&i8, p, 1);
+            return normalized ? glm::max(i8 / 127.0f, -1.0f) : i8;
+        case GLTF_UNSIGNED_BYTE:
+            memcpy(&u8, p, 1);
+            return normalized ? u8 / 255.0f : u8;
+        case GLTF_SHORT:
+            memcpy(&i16, p, 2);
+            return normalized ? glm::max(i16 / 32767.0f, -1.0f) : i16;
+        case GLTF_UNSIGNED_SHORT:
+            memcpy(&u16, p, 2);
+            return normalized ? u16 / 65535.0f : u16;
+        case GLTF_UNSIGNED_INT:
+            memcpy(&u32, p, 4);
+            return (float)u32;
+        default:
+            memcpy(&f, p, 4);
+            return f;
+        }
+    }
+
+    /**
+     * @brief Reads one element of an index accessor.
+     */
+    GLuint readIndex(const unsigned char* p, int componentType)
+    {
+        uint8_t u8;
+        uint16_t u16;
+        uint32_t u32;
+        switch (componentType)
+        {
+        case GLTF_UNSIGNED_BYTE:
+            memcpy(&u8, p, 1);
+            return u8;
+        case GLTF_UNSIGNED_SHORT:
+            memcpy(&u16, p, 2);
+            return u16;
+        default:
+            memcpy(&u32, p, 4);
+            return u32;
+        }
+    }
+
+    /**
+     * @brief Reads an accessor's elements as floats, components per element.
+     */
+    bool readAccessor(const GltfFile& gltf, size_t index, int components, vector<float>& out)
+    {
+        const unsigned char* first;
+        size_t stride, count;
+        int componentType;
+        bool normalized;
+        if (!findAccessor(gltf, index, components, first, stride, componentType, normalized, count))
+            return false;
+
+        // Accessors without a buffer view are all zeros
+        out.assign(count * components, 0.0f);
+        if (!first)
+            return true;
+
+        size_t size = componentSize(componentType);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const unsigned char* p = first + i * stride;
+            for (int c = 0; c < components; ++c)
+                out[i * components + c] = readComponent(p + c * size, componentType, normalized);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads an index accessor.
+     */
+    bool readIndices(const GltfFile& gltf, size_t index, vector<GLuint>& out)
+    {
+        const unsigned char* first;
+        size_t stride, count;
+        int componentType;
+        bool normalized;
+        if (!findAccessor(gltf, index, 1, first, stride, componentType, normalized, count) || !first ||
+            (componentType != GLTF_UNSIGNED_BYTE && componentType != GLTF_UNSIGNED_SHORT && componentType != GLTF_UNSIGNED_INT))
+            return false;
+
+        out.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            out[i] = readIndex(first + i * stride, componentType);
+        return true;
+    }
+
+    /**
+     * @brief Appends one triangle primitive, transformed by its node's world matrix.
+     *
+     * Texture coordinates are flipped vertically, since glTF puts the origin at
+     * the top left of the image and the loaded textures are flipped for OpenGL.
+     * Primitives without normals get area-weighted smooth ones, and mirroring
+     * transforms flip the winding back to counter-clockwise.
+     *
+     * @return False if an accessor is malformed.
+     */
+    bool appendPrimitive(const GltfFile& gltf, const JsonValue& primitive, const glm::mat4& world, MeshData& data)
+    {
+        const JsonValue* attributes = member(&primitive, "attributes");
+        const JsonValue* position = member(attributes, "POSITION");
+        const JsonValue* normal = member(attributes, "NORMAL");
+        const JsonValue* texCoord = member(attributes, "TEXCOORD_0");
+        const JsonValue* indexAccessor = member(&primitive, "indices");
+
+        size_t positionIndex, normalIndex, texCoordIndex, indicesIndex;
+        if (!position || !sizeOr(position, 0, positionIndex) || !sizeOr(normal, 0, normalIndex) ||
+            !sizeOr(texCoord, 0, texCoordIndex) || !sizeOr(indexAccessor, 0, indicesIndex))
+            return false;
+
+        vector<float> positions, normals, texCoords;
+        if (!readAccessor(gltf, positionIndex, 3, positions))
+            return false;
+        size_t count = positions.size() / 3;
+
+        if (normal && (!readAccessor(gltf, normalIndex, 3, normals) || normals.size() != positions.size()))
+            return false;
+        if (texCoord && (!readAccessor(gltf, texCoordIndex, 2, texCoords) || texCoords.size() != count * 2))
+            return false;
+
+        vector<GLuint> indices;
+        if (indexAccessor)
+        {
+            if (!readIndices(gltf, indicesIndex, indices))
+                return false;
+        }
+        else
+        {
+            indices.resize(count);
+            for (size_t i = 0; i < count; ++i)
+                indices[i] = (GLuint)i;
+        }
+        indices.resize(indices.size() / 3 * 3);
+
+        for (GLuint index : indices)
+        {
+            if (index >= count)
+                return false;
+        }
+
+        // Smooth normals for primitives that come without them
+        if (normals.empty())
+        {
+            vector<glm::vec3> sums(count, glm::vec3(0.0f));
+            for (size_t t = 0; t < indices.size(); t += 3)
+            {
+                const GLuint* tri = &indices[t];
+                accumulateFaceNormal(glm::make_vec3(&positions[3 * tri[0]]), glm::make_vec3(&positions[3 * tri[1]]),
+                    glm::make_vec3(&positions[3 * tri[2]]), sums[tri[0]], sums[tri[1]], sums[tri[2]]);
+            }
+            normals.resize(count * 3);
+            for (size_t i = 0; i < count; ++i)
+                memcpy(&normals[3 * i], glm::value_ptr(finishNormal(sums[i])), sizeof(glm::vec3));
+        }
+
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+        bool mirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+
+        GLuint base = (GLuint)(data.vertices.size() / FLOATS_PER_VERTEX);
+        data.vertices.reserve(data.vertices.size() + count * FLOATS_PER_VERTEX);
+        for (size_t i = 0; i < count; ++i)
+        {
+            glm::vec3 p = glm::vec3(world * glm::vec4(glm::make_vec3(&positions[3 * i]), 1.0f));
+            glm::vec3 n = finishNormal(normalMatrix * glm::make_vec3(&normals[3 * i]));
+            glm::vec2 uv = texCoords.empty() ? glm::vec2(0.0f) : glm::vec2(texCoords[2 * i], 1.0f - texCoords[2 * i + 1]);
+            appendVertex(data, p, n, uv);
+        }
+
+        data.indices.reserve(data.indices.size() + indices.size());
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            data.indices.push_back(base + indices[t]);
+            data.indices.push_back(base + indices[t + (mirrored ? 2 : 1)]);
+            data.indices.push_back(base + indices[t + (mirrored ? 1 : 2)]);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Appends a mesh's triangle primitives; other primitive modes are counted and skipped.
+     */
+    bool appendMesh(const GltfFile& gltf, size_t index, const glm::mat4& world, MeshData& data, int& skipped)
+    {
+        const JsonValue* primitives = member(element(member(&gltf.json, "meshes"), index), "primitives");
+        if (!primitives || primitives->type != JsonValue::ARRAY)
+            return false;
+
+        for (const JsonValue& primitive : primitives->items)
+        {
+            size_t mode;
+            if (!sizeOr(member(&primitive, "mode"), GLTF_TRIANGLES, mode))
+                return false;
+            if (mode != (size_t)GLTF_TRIANGLES)
+            {
+                ++skipped;
+                continue;
+            }
+            if (!appendPrimitive(gltf, primitive, world, data))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns a node's local matrix, from its matrix or its translation, rotation, and scale.
+     */
+    glm::mat4 nodeMatrix(const JsonValue& node)
+    {
+        float values[16];
+        if (readNumbers(member(&node, "matrix"), values, 16))
+            return glm::make_mat4(values);
+
+        glm::vec3 translation(0.0f), scale(1.0f);
+        glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+        if (readNumbers(member(&node, "translation"), values, 3))
+            translation = glm::make_vec3(values);
+        if (readNumbers(member(&node, "rotation"), values, 4))
+            rotation = glm::quat(values[3], values[0], values[1], values[2]);
+        if (readNumbers(member(&node, "scale"), values, 3))
+            scale = glm::make_vec3(values);
+
+        return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+    }
+
+    /**
+     * @brief Appends the meshes of a node and its descendants.
+     */
+    bool appendNode(const GltfFile& gltf, size_t index, const glm::mat4& parent, int depth, MeshData& data, int& skipped)
+    {
+        const JsonValue* node = element(member(&gltf.json, "nodes"), index);
+        if (!node || depth > JSON_MAX_DEPTH)
+            return false;
+
+        glm::mat4 world = parent * nodeMatrix(*node);
+        const JsonValue* mesh = member(node, "mesh");
+        size_t meshIndex;
+        if (!sizeOr(mesh, 0, meshIndex) || (mesh && !appendMesh(gltf, meshIndex, world, data, skipped)))
+            return false;
+
+        const JsonValue* children = member(node, "children");
+        for (size_t i = 0; children && i < children->items.size(); ++i)
+        {
+            size_t child;
+            if (!sizeOr(&children->items[i], 0, child) || !appendNode(gltf, child, world, depth + 1, data, skipped))
+                return false;
+        }
+        return true;
+    }
+}
+
+
+/**
+ * @brief Imports a Wavefront OBJ file as one mesh.
+ *
+ * The file is memory mapped and tokenized in place, one line at a time;
+ * numbers are parsed with from_chars, so no line is ever copied into a string.
+ * Only v, vt, vn, and f records are read: polygons are split into triangle
+ * fans, and each distinct position/texture coordinate/normal combination
+ * becomes one vertex. Corners without a normal get an area-weighted smooth
+ * normal of their position.
+ *
+ * @param filename The path of the OBJ file.
+ * @param data The MeshData structure receiving the geometry.
+ * @return True if the file was read, otherwise false.
+ */
+bool UImportObj(const char* filename, MeshData& data)
+{
+    CPU_ZONE("UImportObj");
+
+    MappedFile file;
+    if (!UOpenMappedFile(filename, file))
+        return false;
+
+    vector<glm::vec3> positions;
+    vector<glm::vec3> normals;
+    vector<glm::vec2> texCoords;
+    unordered_map<ObjCorner, GLuint, ObjCornerHash> corners;
+    vector<ObjCorner> vertexCorners;     // the corner each vertex was made from
+    vector<GLuint> polygon;
+    bool missingNormals = false;
+
+    data.vertices.clear();
+    data.indices.clear();
+
+    const char* cursor = (const char*)file.data;
+    const char* end = cursor + file.size;
+    int lineNumber = 0;
+    bool valid = true;
+
+    while (cursor < end && valid)
+    {
+        const char* lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+        if (!lineEnd)
+            lineEnd = end;
+        const char* p = skipSpaces(cursor, lineEnd);
+        cursor = lineEnd + 1;
+        ++lineNumber;
+
+        const char* keyword = p;
+        while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+            ++p;
+        size_t keywordLength = p - keyword;
+
+        if (keywordLength == 1 && keyword[0] == 'v')
+        {
+            glm::vec3 position;
+            valid = parseFloat(p, lineEnd, position.x) && parseFloat(p, lineEnd, position.y) &&
+                parseFloat(p, lineEnd, position.z);
+            positions.push_back(position);
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+        {
+            glm::vec3 normal;
+            valid = parseFloat(p, lineEnd, normal.x) && parseFloat(p, lineEnd, normal.y) &&
+                parseFloat(p, lineEnd, normal.z);
+            normals.push_back(normal);
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+        {
+            // The second coordinate is optional; a third is ignored
+            glm::vec2 texCoord(0.0f);
+            valid = parseFloat(p, lineEnd, texCoord.x);
+            if (valid && skipSpaces(p, lineEnd) < lineEnd)
+                valid = parseFloat(p, lineEnd, texCoord.y);
+            texCoords.push_back(texCoord);
+        }
+        else if (keywordLength == 1 && keyword[0] == 'f')
+        {
+            // Each corner is v, v/vt, v//vn, or v/vt/vn
+            polygon.clear();
+            for (p = skipSpaces(p, lineEnd); valid && p < lineEnd; p = skipSpaces(p, lineEnd))
+            {
+                ObjCorner corner = { -1, -1, -1 };
+                valid = parseObjIndex(p, lineEnd, positions.size(), corner.position);
+                if (valid && p < lineEnd && *p == '/')
+                {
+                    ++p;
+                    if (p < lineEnd && *p != '/')
+                        valid = parseObjIndex(p, lineEnd, texCoords.size(), corner.texCoord);
+                    if (valid && p < lineEnd && *p == '/')
+                    {
+                        ++p;
+                        valid = parseObjIndex(p, lineEnd, normals.size(), corner.normal);
+                    }
+                }
+                if (!valid)
+                    break;
+
+                auto found = corners.find(corner);
+                if (found == corners.end())
+                {
+                    found = corners.emplace(corner, (GLuint)vertexCorners.size()).first;
+                    vertexCorners.push_back(corner);
+                    missingNormals = missingNormals || corner.normal < 0;
+                }
+                polygon.push_back(found->second);
+            }
+
+            valid = valid && polygon.size() >= 3;
+            for (size_t i = 2; valid && i < polygon.size(); ++i)
+            {
+                data.indices.push_back(polygon[0]);
+                data.indices.push_back(polygon[i - 1]);
+                data.indices.push_back(polygon[i]);
+            }
+        }
+    }
+
+    UCloseMappedFile(file);
+    if (!valid)
+    {
+        cout << "ERROR::IMPORT::OBJ_PARSE_FAILED " << filename << ":" << lineNumber << endl;
+        return false;
+    }
+
+    // Smooth normals per position, for corners that did not name one
+    vector<glm::vec3> smoothNormals;
+    if (missingNormals)
+    {
+        smoothNormals.assign(positions.size(), glm::vec3(0.0f));
+        for (size_t t = 0; t < data.indices.size(); t += 3)
+        {
+            int a = vertexCorners[data.indices[t]].position;
+            int b = vertexCorners[data.indices[t + 1]].position;
+            int c = vertexCorners[data.indices[t + 2]].position;
+            accumulateFaceNormal(positions[a], positions[b], positions[c], smoothNormals[a], smoothNormals[b], smoothNormals[c]);
+        }
+    }
+
+    data.vertices.reserve(vertexCorners.size() * FLOATS_PER_VERTEX);
+    for (const ObjCorner& corner : vertexCorners)
+    {
+        glm::vec3 normal = corner.normal >= 0 ? normals[corner.normal] : finishNormal(smoothNormals[corner.position]);
+        glm::vec2 texCoord = corner.texCoord >= 0 ? texCoords[corner.texCoord] : glm::vec2(0.0f);
+        appendVertex(data, positions[corner.position], normal, texCoord);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Imports the triangles of a glTF 2.0 file (.gltf or .glb) as one mesh.
+ *
+ * The file and its external buffers are memory mapped, and accessors are read
+ * straight out of the mappings. Every mesh reachable from the default scene
+ * is baked in with its node's world transform; files without scenes
+ * contribute every mesh untransformed. POSITION, NORMAL, and TEXCOORD_0 are
+ * read; materials, skins, morph targets, and sparse accessors are not.
+ *
+ * @param filename The path of the glTF or GLB file.
+ * @param data The MeshData structure receiving the geometry.
+ * @return True if the file was read, otherwise false.
+ */
+bool UImportGltf(const char* filename, MeshData& data)
+{
+    CPU_ZONE("UImportGltf");
+
+    data.vertices.clear();
+    data.indices.clear();
+
+    GltfFile gltf;
+    bool valid = openGltf(filename, gltf);
+    int skipped = 0;
+
+    size_t sceneIndex;
+    valid = valid && sizeOr(member(&gltf.json, "scene"), 0, sceneIndex);
+    const JsonValue* scene = valid ? element(member(&gltf.json, "scenes"), sceneIndex) : nullptr;
+    const JsonValue* roots = member(scene, "nodes");
+    if (valid && roots)
+    {
+        for (size_t i = 0; valid && i < roots->items.size(); ++i)
+        {
+            size_t root;
+            valid = sizeOr(&roots->items[i], 0, root) && appendNode(gltf, root, glm::mat4(1.0f), 0, data, skipped);
+        }
+    }
+    else if (valid)
+    {
+        const JsonValue* meshes = member(&gltf.json, "meshes");
+        for (size_t i = 0; valid && meshes && i < meshes->items.size(); ++i)
+            valid = appendMesh(gltf, i, glm::mat4(1.0f), data, skipped);
+    }
+
+    closeGltf(gltf);
+    if (!valid)
+    {
+        cout << "ERROR::IMPORT::GLTF_INVALID " << filename << endl;
+        return false;
+    }
+
+    if (skipped > 0)
+        cout << "INFO: Skipped " << skipped << " non-triangle primitives in " << filename << endl;
+    return true;
+}
+
+/**
+ * @brief Imports a model file, picking the importer by its extension.
+ *
+ * @param filename The path of an .obj, .gltf, or .glb file.
+ * @param data The MeshData structure receiving the geometry.
+ * @return True if the file was read and holds at least one triangle, otherwise false.
+ */
+bool UImportModel(const char* filename, MeshData& data)
+{
+    string extension(filename);
+    size_t dot = extension.find_last_of('.');
+    extension = dot == string::npos ? string() : extension.substr(dot + 1);
+    for (char& c : extension)
+        c = (char)tolower((unsigned char)c);
+
+    bool imported;
+    if (extension == "obj")
+        imported = UImportObj(filename, data);
+    else if (extension == "gltf" || extension == "glb")
+        imported = UImportGltf(filename, data);
+    else
+    {
+        cout << "ERROR::IMPORT::UNKNOWN_FORMAT " << filename << endl;
+        return false;
+    }
+
+    if (imported && data.indices.empty())
+    {
+        cout << "ERROR::IMPORT::NO_TRIANGLES " << filename << endl;
+        return false;
+    }
+    return imported;
+}
+
+/**
+ * @brief Returns the part of a mesh cache key that identifies a model file's contents.
+ *
+ * The key is the file's name, a hash of its full path, its size, and its
+ * modification time. Editing the file rebuilds its cache, and models with the
+ * same name in different directories get different caches. External glTF
+ * buffers are not part of the key.
+ *
+ * @param filename The path of the model file.
+ * @return The key, or an empty string if the file cannot be found.
+ */
+string UModelCacheKey(const char* filename)
+{
+#ifdef _WIN32
+    struct _stat64 info;
+    if (_stat64(filename, &info) != 0)
+        return string();
+#else
+    struct stat info;
+    if (stat(filename, &info) != 0)
+        return string();
+#endif
+
+    // Hash the absolute path (with symbolic links resolved where the platform can) with FNV-1a
+#ifdef _WIN32
+    char resolved[_MAX_PATH];
+    const char* path = _fullpath(resolved, filename, _MAX_PATH) ? resolved : filename;
+#else
+    char resolved[PATH_MAX];
+    const char* path = realpath(filename, resolved) ? resolved : filename;
+#endif
+    uint64_t pathHash = 14695981039346656037ULL;
+    for (const char* p = path; *p; ++p)
+    {
+        pathHash ^= (unsigned char)*p;
+        pathHash *= 1099511628211ULL;
+    }
+
+    // The name only makes the cache file recognizable; keep it short enough for MESH_CACHE_KEY_LENGTH
+    string name(filename);
+    size_t slash = name.find_last_of("/\\");
+    if (slash != string::npos)
+        name = name.substr(slash + 1);
+    if (name.size() > 40)
+        name.resize(40);
+
+    ostringstream key;
+    key << name << "-" << hex << setfill('0') << setw(16) << pathHash << dec << "-"
+        << (unsigned long long)info.st_size << "-" << (long long)info.st_mtime;
+    return key.str();
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "mesh.h"
+
+// GLB files start with GLB_MAGIC ("glTF" in file order)
+const uint32_t GLB_MAGIC = 0x46546C67;
+
+bool UImportObj(const char* filename, MeshData& data);
+bool UImportGltf(const char* filename, MeshData& data);
+bool UImportModel(const char* filename, MeshData& data);
+std::string UModelCacheKey(const char* filename);
@@ -0,0 +1,489 @@
+#include "meshopt.h"
+#include "cpuprofiler.h"
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// unnamed namespace to hold the optimizer's helpers
+namespace
+{
+    /**
+     * @brief Scores a vertex by its position in the LRU cache and its remaining triangles (Forsyth).
+     *
+     * The three most recent vertices score a fixed 0.75 so the next triangle
+     * does not simply reuse the last one's edge; older entries decay with age.
+     * Vertices with few triangles left get a bonus so they are finished off.
+     */
+    float vertexScore(int cachePosition, unsigned int remaining)
+    {
+        if (remaining == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = pow(1.0f - (float)(cachePosition - 3) / (float)(MESHOPT_CACHE_SIZE - 3), 1.5f);
+        }
+        return score + 2.0f * pow((float)remaining, -0.5f);
+    }
+
+    // Struct to hold one vertex as a hash table key
+    struct VertexKey {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 texCoord;
+
+        bool operator==(const VertexKey& other) const
+        {
+            return position == other.position && normal == other.normal && texCoord == other.texCoord;
+        }
+    };
+
+    // Hashes a VertexKey by combining the glm/gtx/hash hashes of its members
+    struct VertexKeyHash {
+        size_t operator()(const VertexKey& key) const
+        {
+            size_t seed = hash<glm::vec3>()(key.position);
+            seed ^= hash<glm::vec3>()(key.normal) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            seed ^= hash<glm::vec2>()(key.texCoord) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    /**
+     * @brief Returns how many of a triangle's vertices miss a FIFO cache, and inserts them.
+     *
+     * A vertex is cached if it was inserted within the last cacheSize
+     * insertions; advancing time by cacheSize + 1 empties the cache.
+     */
+    unsigned int fifoMisses(const GLuint* triangle, vector<unsigned int>& timestamps, unsigned int& time,
+        unsigned int cacheSize)
+    {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (time - timestamps[triangle[k]] > cacheSize)
+            {
+                timestamps[triangle[k]] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    /**
+     * @brief Returns how many vertices an index buffer transforms through an initially empty FIFO cache.
+     */
+    size_t fifoTransformed(const vector<GLuint>& indices, size_t vertexCount, unsigned int cacheSize)
+    {
+        vector<unsigned int> timestamps(vertexCount, 0);
+        unsigned int time = cacheSize + 1;
+        size_t transformed = 0;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            transformed += fifoMisses(&indices[i], timestamps, time, cacheSize);
+        return transformed;
+    }
+
+    /**
+     * @brief Returns a vertex's position from the interleaved MeshData layout.
+     */
+    glm::vec3 vertexPosition(const MeshData& data, GLuint index)
+    {
+        const GLfloat* p = &data.vertices[FLOATS_PER_VERTEX * index];
+        return glm::vec3(p[0], p[1], p[2]);
+    }
+}
+
+
+/**
+ * @brief Merges bit-identical vertices and indexes the mesh.
+ *
+ * Vertices are looked up in a hash table by position, normal, and texture
+ * coordinate, and each distinct vertex is kept once, in first-use order.
+ * Meshes without indices are treated as a triangle list of their vertices,
+ * so vertex soup comes out indexed. Vertices that differ only in the sign of
+ * a zero are merged.
+ *
+ * @param data The MeshData structure to weld in place.
+ */
+void UWeldMesh(MeshData& data)
+{
+    size_t vertexCount = data.vertices.size() / FLOATS_PER_VERTEX;
+    if (data.indices.empty())
+    {
+        data.indices.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+            data.indices[v] = (GLuint)v;
+    }
+
+    unordered_map<VertexKey, GLuint, VertexKeyHash> unique;
+    unique.reserve(vertexCount);
+    vector<GLfloat> vertices;
+    vertices.reserve(data.vertices.size());
+
+    for (GLuint& index : data.indices)
+    {
+        // Adding zero turns -0 into +0, which compare equal but hash differently
+        const GLfloat* p = &data.vertices[FLOATS_PER_VERTEX * index];
+        VertexKey key;
+        key.position = glm::vec3(p[0], p[1], p[2]) + 0.0f;
+        key.normal = glm::vec3(p[3], p[4], p[5]) + 0.0f;
+        key.texCoord = glm::vec2(p[6], p[7]) + 0.0f;
+
+        auto found = unique.find(key);
+        if (found == unique.end())
+        {
+            found = unique.emplace(key, (GLuint)(vertices.size() / FLOATS_PER_VERTEX)).first;
+            vertices.insert(vertices.end(), p, p + FLOATS_PER_VERTEX);
+        }
+        index = found->second;
+    }
+
+    data.vertices.swap(vertices);
+}
+
+/**
+ * @brief Measures how well an index buffer reuses a FIFO post-transform vertex cache.
+ *
+ * @param data The MeshData structure holding the geometry.
+ * @param cacheSize The number of vertices the simulated cache holds.
+ * @return The ACMR and ATVR of the index buffer.
+ */
+VertexCacheStats UAnalyzeVertexCache(const MeshData& data, unsigned int cacheSize)
+{
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    size_t triangleCount = data.indices.size() / 3;
+    size_t vertexCount = data.vertices.size() / FLOATS_PER_VERTEX;
+    if (triangleCount == 0)
+        return stats;
+
+    vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    size_t transformed = 0;
+    for (size_t t = 0; t < triangleCount; ++t)
+        transformed += fifoMisses(&data.indices[3 * t], timestamps, time, cacheSize);
+
+    size_t referenced = 0;
+    for (size_t v = 0; v < vertexCount; ++v)
+        referenced += timestamps[v] != 0 ? 1 : 0;
+
+    stats.acmr = (float)transformed / (float)triangleCount;
+    stats.atvr = (float)transformed / (float)referenced;
+    return stats;
+}
+
+/**
+ * @brief Reorders triangles for post-transform vertex cache reuse (Forsyth's linear-speed algorithm).
+ *
+ * Triangles are emitted greedily: each step emits the triangle whose vertices
+ * score highest, favoring vertices still in a simulated LRU cache of
+ * MESHOPT_CACHE_SIZE entries and vertices with few triangles left. Only the
+ * triangles of vertices in the cache are rescored after each step, so the pass
+ * runs in time linear in the triangle count.
+ *
+ * @param data The MeshData structure whose indices are reordered.
+ */
+void UOptimizeVertexCache(MeshData& data)
+{
+    size_t triangleCount = data.indices.size() / 3;
+    size_t vertexCount = data.vertices.size() / FLOATS_PER_VERTEX;
+    if (triangleCount == 0)
+        return;
+
+    // Triangles of each vertex; the first remaining[v] entries are the ones not yet emitted
+    vector<unsigned int> remaining(vertexCount, 0);
+    for (GLuint index : data.indices)
+        ++remaining[index];
+
+    vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    vector<unsigned int> adjacency(data.indices.size());
+    vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+            adjacency[cursor[data.indices[3 * t + k]]++] = (unsigned int)t;
+    }
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> scores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        scores[v] = vertexScore(-1, remaining[v]);
+
+    vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        triangleScores[t] = scores[data.indices[3 * t]] + scores[data.indices[3 * t + 1]] +
+            scores[data.indices[3 * t + 2]];
+    }
+
+    vector<bool> emitted(triangleCount, false);
+    vector<GLuint> output;
+    output.reserve(data.indices.size());
+
+    vector<GLuint> cache, nextCache;
+    cache.reserve(MESHOPT_CACHE_SIZE + 3);
+    nextCache.reserve(MESHOPT_CACHE_SIZE + 3);
+
+    // Start from the best triangle; later restarts take the next unemitted one in input order
+    int best = (int)(max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    size_t restart = 0;
+
+    while (best >= 0)
+    {
+        const GLuint* triangle = &data.indices[3 * best];
+        emitted[best] = true;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // Retire the triangle from its vertices' lists
+        for (int k = 0; k < 3; ++k)
+        {
+            GLuint v = triangle[k];
+            unsigned int* list = &adjacency[offsets[v]];
+            for (unsigned int i = 0; i < remaining[v]; ++i)
+            {
+                if (list[i] == (unsigned int)best)
+                {
+                    swap(list[i], list[remaining[v] - 1]);
+                    --remaining[v];
+                    break;
+                }
+            }
+        }
+
+        // The triangle's vertices move to the front of the cache
+        nextCache.assign(triangle, triangle + 3);
+        for (GLuint v : cache)
+        {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                nextCache.push_back(v);
+        }
+
+        // Rescore every vertex that moved, entered, or fell out of the cache
+        for (size_t i = 0; i < nextCache.size(); ++i)
+        {
+            GLuint v = nextCache[i];
+            cachePosition[v] = i < MESHOPT_CACHE_SIZE ? (int)i : -1;
+            scores[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // Pick the best triangle touching the cache, rescoring those triangles as we go
+        best = -1;
+        float bestScore = -1.0f;
+        for (GLuint v : nextCache)
+        {
+            for (unsigned int i = 0; i < remaining[v]; ++i)
+            {
+                unsigned int t = adjacency[offsets[v] + i];
+                triangleScores[t] = scores[data.indices[3 * t]] + scores[data.indices[3 * t + 1]] +
+                    scores[data.indices[3 * t + 2]];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    best = (int)t;
+                }
+            }
+        }
+
+        if (nextCache.size() > MESHOPT_CACHE_SIZE)
+            nextCache.resize(MESHOPT_CACHE_SIZE);
+        cache.swap(nextCache);
+
+        // Nothing left around the cache: continue from the first triangle not yet emitted
+        if (best < 0)
+        {
+            while (restart < triangleCount && emitted[restart])
+                ++restart;
+            if (restart < triangleCount)
+                best = (int)restart;
+        }
+    }
+
+    data.indices.swap(output);
+}
+
+/**
+ * @brief Reorders clusters of triangles so that front-facing surfaces tend to be drawn first.
+ *
+ * The cache-optimized order is cut into clusters (Sander, Nehab, and Barczak,
+ * "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). Hard
+ * boundaries fall where the optimizer restarted with a cold cache, and each
+ * group is cut further as soon as a cluster's ACMR is within threshold of its
+ * group's, so reordering clusters costs little cache reuse. Clusters are then
+ * drawn in decreasing order of how far they face out from the mesh's
+ * centroid, since those are the most likely to occlude the rest from any view.
+ * If the new order still costs more than threshold in ACMR overall, as for
+ * meshes small enough to stay in the cache, the input order is kept. Run it
+ * after UOptimizeVertexCache.
+ *
+ * @param data The MeshData structure whose indices are reordered.
+ * @param threshold The ACMR a cluster may reach, relative to its group's.
+ */
+void UOptimizeOverdraw(MeshData& data, float threshold)
+{
+    size_t triangleCount = data.indices.size() / 3;
+    size_t vertexCount = data.vertices.size() / FLOATS_PER_VERTEX;
+    if (triangleCount == 0)
+        return;
+
+    const unsigned int cacheSize = MESHOPT_ANALYZE_CACHE_SIZE;
+    vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    vector<unsigned char> misses(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+        misses[t] = (unsigned char)fifoMisses(&data.indices[3 * t], timestamps, time, cacheSize);
+
+    // Hard boundaries: triangles that missed on all three vertices
+    vector<size_t> hardStarts;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (t == 0 || misses[t] == 3)
+            hardStarts.push_back(t);
+    }
+    hardStarts.push_back(triangleCount);
+
+    // Soft boundaries: cut each group as soon as the current cluster's ACMR is good enough
+    vector<size_t> clusterStarts;
+    for (size_t h = 0; h + 1 < hardStarts.size(); ++h)
+    {
+        size_t first = hardStarts[h], end = hardStarts[h + 1];
+        unsigned int groupMisses = 0;
+        for (size_t t = first; t < end; ++t)
+            groupMisses += misses[t];
+        float groupAcmr = (float)groupMisses / (float)(end - first);
+
+        size_t start = first;
+        unsigned int runningMisses = 0;
+        clusterStarts.push_back(start);
+        time += cacheSize + 1;
+        for (size_t t = first; t < end; ++t)
+        {
+            runningMisses += fifoMisses(&data.indices[3 * t], timestamps, time, cacheSize);
+
+            if (t + 1 < end && (float)runningMisses / (float)(t + 1 - start) <= groupAcmr * threshold)
+            {
+                start = t + 1;
+                runningMisses = 0;
+                clusterStarts.push_back(start);
+                time += cacheSize + 1;
+            }
+        }
+    }
+    clusterStarts.push_back(triangleCount);
+    size_t clusterCount = clusterStarts.size() - 1;
+
+    // Area-weighted centroid and normal of each cluster and of the whole mesh
+    vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    vector<float> areas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            glm::vec3 a = vertexPosition(data, data.indices[3 * t]);
+            glm::vec3 b = vertexPosition(data, data.indices[3 * t + 1]);
+            glm::vec3 d = vertexPosition(data, data.indices[3 * t + 2]);
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+
+            centroids[c] += (a + b + d) * (area / 3.0f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += areas[c];
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    vector<float> keys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        float length = glm::length(normals[c]);
+        if (areas[c] > 0.0f && length > 0.0f)
+            keys[c] = glm::dot(centroids[c] / areas[c] - meshCentroid, normals[c] / length);
+    }
+
+    vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c)
+        order[c] = c;
+    stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    vector<GLuint> output;
+    output.reserve(data.indices.size());
+    for (size_t c : order)
+    {
+        output.insert(output.end(), data.indices.begin() + 3 * clusterStarts[c],
+            data.indices.begin() + 3 * clusterStarts[c + 1]);
+    }
+
+    if (fifoTransformed(output, vertexCount, cacheSize) <= fifoTransformed(data.indices, vertexCount, cacheSize) * threshold)
+        data.indices.swap(output);
+}
+
+/**
+ * @brief Reorders vertices to follow their first use in the index buffer.
+ *
+ * Vertex fetches then walk the vertex buffer almost sequentially. Vertices no
+ * triangle uses are dropped. Run it last, after the triangle order is final.
+ *
+ * @param data The MeshData structure whose vertices are reordered and indices remapped.
+ */
+void UOptimizeVertexFetch(MeshData& data)
+{
+    const GLuint UNUSED = 0xFFFFFFFFu;
+    size_t vertexCount = data.vertices.size() / FLOATS_PER_VERTEX;
+
+    vector<GLuint> remap(vertexCount, UNUSED);
+    vector<GLfloat> vertices;
+    vertices.reserve(data.vertices.size());
+
+    GLuint next = 0;
+    for (GLuint& index : data.indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = next++;
+            const GLfloat* vertex = &data.vertices[FLOATS_PER_VERTEX * index];
+            vertices.insert(vertices.end(), vertex, vertex + FLOATS_PER_VERTEX);
+        }
+        index = remap[index];
+    }
+
+    data.vertices.swap(vertices);
+}
+
+/**
+ * @brief Runs the welding, vertex cache, overdraw, and vertex fetch passes on a mesh.
+ *
+ * @param data The MeshData structure to optimize in place.
+ * @return The mesh's vertex counts and vertex cache statistics before and after.
+ */
+MeshOptimizationStats UOptimizeMesh(MeshData& data)
+{
+    CPU_ZONE("UOptimizeMesh");
+
+    MeshOptimizationStats stats;
+    stats.verticesBefore = data.vertices.size() / FLOATS_PER_VERTEX;
+    UWeldMesh(data);
+    stats.verticesAfter = data.vertices.size() / FLOATS_PER_VERTEX;
+    stats.before = UAnalyzeVertexCache(data);
+
+    UOptimizeVertexCache(data);
+    UOptimizeOverdraw(data);
+    UOptimizeVertexFetch(data);
+
+    stats.after = UAnalyzeVertexCache(data);
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "mesh.h"
+
+// Post-transform cache size the optimizer targets (least recently used, as in Forsyth's model)
+const unsigned int MESHOPT_CACHE_SIZE = 32;
+
+// FIFO cache size the statistics are measured with, typical of hardware
+const unsigned int MESHOPT_ANALYZE_CACHE_SIZE = 16;
+
+// How much worse than its group's ACMR a cluster may get to be drawn in a different order
+const float MESHOPT_OVERDRAW_THRESHOLD = 1.05f;
+
+// Struct to hold post-transform vertex cache statistics of an index buffer
+struct VertexCacheStats {
+    float acmr;   // average cache miss ratio: vertices transformed per triangle (0.5 at best, 3 at worst)
+    float atvr;   // average transformed vertex ratio: vertices transformed per vertex (1 at best)
+};
+
+// Struct to hold the statistics of a mesh before and after UOptimizeMesh
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t verticesBefore;
+    size_t verticesAfter;   // after welding identical vertices
+};
+
+void UWeldMesh(MeshData& data);
+VertexCacheStats UAnalyzeVertexCache(const MeshData& data, unsigned int cacheSize = MESHOPT_ANALYZE_CACHE_SIZE);
+void UOptimizeVertexCache(MeshData& data);
+void UOptimizeOverdraw(MeshData& data, float threshold = MESHOPT_OVERDRAW_THRESHOLD);
+void UOptimizeVertexFetch(MeshData& data);
+MeshOptimizationStats UOptimizeMesh(MeshData& data);
\ No newline at end of file
@@ -0,0 +1,499 @@
+#include "occlusion.h"
+#include "cpuprofiler.h"
+#include "glstate.h"
+#include "renderstats.h"
+#include "texture.h"
+#include <iostream>
+#include <vector>
+using namespace std;
+
+// shader program macro
+#ifndef GLSL
+#define GLSL(Version, Source) "#version " #Version " core \n" #Source
+#endif
+
+// unnamed namespace to hold the compute shaders and helpers
+namespace
+{
+    // Reduces the source level into the next one: every destination texel keeps the
+    // farthest depth of the 2x2 source texels under it, plus the extra row or column
+    // left over when a source dimension is odd, so coarser levels never under-report.
+    const GLchar* buildShaderSource = GLSL(440,
+        layout(local_size_x = 8, local_size_y = 8) in;
+
+        uniform sampler2D uSource;
+        uniform int uSourceLevel;
+        layout(r32f, binding = 0) uniform writeonly image2D uDestination;
+
+        void main()
+        {
+            ivec2 destination = ivec2(gl_GlobalInvocationID.xy);
+            ivec2 destinationSize = imageSize(uDestination);
+            if (destination.x >= destinationSize.x || destination.y >= destinationSize.y)
+                return;
+
+            ivec2 sourceSize = textureSize(uSource, uSourceLevel);
+            ivec2 first = destination * 2;
+            ivec2 last = first + ivec2(1);
+
+            // The last texel of a row or column also covers an odd source's leftover texel
+            if (destination.x == destinationSize.x - 1)
+                last.x = sourceSize.x - 1;
+            if (destination.y == destinationSize.y - 1)
+                last.y = sourceSize.y - 1;
+
+            float depth = 0.0;
+            for (int y = first.y; y <= last.y; ++y)
+            {
+                for (int x = first.x; x <= last.x; ++x)
+                    depth = max(depth, texelFetch(uSource, min(ivec2(x, y), sourceSize - ivec2(1)), uSourceLevel).r);
+            }
+
+            imageStore(uDestination, destination, vec4(depth));
+        }
+    );
+
+    // Tests one instance per invocation. Command i of the stream draws instance i
+    // (see RenderQueue::perInstanceCommands), so culling an instance is writing 0
+    // to its command's instance count.
+    const GLchar* cullShaderSource = GLSL(440,
+        layout(local_size_x = 64) in;
+
+        struct DrawCommand
+        {
+            uint count;
+            uint instanceCount;
+            uint firstIndex;
+            int baseVertex;
+            uint baseInstance;
+        };
+
+        layout(std430, binding = 0) buffer Commands { DrawCommand commands[]; };
+        layout(std430, binding = 1) readonly buffer Instances { float instanceData[]; };  // GLInstance records
+        layout(std430, binding = 2) readonly buffer Bounds { vec4 bounds[]; };           // min, max per instance
+        layout(std430, binding = 3) buffer Visibility { uint visibility[]; };
+        layout(binding = 0, offset = 0) uniform atomic_uint occluded;
+
+        uniform sampler2D uPyramid;
+        uniform vec2 uPyramidSize;       // size of level 0
+        uniform int uPyramidLevels;
+        uniform int uHasPyramid;
+        uniform mat4 uViewProjection;    // camera the pyramid was rendered with
+        uniform int uPhase;              // 1: test against last frame, 2: re-test what phase 1 rejected, 3: restore both
+        uniform int uCommandCount;
+        uniform int uFirst;              // index of the stream's first instance in Bounds and Visibility
+
+        const int FLOATS_PER_INSTANCE = 30;
+
+        // Returns true unless the box is certainly behind the depth in the pyramid
+        bool isVisible(vec3 boxMin, vec3 boxMax)
+        {
+            vec3 lo = vec3(1.0e30);
+            vec3 hi = vec3(-1.0e30);
+            for (int corner = 0; corner < 8; ++corner)
+            {
+                vec3 position = mix(boxMin, boxMax, vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1));
+                vec4 clip = uViewProjection * vec4(position, 1.0);
+
+                // Boxes crossing the camera plane cannot be projected; keep them
+                if (clip.w <= 0.0)
+                    return true;
+
+                vec3 ndc = clip.xyz / clip.w;
+                lo = min(lo, ndc);
+                hi = max(hi, ndc);
+            }
+
+            vec2 uvMin = clamp(lo.xy * 0.5 + 0.5, 0.0, 1.0);
+            vec2 uvMax = clamp(hi.xy * 0.5 + 0.5, 0.0, 1.0);
+            float nearest = lo.z * 0.5 + 0.5;
+
+            // Pick the level where the box covers at most 2x2 texels
+            vec2 size = (uvMax - uvMin) * uPyramidSize;
+            int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, uPyramidLevels - 1);
+
+            ivec2 levelMax = max(ivec2(uPyramidSize) >> level, ivec2(1)) - ivec2(1);
+            ivec2 a = min(ivec2(uvMin * uPyramidSize) >> level, levelMax);
+            ivec2 b = min(ivec2(uvMax * uPyramidSize) >> level, levelMax);
+
+            float farthest = max(max(texelFetch(uPyramid, a, level).r, texelFetch(uPyramid, ivec2(b.x, a.y), level).r),
+                max(texelFetch(uPyramid, ivec2(a.x, b.y), level).r, texelFetch(uPyramid, b, level).r));
+
+            return nearest <= farthest;
+        }
+
+        void main()
+        {
+            int i = int(gl_GlobalInvocationID.x);
+            if (i >= uCommandCount)
+                return;
+
+            // Draw every instance either phase found visible; no box needs testing
+            if (uPhase == 3)
+            {
+                commands[i].instanceCount = visibility[uFirst + i];
+                return;
+            }
+
+            // World-space box enclosing the transformed object-space box
+            int base = int(commands[i].baseInstance) * FLOATS_PER_INSTANCE;
+            mat4 model = mat4(
+                instanceData[base + 0], instanceData[base + 1], instanceData[base + 2], instanceData[base + 3],
+                instanceData[base + 4], instanceData[base + 5], instanceData[base + 6], instanceData[base + 7],
+                instanceData[base + 8], instanceData[base + 9], instanceData[base + 10], instanceData[base + 11],
+                instanceData[base + 12], instanceData[base + 13], instanceData[base + 14], instanceData[base + 15]);
+            vec3 localMin = bounds[(uFirst + i) * 2].xyz;
+            vec3 localMax = bounds[(uFirst + i) * 2 + 1].xyz;
+            vec3 center = vec3(model * vec4((localMin + localMax) * 0.5, 1.0));
+            vec3 extent = abs(mat3(model)[0]) * (localMax.x - localMin.x) * 0.5 +
+                abs(mat3(model)[1]) * (localMax.y - localMin.y) * 0.5 +
+                abs(mat3(model)[2]) * (localMax.z - localMin.z) * 0.5;
+
+            if (uPhase == 1)
+            {
+                // Draw what was visible last frame (everything before the first pyramid exists)
+                bool visible = uHasPyramid == 0 || isVisible(center - extent, center + extent);
+                visibility[uFirst + i] = visible ? 1u : 0u;
+                commands[i].instanceCount = visible ? 1u : 0u;
+                if (!visible)
+                    atomicCounterIncrement(occluded);
+            }
+            else
+            {
+                // Draw the instances phase 1 rejected that this frame's depth does not hide
+                bool drawn = visibility[uFirst + i] != 0u;
+                bool recovered = !drawn && isVisible(center - extent, center + extent);
+                commands[i].instanceCount = recovered ? 1u : 0u;
+                if (recovered)
+                {
+                    visibility[uFirst + i] = 1u;
+                    atomicCounterDecrement(occluded);
+                }
+            }
+        }
+    );
+
+    /**
+     * @brief Creates the depth copy and the pyramid for a depth buffer size.
+     */
+    void createPyramid(GLOcclusionCuller& culler, GLsizei width, GLsizei height)
+    {
+        if (culler.pyramid)
+        {
+            UDestroyTexture(culler.depthCopy);
+            UDestroyTexture(culler.pyramid);
+        }
+
+        culler.depthWidth = width;
+        culler.depthHeight = height;
+        culler.pyramidWidth = width / 2 > 0 ? width / 2 : 1;
+        culler.pyramidHeight = height / 2 > 0 ? height / 2 : 1;
+        culler.levels = 1;
+        for (GLsizei size = glm::max(culler.pyramidWidth, culler.pyramidHeight); size > 1; size /= 2)
+            ++culler.levels;
+
+        UStateActiveTexture(GL_TEXTURE0 + OCCLUSION_TEXTURE_UNIT);
+
+        glGenTextures(1, &culler.depthCopy);
+        UStateBindTexture(GL_TEXTURE_2D, culler.depthCopy);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        UTrackTextureMemory(culler.depthCopy, (uint64_t)width * height * 4);
+
+        glGenTextures(1, &culler.pyramid);
+        UStateBindTexture(GL_TEXTURE_2D, culler.pyramid);
+        glTexStorage2D(GL_TEXTURE_2D, culler.levels, GL_R32F, culler.pyramidWidth, culler.pyramidHeight);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        uint64_t pyramidBytes = 0;
+        for (GLint level = 0; level < culler.levels; ++level)
+            pyramidBytes += (uint64_t)glm::max(culler.pyramidWidth >> level, 1) * glm::max(culler.pyramidHeight >> level, 1) * 4;
+        UTrackTextureMemory(culler.pyramid, pyramidBytes);
+
+        culler.hasPyramid = false;
+    }
+
+    /**
+     * @brief Runs the cull shader over every stream of the queue.
+     */
+    void dispatchCull(GLOcclusionCuller& culler, const RenderQueue& queue, int phase, const glm::mat4& viewProjection)
+    {
+        UStateUseProgram(culler.cullProgram.id);
+        USetUniform(culler.uniforms.viewProjection, viewProjection);
+        USetUniform(culler.uniforms.phase, phase);
+        USetUniform(culler.uniforms.hasPyramid, culler.hasPyramid ? 1 : 0);
+        USetUniform(culler.uniforms.pyramidSize,
+            glm::vec2((float)culler.pyramidWidth, (float)culler.pyramidHeight));
+        USetUniform(culler.uniforms.pyramidLevels, culler.levels);
+
+        UStateActiveTexture(GL_TEXTURE0 + OCCLUSION_TEXTURE_UNIT);
+        UStateBindTexture(GL_TEXTURE_2D, culler.pyramid);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, culler.boundsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, culler.visibilityBuffer);
+        glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, culler.counters[culler.frame]);
+
+        GLint first = 0;
+        for (size_t i = 0; i < queue.streams.size(); ++i)
+        {
+            const RenderArenaStream& stream = queue.streams[i];
+            GLint count = (GLint)stream.commands.size();
+            if (count == 0)
+                continue;
+
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, stream.arena->indirectBuffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, stream.arena->instanceBuffer);
+            USetUniform(culler.uniforms.commandCount, count);
+            USetUniform(culler.uniforms.first, first);
+            glDispatchCompute((count + 63) / 64, 1, 1);
+
+            first += count;
+        }
+
+        // The draws read the rewritten commands as indirect arguments
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+
+/**
+ * @brief Compiles the pyramid and culling shaders and creates the counter buffers.
+ *
+ * The pyramid textures are created by the first UBuildDepthPyramid, once the
+ * framebuffer size is known.
+ *
+ * @param culler The GLOcclusionCuller structure to hold the culling state.
+ * @return True if both compute shaders were built, otherwise false.
+ */
+bool UCreateOcclusionCuller(GLOcclusionCuller& culler)
+{
+    CPU_ZONE("UCreateOcclusionCuller");
+
+    culler.depthCopy = culler.pyramid = 0;
+    culler.depthWidth = culler.depthHeight = 0;
+    culler.pyramidWidth = culler.pyramidHeight = 1;
+    culler.levels = 1;
+    culler.boundsBuffer = culler.visibilityBuffer = 0;
+    culler.capacity = 0;
+    culler.frame = 0;
+    culler.previousViewProjection = glm::mat4(1.0f);
+    culler.hasPyramid = false;
+    culler.occluded = 0;
+
+    if (!UCreateComputeProgram(buildShaderSource, culler.buildProgram) ||
+        !UCreateComputeProgram(cullShaderSource, culler.cullProgram))
+        return false;
+
+    // Resolve the uniforms set every frame once, so the frame never looks names up
+    culler.uniforms.sourceLevel = UGetUniform(culler.buildProgram, "uSourceLevel");
+    culler.uniforms.viewProjection = UGetUniform(culler.cullProgram, "uViewProjection");
+    culler.uniforms.phase = UGetUniform(culler.cullProgram, "uPhase");
+    culler.uniforms.hasPyramid = UGetUniform(culler.cullProgram, "uHasPyramid");
+    culler.uniforms.pyramidSize = UGetUniform(culler.cullProgram, "uPyramidSize");
+    culler.uniforms.pyramidLevels = UGetUniform(culler.cullProgram, "uPyramidLevels");
+    culler.uniforms.commandCount = UGetUniform(culler.cullProgram, "uCommandCount");
+    culler.uniforms.first = UGetUniform(culler.cullProgram, "uFirst");
+
+    // Both programs read their texture from the same unit
+    UStateUseProgram(culler.buildProgram.id);
+    USetUniform(UGetUniform(culler.buildProgram, "uSource"), (GLint)OCCLUSION_TEXTURE_UNIT);
+    UStateUseProgram(culler.cullProgram.id);
+    USetUniform(UGetUniform(culler.cullProgram, "uPyramid"), (GLint)OCCLUSION_TEXTURE_UNIT);
+
+    GLuint zero = 0;
+    glGenBuffers(OCCLUSION_READBACK_FRAMES, culler.counters);
+    for (int i = 0; i < OCCLUSION_READBACK_FRAMES; ++i)
+    {
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, culler.counters[i]);
+        glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_READ);
+        culler.fences[i] = 0;
+    }
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+    glGenBuffers(1, &culler.boundsBuffer);
+    glGenBuffers(1, &culler.visibilityBuffer);
+
+    return true;
+}
+
+/**
+ * @brief Culls the prepared queue against the previous frame's depth pyramid.
+ *
+ * Each instance's box is projected with the camera the pyramid was rendered
+ * with and compared with the farthest depth under it. Instances found hidden
+ * get an instance count of 0 and are remembered for the second phase. The
+ * queue must have been prepared (UPrepareRenderQueue) with perInstanceCommands.
+ *
+ * This function also reads back the occluded count of the frame that last used
+ * this counter slot, if the GPU has finished it, and reports it to the render
+ * statistics; the count shown is therefore a few frames old.
+ *
+ * @param culler The GLOcclusionCuller structure.
+ * @param queue The prepared RenderQueue structure.
+ */
+void UOcclusionCullFirstPhase(GLOcclusionCuller& culler, const RenderQueue& queue)
+{
+    // Read back this slot's count only if its frame has finished, so nothing waits
+    GLsync& fence = culler.fences[culler.frame];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+        {
+            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, culler.counters[culler.frame]);
+            glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &culler.occluded);
+        }
+        glDeleteSync(fence);
+        fence = 0;
+    }
+    UCountOccluded(culler.occluded);
+
+    GLuint zero = 0;
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, culler.counters[culler.frame]);
+    glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+    // Gather every stream's boxes into one buffer, growing it geometrically
+    GLsizei total = 0;
+    for (size_t i = 0; i < queue.streams.size(); ++i)
+        total += (GLsizei)queue.streams[i].commands.size();
+
+    if (total > culler.capacity)
+    {
+        while (culler.capacity < total)
+            culler.capacity = culler.capacity > 0 ? culler.capacity * 2 : 64;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.visibilityBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * culler.capacity, NULL, GL_DYNAMIC_COPY);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.boundsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::vec4) * 2 * culler.capacity, NULL, GL_STREAM_DRAW);
+    GLintptr offset = 0;
+    for (size_t i = 0; i < queue.streams.size(); ++i)
+    {
+        const vector<glm::vec4>& bounds = queue.streams[i].bounds;
+        if (bounds.empty())
+            continue;
+
+        GLsizeiptr bytes = sizeof(glm::vec4) * bounds.size();
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, bytes, &bounds[0]);
+        UCountBufferUpload(bytes);
+        offset += bytes;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    dispatchCull(culler, queue, 1, culler.previousViewProjection);
+}
+
+/**
+ * @brief Builds the depth pyramid from the depth buffer of the current read framebuffer.
+ *
+ * The depth buffer is copied into a texture, reduced to half size into level 0
+ * of the pyramid, and then halved level by level down to 1x1, each texel
+ * keeping the farthest depth it covers. Call this after the first phase's
+ * draws; the pyramid is used by the second phase and by the next frame's first
+ * phase. The pyramid is recreated when the viewport size changes.
+ *
+ * @param culler The GLOcclusionCuller structure.
+ * @param viewProjection The projection * view matrix the depth was rendered with.
+ */
+void UBuildDepthPyramid(GLOcclusionCuller& culler, const glm::mat4& viewProjection)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] != culler.depthWidth || viewport[3] != culler.depthHeight || !culler.pyramid)
+        createPyramid(culler, viewport[2], viewport[3]);
+
+    UStateActiveTexture(GL_TEXTURE0 + OCCLUSION_TEXTURE_UNIT);
+    UStateBindTexture(GL_TEXTURE_2D, culler.depthCopy);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], culler.depthWidth, culler.depthHeight);
+
+    UStateUseProgram(culler.buildProgram.id);
+
+    GLsizei width = culler.pyramidWidth;
+    GLsizei height = culler.pyramidHeight;
+    for (GLint level = 0; level < culler.levels; ++level)
+    {
+        // Level 0 reduces the depth copy; every other level reduces the one above it
+        if (level == 1)
+            UStateBindTexture(GL_TEXTURE_2D, culler.pyramid);
+        USetUniform(culler.uniforms.sourceLevel, level == 0 ? 0 : level - 1);
+
+        glBindImageTexture(0, culler.pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        width = width / 2 > 0 ? width / 2 : 1;
+        height = height / 2 > 0 ? height / 2 : 1;
+    }
+
+    culler.previousViewProjection = viewProjection;
+    culler.hasPyramid = true;
+}
+
+/**
+ * @brief Re-tests the instances the first phase rejected against this frame's pyramid.
+ *
+ * Instances hidden in last frame's depth can be visible now (the camera or the
+ * occluder moved); drawing the ones this frame's depth does not hide avoids
+ * them popping in a frame late. Every other command gets an instance count of
+ * 0, so drawing the queue again draws only the recovered instances.
+ *
+ * @param culler The GLOcclusionCuller structure.
+ * @param queue The RenderQueue structure culled by the first phase.
+ * @param viewProjection The projection * view matrix of this frame.
+ */
+void UOcclusionCullSecondPhase(GLOcclusionCuller& culler, const RenderQueue& queue, const glm::mat4& viewProjection)
+{
+    dispatchCull(culler, queue, 2, viewProjection);
+
+    culler.fences[culler.frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    culler.frame = (culler.frame + 1) % OCCLUSION_READBACK_FRAMES;
+}
+
+/**
+ * @brief Sets the commands back to every instance either phase found visible.
+ *
+ * After the depth pre-pass has drawn the first phase's instances and then the
+ * recovered ones, this restores the full visible set for the shading pass
+ * without testing any box again.
+ *
+ * @param culler The GLOcclusionCuller structure.
+ * @param queue The RenderQueue structure culled by both phases.
+ */
+void UOcclusionRestoreVisible(GLOcclusionCuller& culler, const RenderQueue& queue)
+{
+    dispatchCull(culler, queue, 3, culler.previousViewProjection);
+}
+
+/**
+ * @brief Deletes the programs, textures, buffers, and fences of the culler.
+ *
+ * @param culler The GLOcclusionCuller structure to be destroyed.
+ */
+void UDestroyOcclusionCuller(GLOcclusionCuller& culler)
+{
+    for (int i = 0; i < OCCLUSION_READBACK_FRAMES; ++i)
+    {
+        if (culler.fences[i])
+            glDeleteSync(culler.fences[i]);
+        culler.fences[i] = 0;
+    }
+
+    if (culler.pyramid)
+    {
+        UDestroyTexture(culler.depthCopy);
+        UDestroyTexture(culler.pyramid);
+    }
+    culler.depthCopy = culler.pyramid = 0;
+
+    glDeleteBuffers(OCCLUSION_READBACK_FRAMES, culler.counters);
+    glDeleteBuffers(1, &culler.boundsBuffer);
+    glDeleteBuffers(1, &culler.visibilityBuffer);
+
+    UDestroyShaderProgram(culler.buildProgram);
+    UDestroyShaderProgram(culler.cullProgram);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "renderqueue.h"
+#include "shader.h"
+
+// Number of frames an occlusion count waits before it is read back
+const int OCCLUSION_READBACK_FRAMES = 3;
+
+// Texture unit the depth pyramid is bound to while culling (unit 0 holds the materials)
+const GLuint OCCLUSION_TEXTURE_UNIT = 1;
+
+// Struct to hold the uniform handles of the two occlusion programs
+struct OcclusionUniforms {
+    GLUniform sourceLevel;       // build program: pyramid level the dispatch reads
+    GLUniform viewProjection;    // cull program: camera the pyramid was rendered with
+    GLUniform phase;
+    GLUniform hasPyramid;
+    GLUniform pyramidSize;
+    GLUniform pyramidLevels;
+    GLUniform commandCount;      // cull program: commands in the dispatched stream
+    GLUniform first;
+};
+
+// Struct to hold the depth pyramid (Hi-Z) and the state of the two-phase GPU occlusion culling
+struct GLOcclusionCuller {
+    GLProgram buildProgram;      // reduces one level of the pyramid into the next
+    GLProgram cullProgram;       // tests instance boxes and rewrites their instance counts
+    OcclusionUniforms uniforms;  // handles set every frame, resolved once in UCreateOcclusionCuller
+    GLuint depthCopy;            // GL_DEPTH_COMPONENT24 copy of the depth buffer
+    GLuint pyramid;              // GL_R32F mip chain, each texel the farthest depth it covers
+    GLsizei depthWidth;          // size of the depth buffer the pyramid was built from
+    GLsizei depthHeight;
+    GLsizei pyramidWidth;        // size of level 0 (half the depth buffer)
+    GLsizei pyramidHeight;
+    GLint levels;
+    GLuint boundsBuffer;         // object-space box (min, max) of every queued instance
+    GLuint visibilityBuffer;     // 1 for every instance drawn by the first phase
+    GLsizei capacity;            // instances the two buffers above can hold
+    GLuint counters[OCCLUSION_READBACK_FRAMES]; // occluded instance count of each frame in flight
+    GLsync fences[OCCLUSION_READBACK_FRAMES];
+    int frame;                   // counter slot written this frame
+    glm::mat4 previousViewProjection; // camera the current pyramid was rendered with
+    bool hasPyramid;             // false until a pyramid matching the framebuffer exists
+    unsigned int occluded;       // most recent occluded count read back
+};
+
+bool UCreateOcclusionCuller(GLOcclusionCuller& culler);
+void UOcclusionCullFirstPhase(GLOcclusionCuller& culler, const RenderQueue& queue);
+void UBuildDepthPyramid(GLOcclusionCuller& culler, const glm::mat4& viewProjection);
+void UOcclusionCullSecondPhase(GLOcclusionCuller& culler, const RenderQueue& queue, const glm::mat4& viewProjection);
+void UOcclusionRestoreVisible(GLOcclusionCuller& culler, const RenderQueue& queue);
+void UDestroyOcclusionCuller(GLOcclusionCuller& culler);
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "renderqueue.h"
+#include "glstate.h"
+#include "renderstats.h"
+#include <algorithm>
+using namespace std;
+
+/**
+ * @brief Clears the queue and sets the reference used for depth sorting.
+ *
+ * @param queue The RenderQueue structure to reset.
+ * @param cameraPos The camera position this frame.
+ * @param farPlane The distance that maps to the largest depth key.
+ */
+void UBeginRenderQueue(RenderQueue& queue, const glm::vec3& cameraPos, float farPlane)
+{
+    queue.cameraPos = cameraPos;
+    queue.farPlane = farPlane;
+    queue.items.clear();
+    queue.entries.clear();
+}
+
+/**
+ * @brief Submits one draw to the queue.
+ *
+ * This function records the draw and packs its sort key. From the most to the
+ * least significant 16 bits the key holds the program, the texture, the VAO,
+ * and the quantized distance to the camera, so sorting groups draws by the
+ * most expensive state first and draws each group front to back.
+ *
+ * @param queue The RenderQueue structure to submit to.
+ * @param arena The arena the mesh was allocated from.
+ * @param mesh The arena mesh to draw.
+ * @param program The shader program to draw with.
+ * @param texture The GL_TEXTURE_2D_ARRAY to bind on texture unit 0.
+ * @param instance The instance record (see UMakeInstance).
+ */
+void USubmit(RenderQueue& queue, GLGeometryArena& arena, const GLMesh& mesh, GLuint program, GLuint texture,
+    const GLInstance& instance)
+{
+    RenderItem item;
+    item.arena = &arena;
+    item.mesh = &mesh;
+    item.program = program;
+    item.texture = texture;
+    item.instance = instance;
+
+    // Quantize the distance to the camera to 16 bits
+    float distance = glm::length(glm::vec3(instance.model[3]) - queue.cameraPos) / queue.farPlane;
+    uint64_t depth = (uint64_t)(glm::clamp(distance, 0.0f, 1.0f) * 65535.0f);
+
+    RenderSortEntry entry;
+    entry.key = ((uint64_t)(program & 0xFFFF) << 48) |
+        ((uint64_t)(texture & 0xFFFF) << 32) |
+        ((uint64_t)(arena.vao & 0xFFFF) << 16) |
+        depth;
+    entry.item = (uint32_t)queue.items.size();
+
+    queue.items.push_back(item);
+    queue.entries.push_back(entry);
+}
+
+/**
+ * @brief Sorts the submitted draws by key with an LSD radix sort.
+ *
+ * The keys are sorted 8 bits at a time over eight counting passes, which is
+ * linear in the number of draws and stable, so draws with equal keys keep
+ * their submission order. A pass is skipped when every key has the same byte
+ * in that position, which is common for the program and texture bytes.
+ *
+ * @param queue The RenderQueue structure to sort.
+ */
+void USortRenderQueue(RenderQueue& queue)
+{
+    size_t count = queue.entries.size();
+    if (count < 2)
+        return;
+
+    queue.scratch.resize(count);
+    RenderSortEntry* src = &queue.entries[0];
+    RenderSortEntry* dst = &queue.scratch[0];
+
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t offsets[256] = { 0 };
+        for (size_t i = 0; i < count; ++i)
+            ++offsets[(src[i].key >> shift) & 0xFF];
+
+        // Every key has the same byte here, so this pass would not move anything
+        if (offsets[(src[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        // Turn the histogram into the starting offset of each bucket
+        size_t total = 0;
+        for (int bucket = 0; bucket < 256; ++bucket)
+        {
+            size_t bucketCount = offsets[bucket];
+            offsets[bucket] = total;
+            total += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+            dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+        swap(src, dst);
+    }
+
+    // An odd number of passes leaves the result in the scratch buffer
+    if (src != &queue.entries[0])
+        queue.entries.swap(queue.scratch);
+}
+
+/**
+ * @brief Turns the sorted queue into batches of indirect commands and uploads them.
+ *
+ * This function walks the sorted draws and turns them into indirect commands,
+ * merging consecutive draws of the same mesh into one instanced command and
+ * cutting a new batch whenever the program, texture, or arena changes. Each
+ * arena's commands and instances are then uploaded once.
+ *
+ * With queue.perInstanceCommands set, draws are never merged: command i draws
+ * instance i with an instance count of 1, and the object-space box of every
+ * instance is kept in the stream, so a compute shader can cull instances by
+ * rewriting their instance counts before UDrawRenderQueue.
+ *
+ * @param queue The sorted RenderQueue structure to prepare.
+ */
+void UPrepareRenderQueue(RenderQueue& queue)
+{
+    // A per-item submission binds the VAO, texture unit, sampler, and texture, then
+    // unbinds the VAO for every draw, after one program bind for the frame
+    queue.stats.items = (unsigned int)queue.items.size();
+    queue.stats.naiveStateChanges = queue.items.empty() ? 0 : 1 + 5 * (unsigned int)queue.items.size();
+    queue.stats.stateChanges = 0;
+    queue.stats.drawCalls = 0;
+
+    queue.batches.clear();
+    for (size_t i = 0; i < queue.streams.size(); ++i)
+    {
+        queue.streams[i].commands.clear();
+        queue.streams[i].instances.clear();
+        queue.streams[i].bounds.clear();
+    }
+
+    for (size_t i = 0; i < queue.entries.size(); ++i)
+    {
+        const RenderItem& item = queue.items[queue.entries[i].item];
+
+        // Find (or add) the stream feeding this item's arena
+        size_t stream = 0;
+        while (stream < queue.streams.size() && queue.streams[stream].arena != item.arena)
+            ++stream;
+        if (stream == queue.streams.size())
+        {
+            queue.streams.push_back(RenderArenaStream());
+            queue.streams.back().arena = item.arena;
+        }
+        RenderArenaStream& target = queue.streams[stream];
+
+        // Start a new batch when any bound state would change
+        if (queue.batches.empty() || queue.batches.back().program != item.program ||
+            queue.batches.back().texture != item.texture || queue.batches.back().stream != stream)
+        {
+            RenderBatch batch;
+            batch.program = item.program;
+            batch.texture = item.texture;
+            batch.stream = stream;
+            batch.firstCommand = (GLsizei)target.commands.size();
+            batch.commandCount = 0;
+            queue.batches.push_back(batch);
+        }
+        RenderBatch& batch = queue.batches.back();
+
+        GLuint instanceIndex = (GLuint)target.instances.size();
+        target.instances.push_back(item.instance);
+
+        if (queue.perInstanceCommands)
+        {
+            // The instance's model matrix also decodes quantized positions, so the box
+            // is given in the mesh's stored position space
+            const GLMesh& mesh = *item.mesh;
+            target.bounds.push_back(glm::vec4((mesh.boundsMin - mesh.positionBias) / mesh.positionScale, 0.0f));
+            target.bounds.push_back(glm::vec4((mesh.boundsMax - mesh.positionBias) / mesh.positionScale, 0.0f));
+        }
+
+        // Extend the previous command if it draws the same mesh
+        else if (batch.commandCount > 0)
+        {
+            DrawElementsIndirectCommand& last = target.commands.back();
+            if (last.firstIndex == item.mesh->firstIndex && last.baseVertex == item.mesh->baseVertex &&
+                last.baseInstance + last.instanceCount == instanceIndex)
+            {
+                ++last.instanceCount;
+                continue;
+            }
+        }
+
+        target.commands.push_back(UArenaCommand(*item.mesh, 1, instanceIndex));
+        ++batch.commandCount;
+    }
+
+    // Upload every arena's commands and instances once
+    for (size_t i = 0; i < queue.streams.size(); ++i)
+    {
+        RenderArenaStream& stream = queue.streams[i];
+        if (!stream.commands.empty())
+            UArenaUpload(*stream.arena, &stream.commands[0], (GLsizei)stream.commands.size(),
+                &stream.instances[0], (GLsizei)stream.instances.size());
+    }
+}
+
+/**
+ * @brief Draws the prepared batches, only changing GL state when it differs.
+ *
+ * Every batch is submitted with one glMultiDrawElementsIndirect, binding the
+ * program, texture, and VAO only when they differ from the previous batch.
+ * The draws read the arenas' indirect buffers, so counts rewritten on the GPU
+ * since UPrepareRenderQueue are honored.
+ *
+ * @param queue The prepared RenderQueue structure to draw.
+ * @param countGeometry Whether to report the commands' triangles to the render
+ *        statistics (false when the same commands are drawn again).
+ */
+void UDrawRenderQueue(RenderQueue& queue, bool countGeometry)
+{
+    GLuint currentProgram = 0;
+    GLuint currentTexture = 0;
+    const GLGeometryArena* currentArena = nullptr;
+
+    // Every batch samples from texture unit 0
+    UStateActiveTexture(GL_TEXTURE0);
+    ++queue.stats.stateChanges;
+
+    for (size_t i = 0; i < queue.batches.size(); ++i)
+    {
+        const RenderBatch& batch = queue.batches[i];
+        const GLGeometryArena& arena = *queue.streams[batch.stream].arena;
+
+        if (batch.program != currentProgram)
+        {
+            UStateUseProgram(batch.program);
+            currentProgram = batch.program;
+            ++queue.stats.stateChanges;
+        }
+
+        if (batch.texture != currentTexture)
+        {
+            UStateBindTexture(GL_TEXTURE_2D_ARRAY, batch.texture);
+            currentTexture = batch.texture;
+            ++queue.stats.stateChanges;
+        }
+
+        if (&arena != currentArena)
+        {
+            UBindGeometryArena(arena);
+            currentArena = &arena;
+            ++queue.stats.stateChanges;
+        }
+
+        UArenaDraw(arena, batch.firstCommand, batch.commandCount);
+        ++queue.stats.drawCalls;
+
+        // The commands are still on the CPU, so the submitted geometry is counted from them
+        if (!countGeometry)
+            continue;
+
+        const vector<DrawElementsIndirectCommand>& commands = queue.streams[batch.stream].commands;
+        for (GLsizei c = batch.firstCommand; c < batch.firstCommand + batch.commandCount; ++c)
+            UCountDrawnIndices(commands[c].count, commands[c].instanceCount);
+    }
+}
+
+/**
+ * @brief Draws the prepared commands into the depth buffer only.
+ *
+ * Every arena's commands are drawn with one glMultiDrawElementsIndirect
+ * through its position-only VAO, whatever program and texture their batches
+ * use, since the depth program reads neither. Color writes are off meanwhile.
+ * The submitted geometry is not counted again; the color pass counts it.
+ *
+ * @param queue The prepared RenderQueue structure to draw.
+ * @param depthProgram The position-only program writing depth.
+ */
+void UDrawRenderQueueDepth(RenderQueue& queue, GLuint depthProgram)
+{
+    // The depth program has no color output, so color writes are turned off
+    UStateColorMask(GL_FALSE);
+    UStateUseProgram(depthProgram);
+    queue.stats.stateChanges += 2;
+
+    for (size_t i = 0; i < queue.streams.size(); ++i)
+    {
+        const RenderArenaStream& stream = queue.streams[i];
+        if (stream.commands.empty())
+            continue;
+
+        UBindGeometryArenaPositions(*stream.arena);
+        ++queue.stats.stateChanges;
+
+        UArenaDraw(*stream.arena, 0, (GLsizei)stream.commands.size());
+        ++queue.stats.drawCalls;
+    }
+
+    UStateColorMask(GL_TRUE);
+    ++queue.stats.stateChanges;
+}
\ No newline at end of file
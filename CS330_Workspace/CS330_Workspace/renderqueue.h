@@ -0,0 +1,68 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "arena.h"
+
+// Struct to hold one draw submitted to the render queue
+struct RenderItem {
+    GLGeometryArena* arena;        // arena the mesh was allocated from (provides the VAO)
+    const GLMesh* mesh;
+    GLuint program;
+    GLuint texture;                // GL_TEXTURE_2D_ARRAY bound on texture unit 0
+    GLInstance instance;           // model matrix, normal matrix, and texture layer
+};
+
+// Struct to hold a sort key and the item it belongs to
+struct RenderSortEntry {
+    uint64_t key;    // program (16 bits) > texture (16 bits) > VAO (16 bits) > depth (16 bits)
+    uint32_t item;   // index into RenderQueue::items
+};
+
+// Struct to hold the commands and instances bound for one arena's buffers
+struct RenderArenaStream {
+    GLGeometryArena* arena;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GLInstance> instances;
+    std::vector<glm::vec4> bounds;   // stored-space box (min, max) of each instance, with perInstanceCommands
+};
+
+// Struct to hold a run of commands drawn with the same program, texture, and arena
+struct RenderBatch {
+    GLuint program;
+    GLuint texture;
+    size_t stream;          // index into RenderQueue::streams
+    GLsizei firstCommand;   // first command in the stream's command list
+    GLsizei commandCount;
+};
+
+// Struct to count the state changes issued by the submission pass
+struct RenderQueueStats {
+    unsigned int items;            // draw items submitted this frame
+    unsigned int drawCalls;        // glMultiDrawElementsIndirect calls issued
+    unsigned int stateChanges;     // program, VAO, and texture binds issued
+    unsigned int naiveStateChanges;// binds a per-item submission would have issued
+};
+
+// Struct to hold the draws submitted for one frame
+struct RenderQueue {
+    glm::vec3 cameraPos;                      // depth reference for the sort key
+    float farPlane;                           // distance mapped to the largest depth key
+    bool perInstanceCommands;                 // one command per instance (command i draws instance i), for GPU culling
+    std::vector<RenderItem> items;
+    std::vector<RenderSortEntry> entries;
+    std::vector<RenderSortEntry> scratch;     // ping-pong storage for the radix sort
+    std::vector<RenderArenaStream> streams;
+    std::vector<RenderBatch> batches;
+    RenderQueueStats stats;
+};
+
+void UBeginRenderQueue(RenderQueue& queue, const glm::vec3& cameraPos, float farPlane);
+void USubmit(RenderQueue& queue, GLGeometryArena& arena, const GLMesh& mesh, GLuint program, GLuint texture,
+    const GLInstance& instance);
+void USortRenderQueue(RenderQueue& queue);
+void UPrepareRenderQueue(RenderQueue& queue);
+void UDrawRenderQueue(RenderQueue& queue, bool countGeometry = true);
+void UDrawRenderQueueDepth(RenderQueue& queue, GLuint depthProgram);
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "renderstats.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// unnamed namespace to hold the counters shared by every module that reports into them
+namespace
+{
+    RenderStats gCurrent = {};
+    RenderStats gLastFrame = {};
+    unsigned long long gFrame = 0;
+
+    // bytes held by each live texture, so deleting one can subtract its share
+    vector<pair<GLuint, uint64_t> > gTextureMemory;
+
+    // optional log receiving one line every gLogInterval frames
+    ofstream gLog;
+    unsigned int gLogInterval = 0;
+
+    /**
+     * @brief Appends a count with a k or M suffix once it gets large.
+     */
+    void formatCount(ostream& out, uint64_t value)
+    {
+        if (value >= 1000000)
+            out << value / 1.0e6 << "M";
+        else if (value >= 1000)
+            out << value / 1.0e3 << "k";
+        else
+            out << value;
+    }
+
+    /**
+     * @brief Appends a byte count in KB or MB.
+     */
+    void formatBytes(ostream& out, uint64_t bytes)
+    {
+        if (bytes >= 1024 * 1024)
+            out << bytes / (1024.0 * 1024.0) << " MB";
+        else
+            out << bytes / 1024.0 << " KB";
+    }
+}
+
+
+/**
+ * @brief Starts counting a new frame.
+ *
+ * Every per-frame counter returns to zero; the resident texture memory is a
+ * running total and carries over.
+ */
+void UBeginRenderStatsFrame()
+{
+    uint64_t textureBytes = gCurrent.textureBytesResident;
+    gCurrent = RenderStats();
+    gCurrent.textureBytesResident = textureBytes;
+}
+
+/**
+ * @brief Finishes the frame, keeps its counters, and writes the log line when one is due.
+ */
+void UEndRenderStatsFrame()
+{
+    gLastFrame = gCurrent;
+    ++gFrame;
+
+    if (gLog.is_open() && gFrame % gLogInterval == 0)
+        gLog << "frame " << gFrame << ": " << UFormatRenderStats(gLastFrame) << "\n";
+}
+
+/**
+ * @brief Counts one draw call; a multi-draw counts once.
+ */
+void UCountDrawCall()
+{
+    ++gCurrent.drawCalls;
+}
+
+/**
+ * @brief Counts the triangles and vertices of one draw or one multi-draw command.
+ *
+ * @param indexCount The number of indices drawn per instance.
+ * @param instanceCount The number of instances drawn.
+ */
+void UCountDrawnIndices(uint64_t indexCount, uint64_t instanceCount)
+{
+    gCurrent.triangles += indexCount / 3 * instanceCount;
+    gCurrent.vertices += indexCount * instanceCount;
+}
+
+/**
+ * @brief Counts instances rejected before they reached the render queue.
+ *
+ * @param instances The number of instances culled.
+ */
+void UCountCulled(unsigned int instances)
+{
+    gCurrent.instancesCulled += instances;
+}
+
+/**
+ * @brief Counts instances the GPU occlusion test kept from being drawn.
+ *
+ * The GPU writes this count, so it reaches the CPU a few frames after the
+ * frame it describes.
+ *
+ * @param instances The number of instances occluded.
+ */
+void UCountOccluded(unsigned int instances)
+{
+    gCurrent.instancesOccluded += instances;
+}
+
+/**
+ * @brief Counts one glUniform* call.
+ */
+void UCountUniformCall()
+{
+    ++gCurrent.uniformCalls;
+}
+
+/**
+ * @brief Counts one texture bind that reached GL.
+ */
+void UCountTextureBind()
+{
+    ++gCurrent.textureBinds;
+}
+
+/**
+ * @brief Counts one program bind that reached GL.
+ */
+void UCountProgramBind()
+{
+    ++gCurrent.programBinds;
+}
+
+/**
+ * @brief Counts one vertex array bind that reached GL.
+ */
+void UCountVertexArrayBind()
+{
+    ++gCurrent.vaoBinds;
+}
+
+/**
+ * @brief Counts bytes written into buffer objects.
+ *
+ * @param bytes The number of bytes uploaded.
+ */
+void UCountBufferUpload(uint64_t bytes)
+{
+    gCurrent.bufferBytesUploaded += bytes;
+}
+
+/**
+ * @brief Adds a texture's storage to the resident texture memory.
+ *
+ * @param texture The ID of the texture.
+ * @param bytes The bytes allocated for every level and layer of the texture.
+ */
+void UTrackTextureMemory(GLuint texture, uint64_t bytes)
+{
+    gTextureMemory.push_back(make_pair(texture, bytes));
+    gCurrent.textureBytesResident += bytes;
+}
+
+/**
+ * @brief Removes a deleted texture's storage from the resident texture memory.
+ *
+ * @param texture The ID of the deleted texture.
+ */
+void UForgetTextureMemory(GLuint texture)
+{
+    for (size_t i = 0; i < gTextureMemory.size(); ++i)
+    {
+        if (gTextureMemory[i].first == texture)
+        {
+            gCurrent.textureBytesResident -= gTextureMemory[i].second;
+            gTextureMemory[i] = gTextureMemory.back();
+            gTextureMemory.pop_back();
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Returns the counters of the frame being recorded so far.
+ *
+ * @return The current RenderStats.
+ */
+const RenderStats& URenderStatsCurrent()
+{
+    return gCurrent;
+}
+
+/**
+ * @brief Returns the counters of the last completed frame.
+ *
+ * @return The RenderStats of the last frame ended with UEndRenderStatsFrame.
+ */
+const RenderStats& URenderStatsLastFrame()
+{
+    return gLastFrame;
+}
+
+/**
+ * @brief Formats the counters as one line for the window title or the log.
+ *
+ * @param stats The RenderStats to format.
+ * @return A line such as "draws 1 | culled 0 | occluded 0 | tris 5.3k | verts 16k | uniforms 0 | ...".
+ */
+string UFormatRenderStats(const RenderStats& stats)
+{
+    ostringstream line;
+    line.setf(ios::fixed);
+    line.precision(1);
+
+    line << "draws " << stats.drawCalls << " | culled " << stats.instancesCulled
+        << " | occluded " << stats.instancesOccluded << " | tris ";
+    formatCount(line, stats.triangles);
+    line << " | verts ";
+    formatCount(line, stats.vertices);
+    line << " | uniforms " << stats.uniformCalls
+        << " | tex binds " << stats.textureBinds
+        << " | programs " << stats.programBinds
+        << " | VAOs " << stats.vaoBinds
+        << " | upload ";
+    formatBytes(line, stats.bufferBytesUploaded);
+    line << " | textures ";
+    formatBytes(line, stats.textureBytesResident);
+
+    return line.str();
+}
+
+/**
+ * @brief Opens a log that receives the counters of every interval-th frame.
+ *
+ * @param filename The log file to write.
+ * @param interval The number of frames between log lines.
+ * @return True if the log was opened, otherwise false.
+ */
+bool UOpenRenderStatsLog(const char* filename, unsigned int interval)
+{
+    gLog.open(filename);
+    if (!gLog)
+    {
+        cout << "ERROR::RENDERSTATS::LOG_OPEN_FAILED " << filename << endl;
+        return false;
+    }
+
+    gLogInterval = interval > 0 ? interval : 1;
+    return true;
+}
+
+/**
+ * @brief Flushes and closes the log.
+ */
+void UCloseRenderStatsLog()
+{
+    if (gLog.is_open())
+        gLog.close();
+}
\ No newline at end of file
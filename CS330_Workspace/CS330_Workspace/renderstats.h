@@ -0,0 +1,39 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+// Struct to hold the driver work issued during one frame
+struct RenderStats {
+    unsigned int drawCalls;         // draw and multi-draw calls issued
+    unsigned int instancesCulled;   // instances rejected before submission
+    unsigned int instancesOccluded; // instances rejected by the GPU occlusion test, a few frames old
+    uint64_t triangles;             // triangles submitted, over every instance
+    uint64_t vertices;              // indices submitted, i.e. vertices fetched before post-transform caching
+    unsigned int uniformCalls;      // glUniform* calls issued
+    unsigned int textureBinds;      // glBindTexture calls that reached GL
+    unsigned int programBinds;      // glUseProgram calls that reached GL
+    unsigned int vaoBinds;          // glBindVertexArray calls that reached GL
+    uint64_t bufferBytesUploaded;   // bytes written to buffer objects (glBufferSubData, mapped writes)
+    uint64_t textureBytesResident;  // bytes held by live textures, including mip levels
+};
+
+void UBeginRenderStatsFrame();
+void UEndRenderStatsFrame();
+void UCountDrawCall();
+void UCountDrawnIndices(uint64_t indexCount, uint64_t instanceCount);
+void UCountCulled(unsigned int instances);
+void UCountOccluded(unsigned int instances);
+void UCountUniformCall();
+void UCountTextureBind();
+void UCountProgramBind();
+void UCountVertexArrayBind();
+void UCountBufferUpload(uint64_t bytes);
+void UTrackTextureMemory(GLuint texture, uint64_t bytes);
+void UForgetTextureMemory(GLuint texture);
+const RenderStats& URenderStatsCurrent();
+const RenderStats& URenderStatsLastFrame();
+std::string UFormatRenderStats(const RenderStats& stats);
+bool UOpenRenderStatsLog(const char* filename, unsigned int interval);
+void UCloseRenderStatsLog();
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "ringbuffer.h"
+#include "cpuprofiler.h"
+#include "renderstats.h"
+#include <cstring>
+#include <iostream>
+using namespace std;
+
+/**
+ * @brief Creates a triple-buffered, persistently mapped buffer.
+ *
+ * This function allocates immutable storage for RING_BUFFER_FRAMES regions of
+ * frameSize bytes each and maps the whole buffer once with GL_MAP_PERSISTENT_BIT
+ * and GL_MAP_COHERENT_BIT. Writes through the mapping become visible to the GPU
+ * without any flush or unmap, so a frame's uniform data costs one memcpy.
+ *
+ * @param frameSize The number of bytes each frame is allowed to write.
+ * @param ring The GLRingBuffer structure to hold the buffer data.
+ * @return True if the buffer was created and mapped, otherwise false.
+ */
+bool UCreateRingBuffer(GLsizeiptr frameSize, GLRingBuffer& ring)
+{
+    CPU_ZONE("UCreateRingBuffer");
+
+    // Bind-range offsets must be multiples of the uniform buffer offset alignment
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    ring.alignment = alignment > 0 ? alignment : 256;
+
+    // Round each region up so every frame starts on an aligned offset
+    ring.frameSize = (frameSize + ring.alignment - 1) / ring.alignment * ring.alignment;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &ring.buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, ring.frameSize * RING_BUFFER_FRAMES, NULL, flags);
+    ring.mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, ring.frameSize * RING_BUFFER_FRAMES, flags);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    for (int i = 0; i < RING_BUFFER_FRAMES; ++i)
+        ring.fences[i] = 0;
+
+    ring.frame = 0;
+    ring.offset = 0;
+
+    if (!ring.mapped)
+    {
+        cout << "ERROR::RINGBUFFER::MAPPING_FAILED" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Starts writing the next frame's region of the ring buffer.
+ *
+ * This function waits on the fence placed the last time this region was used,
+ * so the CPU never overwrites data the GPU may still be reading. With three
+ * regions the wait only blocks when the CPU is more than two frames ahead.
+ *
+ * @param ring The GLRingBuffer structure to write into.
+ */
+void UBeginRingBufferFrame(GLRingBuffer& ring)
+{
+    GLsync& fence = ring.fences[ring.frame];
+
+    if (fence)
+    {
+        // Flush once so the fence is guaranteed to signal, then keep waiting
+        GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;)
+        {
+            GLenum result = glClientWaitSync(fence, waitFlags, 1000000); // 1 ms
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+                break;
+            waitFlags = 0;
+        }
+
+        glDeleteSync(fence);
+        fence = 0;
+    }
+
+    ring.offset = 0;
+}
+
+/**
+ * @brief Copies data into the current frame's region.
+ *
+ * @param ring The GLRingBuffer structure to write into.
+ * @param data A pointer to the data to be copied.
+ * @param size The number of bytes to copy.
+ * @return The absolute buffer offset of the copied data, for use with glBindBufferRange,
+ *         or -1 if the region is full.
+ */
+GLintptr UWriteRingBuffer(GLRingBuffer& ring, const void* data, GLsizeiptr size)
+{
+    if (ring.offset + size > ring.frameSize)
+    {
+        cout << "ERROR::RINGBUFFER::FRAME_REGION_FULL" << endl;
+        return -1;
+    }
+
+    GLintptr offset = ring.frame * ring.frameSize + ring.offset;
+    memcpy(ring.mapped + offset, data, size);
+    UCountBufferUpload(size);
+
+    // Keep the next write aligned for bind-range calls
+    ring.offset += (size + ring.alignment - 1) / ring.alignment * ring.alignment;
+
+    return offset;
+}
+
+/**
+ * @brief Finishes the current frame and moves on to the next region.
+ *
+ * This function places a fence after all commands that read the region, which
+ * UBeginRingBufferFrame waits on when the region comes around again.
+ *
+ * @param ring The GLRingBuffer structure being written.
+ */
+void UEndRingBufferFrame(GLRingBuffer& ring)
+{
+    ring.fences[ring.frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring.frame = (ring.frame + 1) % RING_BUFFER_FRAMES;
+}
+
+/**
+ * @brief Unmaps and deletes the ring buffer and its fences.
+ *
+ * @param ring The GLRingBuffer structure to be destroyed.
+ */
+void UDestroyRingBuffer(GLRingBuffer& ring)
+{
+    for (int i = 0; i < RING_BUFFER_FRAMES; ++i)
+    {
+        if (ring.fences[i])
+            glDeleteSync(ring.fences[i]);
+        ring.fences[i] = 0;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ring.buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glDeleteBuffers(1, &ring.buffer);
+    ring.mapped = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <GL/glew.h>
+
+// Number of frames the CPU may write ahead of the GPU
+const int RING_BUFFER_FRAMES = 3;
+
+// Struct to hold a persistently mapped, fence-guarded buffer split into per-frame regions
+struct GLRingBuffer {
+    GLuint buffer;
+    GLsizeiptr frameSize;              // bytes reserved for each frame
+    GLsizeiptr alignment;              // offset alignment for bind-range calls
+    unsigned char* mapped;             // persistent, coherent mapping of the whole buffer
+    GLsync fences[RING_BUFFER_FRAMES]; // signalled when the GPU is done with a region
+    int frame;                         // region currently being written
+    GLsizeiptr offset;                 // write cursor inside the current region
+};
+
+bool UCreateRingBuffer(GLsizeiptr frameSize, GLRingBuffer& ring);
+void UBeginRingBufferFrame(GLRingBuffer& ring);
+GLintptr UWriteRingBuffer(GLRingBuffer& ring, const void* data, GLsizeiptr size);
+void UEndRingBufferFrame(GLRingBuffer& ring);
+void UDestroyRingBuffer(GLRingBuffer& ring);
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "scene.h"
+#include "cpuprofiler.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+using namespace std;
+
+namespace
+{
+    /**
+     * @brief Copies a string into a fixed-size, zero-padded record field.
+     *
+     * @return False if the string does not fit.
+     */
+    bool copyName(char* dst, size_t capacity, const string& src)
+    {
+        if (src.size() >= capacity)
+            return false;
+
+        memset(dst, 0, capacity);
+        memcpy(dst, src.c_str(), src.size());
+        return true;
+    }
+
+    /**
+     * @brief Checks that count records of recordSize bytes at offset lie inside the file.
+     */
+    bool rangeInFile(uint32_t offset, uint32_t count, size_t recordSize, size_t fileSize)
+    {
+        if (offset % 4 != 0 || offset > fileSize)
+            return false;
+        return (uint64_t)count * recordSize <= fileSize - offset;
+    }
+
+    /**
+     * @brief Points the scene at the records of a binary scene file.
+     *
+     * Nothing is copied: the records are used in place from the mapping.
+     */
+    bool loadBinaryScene(SceneDescription& scene)
+    {
+        const MappedFile& file = scene.file;
+        if (file.size < sizeof(SceneBinaryHeader))
+            return false;
+
+        SceneBinaryHeader header;
+        memcpy(&header, file.data, sizeof(header));
+
+        if (header.version != SCENE_BINARY_VERSION)
+        {
+            cout << "ERROR::SCENE::UNSUPPORTED_VERSION " << header.version << endl;
+            return false;
+        }
+
+        if (!rangeInFile(header.meshOffset, header.meshCount, sizeof(SceneMeshRecord), file.size) ||
+            !rangeInFile(header.materialOffset, header.materialCount, sizeof(SceneMaterialRecord), file.size) ||
+            !rangeInFile(header.instanceOffset, header.instanceCount, sizeof(SceneInstanceRecord), file.size) ||
+            !rangeInFile(header.lightOffset, header.lightCount, sizeof(SceneLightRecord), file.size))
+            return false;
+
+        scene.meshes = (const SceneMeshRecord*)(file.data + header.meshOffset);
+        scene.materials = (const SceneMaterialRecord*)(file.data + header.materialOffset);
+        scene.instances = (const SceneInstanceRecord*)(file.data + header.instanceOffset);
+        scene.lights = (const SceneLightRecord*)(file.data + header.lightOffset);
+        scene.meshCount = header.meshCount;
+        scene.materialCount = header.materialCount;
+        scene.instanceCount = header.instanceCount;
+        scene.lightCount = header.lightCount;
+
+        return true;
+    }
+
+    /**
+     * @brief Parses a text scene file into the scene's storage vectors.
+     *
+     * Each line holds one record; blank lines and lines starting with '#' are skipped:
+     *
+     *   mesh <name> <cube|cylinder|sphere|plane> [segments]
+     *   mesh <name> model <.obj, .gltf, or .glb path>
+     *   material <name> <texture path>
+     *   instance <mesh> <material> <tx ty tz> <angle ax ay az> <sx sy sz> [parent]
+     *   light point <px py pz> <r g b>
+     *   light spot <px py pz> <dx dy dz> <r g b> <cutOff> <outerCutOff>
+     *
+     * Angles are in radians for instances and in degrees for spotlight cones.
+     * Cylinders and spheres given segments keep that tessellation; without
+     * them they get a level-of-detail chain (see lod.h).
+     * The optional parent is the zero-based index of an earlier instance.
+     */
+    bool loadTextScene(SceneDescription& scene)
+    {
+        const char* cursor = (const char*)scene.file.data;
+        const char* end = cursor + scene.file.size;
+
+        map<string, uint32_t> meshNames;
+        map<string, uint32_t> materialNames;
+        int lineNumber = 0;
+
+        while (cursor < end)
+        {
+            const char* lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+            if (!lineEnd)
+                lineEnd = end;
+            istringstream line(string(cursor, lineEnd));
+            cursor = lineEnd + 1;
+            ++lineNumber;
+
+            string keyword;
+            if (!(line >> keyword) || keyword[0] == '#')
+                continue;
+
+            bool valid = false;
+            if (keyword == "mesh")
+            {
+                SceneMeshRecord mesh;
+                string name, primitive, source;
+                mesh.segments = 0;
+                memset(mesh.source, 0, SCENE_PATH_LENGTH);
+                valid = (line >> name >> primitive) && copyName(mesh.name, SCENE_NAME_LENGTH, name);
+                if (valid && primitive == "model")
+                    valid = (line >> source) && copyName(mesh.source, SCENE_PATH_LENGTH, source);
+                else if (valid && !(line >> mesh.segments))
+                    mesh.segments = 0;
+
+                if (primitive == "cube")
+                    mesh.primitive = SCENE_PRIMITIVE_CUBE;
+                else if (primitive == "cylinder")
+                    mesh.primitive = SCENE_PRIMITIVE_CYLINDER;
+                else if (primitive == "sphere")
+                    mesh.primitive = SCENE_PRIMITIVE_SPHERE;
+                else if (primitive == "plane")
+                    mesh.primitive = SCENE_PRIMITIVE_PLANE;
+                else if (primitive == "model")
+                    mesh.primitive = SCENE_PRIMITIVE_MODEL;
+                else
+                    valid = false;
+
+                if (valid)
+                {
+                    meshNames[name] = (uint32_t)scene.meshStorage.size();
+                    scene.meshStorage.push_back(mesh);
+                }
+            }
+            else if (keyword == "material")
+            {
+                SceneMaterialRecord material;
+                string name, texture;
+                valid = (line >> name >> texture) &&
+                    copyName(material.name, SCENE_NAME_LENGTH, name) &&
+                    copyName(material.texture, SCENE_PATH_LENGTH, texture);
+
+                if (valid)
+                {
+                    materialNames[name] = (uint32_t)scene.materialStorage.size();
+                    scene.materialStorage.push_back(material);
+                }
+            }
+            else if (keyword == "instance")
+            {
+                SceneInstanceRecord instance;
+                string meshName, materialName;
+                float angle;
+                glm::vec3 axis;
+                valid = (line >> meshName >> materialName) &&
+                    (line >> instance.translation[0] >> instance.translation[1] >> instance.translation[2]) &&
+                    (line >> angle >> axis.x >> axis.y >> axis.z) &&
+                    (line >> instance.scale[0] >> instance.scale[1] >> instance.scale[2]);
+
+                if (!(line >> instance.parent))
+                    instance.parent = SCENE_NO_PARENT_INSTANCE;
+
+                map<string, uint32_t>::const_iterator mesh = meshNames.find(meshName);
+                map<string, uint32_t>::const_iterator material = materialNames.find(materialName);
+                valid = valid && mesh != meshNames.end() && material != materialNames.end() &&
+                    glm::length(axis) > 0.0f;
+
+                if (valid)
+                {
+                    glm::quat rotation = glm::angleAxis(angle, glm::normalize(axis));
+                    instance.mesh = mesh->second;
+                    instance.material = material->second;
+                    instance.rotation[0] = rotation.x;
+                    instance.rotation[1] = rotation.y;
+                    instance.rotation[2] = rotation.z;
+                    instance.rotation[3] = rotation.w;
+                    scene.instanceStorage.push_back(instance);
+                }
+            }
+            else if (keyword == "light")
+            {
+                SceneLightRecord light;
+                string type;
+                memset(&light, 0, sizeof(light));
+                valid = (bool)(line >> type);
+
+                if (valid && type == "point")
+                {
+                    light.type = SCENE_LIGHT_POINT;
+                    valid = (line >> light.position[0] >> light.position[1] >> light.position[2]) &&
+                        (line >> light.color[0] >> light.color[1] >> light.color[2]);
+                }
+                else if (valid && type == "spot")
+                {
+                    float cutOff, outerCutOff;
+                    light.type = SCENE_LIGHT_SPOT;
+                    valid = (line >> light.position[0] >> light.position[1] >> light.position[2]) &&
+                        (line >> light.direction[0] >> light.direction[1] >> light.direction[2]) &&
+                        (line >> light.color[0] >> light.color[1] >> light.color[2]) &&
+                        (line >> cutOff >> outerCutOff);
+                    light.cutOff = cos(glm::radians(cutOff));
+                    light.outerCutOff = cos(glm::radians(outerCutOff));
+                }
+                else
+                    valid = false;
+
+                if (valid)
+                    scene.lightStorage.push_back(light);
+            }
+
+            if (!valid)
+            {
+                cout << "ERROR::SCENE::PARSE_FAILED line " << lineNumber << ": " << keyword << endl;
+                return false;
+            }
+        }
+
+        scene.meshes = scene.meshStorage.data();
+        scene.materials = scene.materialStorage.data();
+        scene.instances = scene.instanceStorage.data();
+        scene.lights = scene.lightStorage.data();
+        scene.meshCount = (uint32_t)scene.meshStorage.size();
+        scene.materialCount = (uint32_t)scene.materialStorage.size();
+        scene.instanceCount = (uint32_t)scene.instanceStorage.size();
+        scene.lightCount = (uint32_t)scene.lightStorage.size();
+
+        return true;
+    }
+
+    /**
+     * @brief Checks that every index in the scene refers to an existing record.
+     */
+    bool validateScene(const SceneDescription& scene)
+    {
+        for (uint32_t i = 0; i < scene.meshCount; ++i)
+        {
+            const SceneMeshRecord& mesh = scene.meshes[i];
+            if (mesh.primitive > SCENE_PRIMITIVE_MODEL)
+                return false;
+            if (mesh.primitive == SCENE_PRIMITIVE_MODEL && memchr(mesh.source, '\0', SCENE_PATH_LENGTH) == nullptr)
+                return false;
+        }
+
+        for (uint32_t i = 0; i < scene.instanceCount; ++i)
+        {
+            const SceneInstanceRecord& instance = scene.instances[i];
+            if (instance.mesh >= scene.meshCount || instance.material >= scene.materialCount)
+                return false;
+            if (instance.parent != SCENE_NO_PARENT_INSTANCE && instance.parent >= i)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+/**
+ * @brief Loads a scene from a text or binary scene file.
+ *
+ * The file is memory mapped. Binary files (starting with SCENE_BINARY_MAGIC)
+ * are used in place, so loading costs one validation pass over the records.
+ * Anything else is parsed as the text format described in loadTextScene.
+ *
+ * @param filename The path of the scene file.
+ * @param scene The SceneDescription structure to hold the scene.
+ * @return True if the scene was loaded and is consistent, otherwise false.
+ */
+bool ULoadScene(const char* filename, SceneDescription& scene)
+{
+    CPU_ZONE("ULoadScene");
+
+    scene.meshes = nullptr;
+    scene.materials = nullptr;
+    scene.instances = nullptr;
+    scene.lights = nullptr;
+    scene.meshCount = scene.materialCount = scene.instanceCount = scene.lightCount = 0;
+
+    if (!UOpenMappedFile(filename, scene.file))
+        return false;
+
+    uint32_t magic = 0;
+    if (scene.file.size >= sizeof(magic))
+        memcpy(&magic, scene.file.data, sizeof(magic));
+
+    bool loaded = magic == SCENE_BINARY_MAGIC ? loadBinaryScene(scene) : loadTextScene(scene);
+    if (!loaded || !validateScene(scene))
+    {
+        cout << "ERROR::SCENE::LOAD_FAILED " << filename << endl;
+        UDestroyScene(scene);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Writes a scene in the binary format read by ULoadScene.
+ *
+ * @param scene The SceneDescription structure to write.
+ * @param filename The path of the binary file to create.
+ * @return True if the file was written, otherwise false.
+ */
+bool USaveSceneBinary(const SceneDescription& scene, const char* filename)
+{
+    SceneBinaryHeader header;
+    header.magic = SCENE_BINARY_MAGIC;
+    header.version = SCENE_BINARY_VERSION;
+    header.meshCount = scene.meshCount;
+    header.materialCount = scene.materialCount;
+    header.instanceCount = scene.instanceCount;
+    header.lightCount = scene.lightCount;
+    header.meshOffset = sizeof(SceneBinaryHeader);
+    header.materialOffset = header.meshOffset + scene.meshCount * sizeof(SceneMeshRecord);
+    header.instanceOffset = header.materialOffset + scene.materialCount * sizeof(SceneMaterialRecord);
+    header.lightOffset = header.instanceOffset + scene.instanceCount * sizeof(SceneInstanceRecord);
+
+    ofstream out(filename, ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)scene.meshes, scene.meshCount * sizeof(SceneMeshRecord));
+    out.write((const char*)scene.materials, scene.materialCount * sizeof(SceneMaterialRecord));
+    out.write((const char*)scene.instances, scene.instanceCount * sizeof(SceneInstanceRecord));
+    out.write((const char*)scene.lights, scene.lightCount * sizeof(SceneLightRecord));
+
+    if (!out)
+    {
+        cout << "ERROR::SCENE::WRITE_FAILED " << filename << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Releases the scene's records and its file mapping.
+ *
+ * @param scene The SceneDescription structure to be destroyed.
+ */
+void UDestroyScene(SceneDescription& scene)
+{
+    UCloseMappedFile(scene.file);
+    scene.meshStorage.clear();
+    scene.materialStorage.clear();
+    scene.instanceStorage.clear();
+    scene.lightStorage.clear();
+    scene.meshes = nullptr;
+    scene.materials = nullptr;
+    scene.instances = nullptr;
+    scene.lights = nullptr;
+    scene.meshCount = scene.materialCount = scene.instanceCount = scene.lightCount = 0;
+}
\ No newline at end of file
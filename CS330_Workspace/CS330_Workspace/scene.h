@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "mappedfile.h"
+
+// Binary scene files start with SCENE_BINARY_MAGIC ("SCN1" in file order)
+const uint32_t SCENE_BINARY_MAGIC = 0x314E4353;
+const uint32_t SCENE_BINARY_VERSION = 2;
+
+const int SCENE_NAME_LENGTH = 64;
+const int SCENE_PATH_LENGTH = 128;
+
+// Parent index of an instance without a parent
+const uint32_t SCENE_NO_PARENT_INSTANCE = 0xFFFFFFFF;
+
+// Procedural mesh kinds (see mesh.h), and meshes imported from model files (see meshimport.h)
+enum ScenePrimitive
+{
+    SCENE_PRIMITIVE_CUBE = 0,
+    SCENE_PRIMITIVE_CYLINDER = 1,
+    SCENE_PRIMITIVE_SPHERE = 2,
+    SCENE_PRIMITIVE_PLANE = 3,
+    SCENE_PRIMITIVE_MODEL = 4
+};
+
+enum SceneLightType
+{
+    SCENE_LIGHT_POINT = 0,
+    SCENE_LIGHT_SPOT = 1
+};
+
+// The records below are the on-disk layout of binary scene files. They only
+// hold 4-byte fields, so they have no padding and can be read in place.
+
+// Struct to hold a mesh: a primitive and its tessellation, or a model file
+struct SceneMeshRecord {
+    char name[SCENE_NAME_LENGTH];
+    uint32_t primitive;             // ScenePrimitive
+    uint32_t segments;              // fixed tessellation (0 for a level-of-detail chain)
+    char source[SCENE_PATH_LENGTH]; // .obj, .gltf, or .glb path relative to the working directory (models only)
+};
+
+// Struct to hold a material: one layer of the material texture array
+struct SceneMaterialRecord {
+    char name[SCENE_NAME_LENGTH];
+    char texture[SCENE_PATH_LENGTH];  // image path relative to the working directory
+};
+
+// Struct to hold an instance of a mesh placed in the scene
+struct SceneInstanceRecord {
+    uint32_t mesh;          // index into the mesh records
+    uint32_t material;      // index into the material records
+    uint32_t parent;        // earlier instance this one is attached to, or SCENE_NO_PARENT_INSTANCE
+    float translation[3];
+    float rotation[4];      // unit quaternion (x, y, z, w)
+    float scale[3];
+};
+
+// Struct to hold a point light or a spotlight
+struct SceneLightRecord {
+    uint32_t type;          // SceneLightType
+    float position[3];
+    float direction[3];     // spotlights only
+    float color[3];
+    float cutOff;           // cosine of the inner cone angle (spotlights only)
+    float outerCutOff;      // cosine of the outer cone angle (spotlights only)
+};
+
+// Struct to hold the header of a binary scene file; offsets are from the start of the file
+struct SceneBinaryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t materialCount;
+    uint32_t instanceCount;
+    uint32_t lightCount;
+    uint32_t meshOffset;
+    uint32_t materialOffset;
+    uint32_t instanceOffset;
+    uint32_t lightOffset;
+};
+
+// Struct to hold a loaded scene. The record pointers point into the file mapping
+// for binary scenes and into the storage vectors for text scenes.
+struct SceneDescription {
+    const SceneMeshRecord* meshes;
+    const SceneMaterialRecord* materials;
+    const SceneInstanceRecord* instances;
+    const SceneLightRecord* lights;
+    uint32_t meshCount;
+    uint32_t materialCount;
+    uint32_t instanceCount;
+    uint32_t lightCount;
+
+    std::vector<SceneMeshRecord> meshStorage;
+    std::vector<SceneMaterialRecord> materialStorage;
+    std::vector<SceneInstanceRecord> instanceStorage;
+    std::vector<SceneLightRecord> lightStorage;
+    MappedFile file;
+};
+
+bool ULoadScene(const char* filename, SceneDescription& scene);
+bool USaveSceneBinary(const SceneDescription& scene, const char* filename);
+void UDestroyScene(SceneDescription& scene);
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "scenegraph.h"
+#include <glm/simd/matrix.h>
+using namespace std;
+
+/**
+ * @brief Appends a node to the scene graph.
+ *
+ * The node starts dirty, so its matrices are computed by the next
+ * UUpdateSceneGraph call.
+ *
+ * @param scene The SceneGraph structure to add to.
+ * @param parent The index of an existing node, or SCENE_NO_PARENT for a root.
+ * @param translation The node's translation relative to its parent.
+ * @param rotation The node's rotation relative to its parent.
+ * @param scale The node's scale relative to its parent.
+ * @return The index of the new node.
+ */
+uint32_t UAddSceneNode(SceneGraph& scene, uint32_t parent, const glm::vec3& translation,
+    const glm::quat& rotation, const glm::vec3& scale)
+{
+    uint32_t node = (uint32_t)scene.parents.size();
+
+    // Parents must come first for the single-pass update
+    if (parent != SCENE_NO_PARENT && parent >= node)
+        parent = SCENE_NO_PARENT;
+
+    scene.parents.push_back(parent);
+    scene.translations.push_back(translation);
+    scene.rotations.push_back(rotation);
+    scene.scales.push_back(scale);
+    scene.locals.push_back(glm::mat4(1.0f));
+    scene.worlds.push_back(glm::mat4(1.0f));
+    scene.localDirty.push_back(1);
+    scene.worldChanged.push_back(0);
+
+    return node;
+}
+
+/**
+ * @brief Sets a node's translation and marks it dirty.
+ *
+ * @param scene The SceneGraph structure holding the node.
+ * @param node The index of the node.
+ * @param translation The new translation relative to the parent.
+ */
+void USetNodeTranslation(SceneGraph& scene, uint32_t node, const glm::vec3& translation)
+{
+    scene.translations[node] = translation;
+    scene.localDirty[node] = 1;
+}
+
+/**
+ * @brief Sets a node's rotation and marks it dirty.
+ *
+ * @param scene The SceneGraph structure holding the node.
+ * @param node The index of the node.
+ * @param rotation The new rotation relative to the parent.
+ */
+void USetNodeRotation(SceneGraph& scene, uint32_t node, const glm::quat& rotation)
+{
+    scene.rotations[node] = rotation;
+    scene.localDirty[node] = 1;
+}
+
+/**
+ * @brief Sets a node's scale and marks it dirty.
+ *
+ * @param scene The SceneGraph structure holding the node.
+ * @param node The index of the node.
+ * @param scale The new scale relative to the parent.
+ */
+void USetNodeScale(SceneGraph& scene, uint32_t node, const glm::vec3& scale)
+{
+    scene.scales[node] = scale;
+    scene.localDirty[node] = 1;
+}
+
+/**
+ * @brief Recomputes the world matrices of dirty subtrees.
+ *
+ * This function makes one forward pass to flag every node whose own TRS or
+ * any ancestor's TRS changed, then recomputes only those nodes. Local matrices
+ * are built straight from the TRS arrays, and world matrices are multiplied
+ * with glm's SSE matrix product when it is available. A scene where nothing
+ * moved does no matrix math at all. The indices of the recomputed nodes are
+ * left in scene.updated so callers can refresh data derived from them.
+ *
+ * Each product stays per node: glm's already works on a whole column at a
+ * time, and the matrices are stored and read per node, so batching several
+ * nodes of a depth level into structure-of-arrays lanes costs a transpose on
+ * the way in and out. Measured, that made propagation slower, not faster.
+ *
+ * @param scene The SceneGraph structure to update.
+ */
+void UUpdateSceneGraph(SceneGraph& scene)
+{
+    size_t count = scene.parents.size();
+    scene.updated.clear();
+
+    // Propagate dirtiness from parents to children
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t parent = scene.parents[i];
+        bool changed = scene.localDirty[i] || (parent != SCENE_NO_PARENT && scene.worldChanged[parent]);
+        scene.worldChanged[i] = changed ? 1 : 0;
+        if (changed)
+            scene.updated.push_back((uint32_t)i);
+    }
+
+    // Rebuild local matrices as T * R * S without any matrix products
+    for (size_t n = 0; n < scene.updated.size(); ++n)
+    {
+        uint32_t i = scene.updated[n];
+        if (!scene.localDirty[i])
+            continue;
+
+        glm::mat4 local = glm::mat4_cast(scene.rotations[i]);
+        local[0] *= scene.scales[i].x;
+        local[1] *= scene.scales[i].y;
+        local[2] *= scene.scales[i].z;
+        local[3] = glm::vec4(scene.translations[i], 1.0f);
+
+        scene.locals[i] = local;
+        scene.localDirty[i] = 0;
+    }
+
+    // Multiply by the parent world matrix; parents precede children in updated
+    for (size_t n = 0; n < scene.updated.size(); ++n)
+    {
+        uint32_t i = scene.updated[n];
+        uint32_t parent = scene.parents[i];
+        if (parent == SCENE_NO_PARENT)
+        {
+            scene.worlds[i] = scene.locals[i];
+            continue;
+        }
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        glm_vec4 parentColumns[4];
+        glm_vec4 localColumns[4];
+        glm_vec4 worldColumns[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            parentColumns[c] = _mm_loadu_ps(&scene.worlds[parent][c][0]);
+            localColumns[c] = _mm_loadu_ps(&scene.locals[i][c][0]);
+        }
+
+        glm_mat4_mul(parentColumns, localColumns, worldColumns);
+
+        for (int c = 0; c < 4; ++c)
+            _mm_storeu_ps(&scene.worlds[i][c][0], worldColumns[c]);
+#else
+        scene.worlds[i] = scene.worlds[parent] * scene.locals[i];
+#endif
+    }
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+
+// Parent index of a root node
+const uint32_t SCENE_NO_PARENT = 0xFFFFFFFF;
+
+// Struct to hold a transform hierarchy in structure-of-arrays order.
+// Every node is stored after its parent, so one forward pass over the arrays
+// sees each parent's world matrix before any of its children need it.
+struct SceneGraph {
+    std::vector<uint32_t> parents;         // SCENE_NO_PARENT for roots
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> locals;         // cached T * R * S
+    std::vector<glm::mat4> worlds;         // cached parent world * local
+    std::vector<uint8_t> localDirty;       // TRS changed since the last update
+    std::vector<uint8_t> worldChanged;     // world matrix recomputed by the last update
+    std::vector<uint32_t> updated;         // nodes whose world matrix the last update recomputed
+};
+
+uint32_t UAddSceneNode(SceneGraph& scene, uint32_t parent, const glm::vec3& translation,
+    const glm::quat& rotation, const glm::vec3& scale);
+void USetNodeTranslation(SceneGraph& scene, uint32_t node, const glm::vec3& translation);
+void USetNodeRotation(SceneGraph& scene, uint32_t node, const glm::quat& rotation);
+void USetNodeScale(SceneGraph& scene, uint32_t node, const glm::vec3& scale);
+void UUpdateSceneGraph(SceneGraph& scene);
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "shader.h"
+#include "cpuprofiler.h"
+#include "glstate.h"
+#include "renderstats.h"
 #include <iostream>
+#include <cassert>
+#include <glm/gtc/type_ptr.hpp>
 using namespace std;
 
 /**
@@ -16,6 +21,8 @@ using namespace std;
  */
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId)
 {
+    CPU_ZONE("UCreateShaderProgram");
+
     // Linkage error reporting
     int success = 0;
     char infoLog[512];
@@ -73,11 +80,212 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
     }
 
     // Uses the shader program
-    glUseProgram(programId);
+    UStateUseProgram(programId);
 
     return true;
 }
 
+// unnamed namespace to hold helpers shared by the program creation functions
+namespace
+{
+    /**
+     * @brief Enumerates a linked program's active uniforms into its handle list.
+     */
+    void reflectUniforms(GLProgram& program)
+    {
+        // Number of active uniforms and the longest name among them
+        GLint numUniforms = 0;
+        GLint maxNameLength = 0;
+        glGetProgramInterfaceiv(program.id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);
+        glGetProgramInterfaceiv(program.id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+        vector<char> name(maxNameLength > 0 ? maxNameLength : 1);
+        const GLenum properties[] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+
+        for (GLint i = 0; i < numUniforms; ++i)
+        {
+            GLint values[4];
+            glGetProgramResourceiv(program.id, GL_UNIFORM, i, 4, properties, 4, NULL, values);
+
+            // Uniforms that live in a uniform block have no location of their own
+            if (values[3] != -1)
+                continue;
+
+            GLsizei length = 0;
+            glGetProgramResourceName(program.id, GL_UNIFORM, i, (GLsizei)name.size(), &length, &name[0]);
+
+            // Arrays are reported as "name[0]"; store them under their plain name
+            string uniformName(&name[0], length);
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                uniformName.resize(uniformName.size() - 3);
+
+            GLUniform uniform;
+            uniform.location = values[0];
+            uniform.type = (GLenum)values[1];
+            uniform.arraySize = values[2];
+
+            program.uniformNames.push_back(uniformName);
+            program.uniforms.push_back(uniform);
+        }
+    }
+}
+
+/**
+ * @brief Creates a shader program and resolves all of its active uniforms.
+ *
+ * This function builds the program the same way as the GLuint overload, then
+ * enumerates the active uniforms once through the program interface query
+ * (GL_UNIFORM / GL_ACTIVE_RESOURCES) and stores their location, type, and array
+ * size. Render code looks handles up once with UGetUniform and never calls
+ * glGetUniformLocation on the hot path.
+ *
+ * @param vtxShaderSource The source code of the vertex shader.
+ * @param fragShaderSource The source code of the fragment shader.
+ * @param program The program object that will hold the ID and the resolved uniforms.
+ * @return True if the shader program is successfully created, otherwise false.
+ */
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLProgram& program)
+{
+    program.uniformNames.clear();
+    program.uniforms.clear();
+
+    if (!UCreateShaderProgram(vtxShaderSource, fragShaderSource, program.id))
+        return false;
+
+    reflectUniforms(program);
+    return true;
+}
+
+/**
+ * @brief Creates a compute shader program and resolves all of its active uniforms.
+ *
+ * @param computeShaderSource The source code of the compute shader.
+ * @param program The program object that will hold the ID and the resolved uniforms.
+ * @return True if the shader program is successfully created, otherwise false.
+ */
+bool UCreateComputeProgram(const char* computeShaderSource, GLProgram& program)
+{
+    CPU_ZONE("UCreateComputeProgram");
+
+    program.uniformNames.clear();
+    program.uniforms.clear();
+
+    int success = 0;
+    char infoLog[512];
+
+    GLuint computeShaderId = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(computeShaderId, 1, &computeShaderSource, NULL);
+    glCompileShader(computeShaderId);
+    glGetShaderiv(computeShaderId, GL_COMPILE_STATUS, &success);
+
+    if (!success)
+    {
+        glGetShaderInfoLog(computeShaderId, sizeof(infoLog), NULL, infoLog);
+        cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << endl;
+        glDeleteShader(computeShaderId);
+        return false;
+    }
+
+    program.id = glCreateProgram();
+    glAttachShader(program.id, computeShaderId);
+    glLinkProgram(program.id);
+    glDeleteShader(computeShaderId);
+    glGetProgramiv(program.id, GL_LINK_STATUS, &success);
+
+    if (!success)
+    {
+        glGetProgramInfoLog(program.id, sizeof(infoLog), NULL, infoLog);
+        cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << endl;
+        return false;
+    }
+
+    reflectUniforms(program);
+    return true;
+}
+
+/**
+ * @brief Looks up a uniform handle that was resolved when the program was linked.
+ *
+ * This is a plain search over the reflected names and is meant to be called once
+ * at startup, not per frame. Uniforms that the compiler optimized away return a
+ * handle with location -1, which the USetUniform functions silently ignore.
+ *
+ * @param program The program returned by UCreateShaderProgram.
+ * @param name The uniform name as written in the shader source.
+ * @return The resolved handle, or a handle with location -1 if the uniform is not active.
+ */
+GLUniform UGetUniform(const GLProgram& program, const char* name)
+{
+    for (size_t i = 0; i < program.uniformNames.size(); ++i)
+    {
+        if (program.uniformNames[i] == name)
+            return program.uniforms[i];
+    }
+
+    GLUniform inactive = { -1, GL_NONE, 0 };
+    return inactive;
+}
+
+/**
+ * @brief Typed uniform setters for pre-resolved handles.
+ *
+ * Each overload checks (in debug builds) that the GLSL type reported at link time
+ * matches the C++ type being uploaded, then issues the matching glUniform* call.
+ * They act on the program currently in use, just like the glUniform* functions.
+ *
+ * @param uniform The handle returned by UGetUniform.
+ * @param value The value to upload.
+ */
+void USetUniform(const GLUniform& uniform, GLint value)
+{
+    if (uniform.location < 0)
+        return;
+
+    assert(uniform.type == GL_INT || uniform.type == GL_BOOL || uniform.type == GL_SAMPLER_2D || uniform.type == GL_SAMPLER_2D_ARRAY);
+    glUniform1i(uniform.location, value);
+    UCountUniformCall();
+}
+
+void USetUniform(const GLUniform& uniform, GLfloat value)
+{
+    if (uniform.location < 0)
+        return;
+
+    assert(uniform.type == GL_FLOAT);
+    glUniform1f(uniform.location, value);
+    UCountUniformCall();
+}
+
+void USetUniform(const GLUniform& uniform, const glm::vec2& value)
+{
+    if (uniform.location < 0)
+        return;
+
+    assert(uniform.type == GL_FLOAT_VEC2);
+    glUniform2fv(uniform.location, 1, glm::value_ptr(value));
+    UCountUniformCall();
+}
+
+void USetUniform(const GLUniform& uniform, const glm::vec3& value)
+{
+    if (uniform.location < 0)
+        return;
+
+    assert(uniform.type == GL_FLOAT_VEC3);
+    glUniform3fv(uniform.location, 1, glm::value_ptr(value));
+    UCountUniformCall();
+}
+
+void USetUniform(const GLUniform& uniform, const glm::mat4& value)
+{
+    if (uniform.location < 0)
+        return;
+
+    assert(uniform.type == GL_FLOAT_MAT4);
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+    UCountUniformCall();
+}
+
 /**
  * @brief Deletes the shader program when it is no longer needed.
  *
@@ -89,4 +297,17 @@ bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSou
 void UDestroyShaderProgram(GLuint programId)
 {
     glDeleteProgram(programId);
+}
+
+/**
+ * @brief Deletes a reflected shader program and clears its uniform handles.
+ *
+ * @param program The program object to be deleted.
+ */
+void UDestroyShaderProgram(GLProgram& program)
+{
+    glDeleteProgram(program.id);
+    program.id = 0;
+    program.uniformNames.clear();
+    program.uniforms.clear();
 }
\ No newline at end of file
@@ -2,6 +2,42 @@
 
 
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Uniform block binding points shared by every program created by UCreateShaderProgram.
+// Shaders declare their blocks with layout(std140, binding = N) using these values.
+const GLuint UBO_BINDING_FRAME = 0;   // FrameData: camera matrices and position
+const GLuint UBO_BINDING_LIGHTS = 1;  // LightData: ambient color and light cluster grid
+
+// Shader storage block binding points of the clustered light lists (0-3 belong to the occlusion culler)
+const GLuint SSBO_BINDING_LIGHTS = 4;          // GPULight records
+const GLuint SSBO_BINDING_CLUSTER_COUNTS = 5;  // lights in each cluster
+const GLuint SSBO_BINDING_CLUSTER_LIGHTS = 6;  // light indices of each cluster
+
+// Struct to hold a uniform handle resolved once at link time
+struct GLUniform {
+    GLint location;   // -1 if the uniform is not active in the program
+    GLenum type;      // GLSL type reported by the program interface (GL_FLOAT_VEC3, ...)
+    GLint arraySize;  // number of array elements (1 for non-arrays)
+};
+
+// Struct to hold a linked shader program and its active uniforms
+struct GLProgram {
+    GLuint id;
+    std::vector<std::string> uniformNames; // names of the active uniforms ("[0]" suffix stripped)
+    std::vector<GLUniform> uniforms;       // handles matching uniformNames by index
+};
 
 bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLuint& programId);
-void UDestroyShaderProgram(GLuint programId);
\ No newline at end of file
+bool UCreateShaderProgram(const char* vtxShaderSource, const char* fragShaderSource, GLProgram& program);
+bool UCreateComputeProgram(const char* computeShaderSource, GLProgram& program);
+GLUniform UGetUniform(const GLProgram& program, const char* name);
+void USetUniform(const GLUniform& uniform, GLint value);
+void USetUniform(const GLUniform& uniform, GLfloat value);
+void USetUniform(const GLUniform& uniform, const glm::vec2& value);
+void USetUniform(const GLUniform& uniform, const glm::vec3& value);
+void USetUniform(const GLUniform& uniform, const glm::mat4& value);
+void UDestroyShaderProgram(GLuint programId);
+void UDestroyShaderProgram(GLProgram& program);
\ No newline at end of file
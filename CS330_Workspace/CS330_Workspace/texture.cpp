@@ -1,6 +1,10 @@
 #include "texture.h"
+#include "cpuprofiler.h"
+#include "glstate.h"
+#include "renderstats.h"
 #include <stb_image.h>  // For image loading
 #include <iostream>
+#include <vector>
 using namespace std;
 
 
@@ -39,71 +43,165 @@ void flipImageVertically(unsigned char* image, int width, int height, int channe
 
 
 /**
- * @brief Generates and loads a texture from an image file.
+ * @brief Computes the storage of a texture with a full or partial mip chain.
  *
- * This function uses the stb_image library to load an image file, then creates and configures an OpenGL texture.
- * The texture is flipped vertically to match OpenGL's expected orientation. Texture parameters such as wrapping
- * and filtering are set, and mipmaps are generated for the texture.
+ * @param width The width of level 0 in pixels.
+ * @param height The height of level 0 in pixels.
+ * @param layers The number of array layers (1 for a 2D texture).
+ * @param levels The number of mip levels.
+ * @param bytesPerTexel The size of one texel of the internal format.
+ * @return The number of bytes the texture's storage holds.
+ */
+uint64_t textureBytes(int width, int height, int layers, int levels, int bytesPerTexel)
+{
+    uint64_t bytes = 0;
+    for (int level = 0; level < levels; ++level)
+    {
+        uint64_t levelWidth = width >> level > 0 ? width >> level : 1;
+        uint64_t levelHeight = height >> level > 0 ? height >> level : 1;
+        bytes += levelWidth * levelHeight * layers * bytesPerTexel;
+    }
+    return bytes;
+}
+
+
+/**
+ * @brief Resizes an RGBA image with bilinear filtering.
  *
- * @param filename The path to the image file to be loaded.
+ * This function is used to bring images of different sizes to the common layer
+ * resolution of a texture array at load time.
+ *
+ * @param src A pointer to the source image data (4 channels).
+ * @param srcWidth The width of the source image in pixels.
+ * @param srcHeight The height of the source image in pixels.
+ * @param dst A pointer to the destination image data (4 channels).
+ * @param dstWidth The width of the destination image in pixels.
+ * @param dstHeight The height of the destination image in pixels.
+ */
+void resizeImage(const unsigned char* src, int srcWidth, int srcHeight, unsigned char* dst, int dstWidth, int dstHeight)
+{
+    for (int y = 0; y < dstHeight; ++y)
+    {
+        // Map the center of the destination pixel into the source image
+        float sy = (y + 0.5f) * srcHeight / dstHeight - 0.5f;
+        int y0 = sy < 0.0f ? 0 : (int)sy;
+        int y1 = y0 + 1 < srcHeight ? y0 + 1 : srcHeight - 1;
+        float fy = sy < 0.0f ? 0.0f : sy - y0;
+
+        for (int x = 0; x < dstWidth; ++x)
+        {
+            float sx = (x + 0.5f) * srcWidth / dstWidth - 0.5f;
+            int x0 = sx < 0.0f ? 0 : (int)sx;
+            int x1 = x0 + 1 < srcWidth ? x0 + 1 : srcWidth - 1;
+            float fx = sx < 0.0f ? 0.0f : sx - x0;
+
+            for (int c = 0; c < 4; ++c)
+            {
+                float top = src[(y0 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[(y0 * srcWidth + x1) * 4 + c] * fx;
+                float bottom = src[(y1 * srcWidth + x0) * 4 + c] * (1.0f - fx) + src[(y1 * srcWidth + x1) * 4 + c] * fx;
+                dst[(y * dstWidth + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Generates and loads a texture array from a list of image files.
+ *
+ * This function loads every image as RGBA, flips it for OpenGL's orientation,
+ * and stores image i in layer i of a GL_TEXTURE_2D_ARRAY with immutable storage
+ * (glTexStorage3D). The layer resolution is the largest width and height among
+ * the images; smaller or differently shaped images are resized to it. Binding
+ * the one array replaces binding a separate texture per material, and draws
+ * select their material with a layer index instead.
+ *
+ * @param filenames The paths to the image files, one per layer.
+ * @param count The number of image files.
  * @param textureId The GLuint reference where the texture ID will be stored.
- * @return Returns true if the texture was successfully created and loaded, false otherwise.
+ * @return Returns true if every image was loaded and the array was created, false otherwise.
  */
-bool UCreateTexture(const char* filename, GLuint& textureId)
+bool UCreateTextureArray(const char* const* filenames, int count, GLuint& textureId)
 {
-    int width, height, channels;
+    CPU_ZONE("UCreateTextureArray");
 
-    // Load the image from file using stb_image library
-    unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
-    if (image)
+    vector<unsigned char*> images(count, nullptr);
+    vector<int> widths(count), heights(count);
+    int layerWidth = 0, layerHeight = 0;
+    bool loaded = true;
+
+    // Load every image as 4-channel RGBA and find the common layer resolution
+    for (int i = 0; i < count; ++i)
     {
+        int channels;
+        images[i] = stbi_load(filenames[i], &widths[i], &heights[i], &channels, 4);
+        if (!images[i])
+        {
+            cout << "Failed to load texture " << filenames[i] << endl;
+            loaded = false;
+            break;
+        }
+
         // Flip the image vertically to match OpenGL's Y-axis orientation
-        flipImageVertically(image, width, height, channels);
+        flipImageVertically(images[i], widths[i], heights[i], 4);
+
+        layerWidth = widths[i] > layerWidth ? widths[i] : layerWidth;
+        layerHeight = heights[i] > layerHeight ? heights[i] : layerHeight;
+    }
 
-        // Generate and bind the texture
+    if (loaded && count > 0)
+    {
+        // Enough mip levels to go down to 1x1
+        GLsizei levels = 1;
+        for (int size = layerWidth > layerHeight ? layerWidth : layerHeight; size > 1; size /= 2)
+            ++levels;
+
+        // Generate and bind the texture array
         glGenTextures(1, &textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId);
+        UStateBindTexture(GL_TEXTURE_2D_ARRAY, textureId);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, layerWidth, layerHeight, count);
 
         // Set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
         // Set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // Determine the format based on the number of channels
-        if (channels == 3)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-            // Create a texture with RGB format
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-
-        else if (channels == 4)
+        // Rows of RGBA8 images are always 4-byte aligned
+        vector<unsigned char> resized;
+        for (int i = 0; i < count; ++i)
+        {
+            const unsigned char* pixels = images[i];
 
-            // Create a texture with RGBA format
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+            // Bring mismatched images to the layer resolution
+            if (widths[i] != layerWidth || heights[i] != layerHeight)
+            {
+                resized.resize((size_t)layerWidth * layerHeight * 4);
+                resizeImage(images[i], widths[i], heights[i], &resized[0], layerWidth, layerHeight);
+                pixels = &resized[0];
+            }
 
-        else
-        {
-            // Create a texture with RGBA format
-            cout << "Not implemented to handle image with " << channels << " channels" << endl;
-            return false;
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, layerWidth, layerHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
         }
 
-        // Generate mipmaps for the texture
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        // Free the image memory
-        stbi_image_free(image);
+        // Generate mipmaps for every layer
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        UTrackTextureMemory(textureId, textureBytes(layerWidth, layerHeight, count, levels, 4));
 
         // Unbind the texture
-        glBindTexture(GL_TEXTURE_2D, 0);
+        UStateBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
 
-        return true;
+    // Free the image memory
+    for (int i = 0; i < count; ++i)
+    {
+        if (images[i])
+            stbi_image_free(images[i]);
     }
 
-    // Error loading the image
-    return false;
+    return loaded && count > 0;
 }
 
 
@@ -117,4 +215,6 @@ bool UCreateTexture(const char* filename, GLuint& textureId)
 void UDestroyTexture(GLuint textureId)
 {
     glDeleteTextures(1, &textureId);
+    UStateForgetTexture(textureId);
+    UForgetTextureMemory(textureId);
 }
\ No newline at end of file
@@ -2,5 +2,5 @@
 
 #include <GL/glew.h>
 
-bool UCreateTexture(const char* filename, GLuint& textureId);
+bool UCreateTextureArray(const char* const* filenames, int count, GLuint& textureId);
 void UDestroyTexture(GLuint textureId);
\ No newline at end of file
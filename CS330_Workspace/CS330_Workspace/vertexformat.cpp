@@ -0,0 +1,203 @@
+#include "vertexformat.h"
+#include <glm/gtc/packing.hpp>
+#include <cstring>
+using namespace std;
+
+// unnamed namespace to hold the layout descriptors
+namespace
+{
+    // 3 float position, 3 float normal, 2 float texture coordinate
+    const VertexFormat STANDARD_FORMAT = {
+        VERTEX_FORMAT_STANDARD,
+        {
+            { 0, 3, GL_FLOAT, GL_FALSE, 0 },
+            { 1, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3 },
+            { 2, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 6 },
+        },
+        sizeof(GLfloat) * FLOATS_PER_VERTEX,
+        sizeof(GLfloat) * 3,
+        false
+    };
+
+    // 3 snorm16 position (padded to 4), 2 snorm16 octahedral normal, 2 unorm16 texture coordinate
+    const VertexFormat COMPACT_FORMAT = {
+        VERTEX_FORMAT_COMPACT,
+        {
+            { 0, 3, GL_SHORT, GL_TRUE, 0 },
+            { 1, 2, GL_SHORT, GL_TRUE, 8 },
+            { 2, 2, GL_UNSIGNED_SHORT, GL_TRUE, 12 },
+        },
+        16,
+        8,
+        true
+    };
+
+    /**
+     * @brief Returns -1 for negative values and 1 otherwise, including for zero.
+     */
+    glm::vec2 signNotZero(const glm::vec2& v)
+    {
+        return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+}
+
+
+/**
+ * @brief Returns the descriptor of a vertex layout.
+ *
+ * @param id The layout.
+ * @return The layout's attributes, strides, and decoding parameters.
+ */
+const VertexFormat& UGetVertexFormat(VertexFormatId id)
+{
+    return id == VERTEX_FORMAT_COMPACT ? COMPACT_FORMAT : STANDARD_FORMAT;
+}
+
+/**
+ * @brief Points the bound VAO's position, normal, and texture coordinate attributes at a vertex buffer.
+ *
+ * @param format The layout of the vertices in the buffer.
+ * @param vertexBuffer The buffer holding the vertices.
+ */
+void UBindVertexFormat(const VertexFormat& format, GLuint vertexBuffer)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+    for (const VertexAttribute& attribute : format.attributes)
+    {
+        glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized,
+            format.stride, (void*)(uintptr_t)attribute.offset);
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
+
+/**
+ * @brief Points the bound VAO's position attribute at a position-only stream.
+ *
+ * @param format The layout the stream's positions are stored in.
+ * @param positionBuffer The buffer holding the positions.
+ */
+void UBindVertexFormatPositions(const VertexFormat& format, GLuint positionBuffer)
+{
+    const VertexAttribute& position = format.attributes[0];
+
+    glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+    glVertexAttribPointer(position.location, position.components, position.type, position.normalized,
+        format.positionStride, 0);
+    glEnableVertexAttribArray(position.location);
+}
+
+/**
+ * @brief Converts built geometry to a vertex layout.
+ *
+ * Standard vertices are copied as they are. Compact positions are stored
+ * relative to the mesh's bounding box, so they use the full snorm16 range;
+ * positionScale and positionBias map them back and are folded into each
+ * instance's model matrix. Normals are folded onto an octahedron and stored as
+ * two components. Texture coordinates are divided by COMPACT_TEXCOORD_RANGE
+ * when they all fit in [0, COMPACT_TEXCOORD_RANGE]; otherwise they are stored
+ * relative to the mesh's own range, as positions are, so tiled or negative
+ * coordinates from imported models still encode. texCoordScale and
+ * texCoordBias map them back in the vertex shader. Every mesh fits either
+ * layout, so there is no failure to report.
+ *
+ * @param format The layout to encode to.
+ * @param data The MeshData structure holding the geometry.
+ * @param encoded The EncodedVertices structure receiving the vertex and position streams.
+ */
+void UEncodeVertices(const VertexFormat& format, const MeshData& data, EncodedVertices& encoded)
+{
+    size_t numVertices = data.vertices.size() / FLOATS_PER_VERTEX;
+    const GLfloat* v = data.vertices.data();
+
+    encoded.vertices.resize(format.stride * numVertices);
+    encoded.positions.resize(format.positionStride * numVertices);
+    encoded.positionScale = glm::vec3(1.0f);
+    encoded.positionBias = glm::vec3(0.0f);
+    encoded.texCoordScale = glm::vec2(1.0f);
+    encoded.texCoordBias = glm::vec2(0.0f);
+
+    // An empty mesh has no bounds to map
+    if (numVertices == 0)
+        return;
+
+    if (format.id == VERTEX_FORMAT_STANDARD)
+    {
+        memcpy(encoded.vertices.data(), v, encoded.vertices.size());
+        for (size_t i = 0; i < numVertices; ++i)
+            memcpy(&encoded.positions[format.positionStride * i], v + FLOATS_PER_VERTEX * i, format.positionStride);
+        return;
+    }
+
+    // Map the bounding box onto [-1, 1] on every axis
+    glm::vec3 lo(v[0], v[1], v[2]);
+    glm::vec3 hi = lo;
+    for (size_t i = 1; i < numVertices; ++i)
+    {
+        const GLfloat* p = v + i * FLOATS_PER_VERTEX;
+        lo = glm::min(lo, glm::vec3(p[0], p[1], p[2]));
+        hi = glm::max(hi, glm::vec3(p[0], p[1], p[2]));
+    }
+    encoded.positionBias = 0.5f * (lo + hi);
+    encoded.positionScale = glm::max(0.5f * (hi - lo), glm::vec3(1e-6f));
+
+    // Keep the shared [0, COMPACT_TEXCOORD_RANGE] mapping unless a coordinate falls outside it
+    glm::vec2 texLo(v[6], v[7]);
+    glm::vec2 texHi = texLo;
+    for (size_t i = 1; i < numVertices; ++i)
+    {
+        const GLfloat* p = v + i * FLOATS_PER_VERTEX;
+        texLo = glm::min(texLo, glm::vec2(p[6], p[7]));
+        texHi = glm::max(texHi, glm::vec2(p[6], p[7]));
+    }
+    if (glm::any(glm::lessThan(texLo, glm::vec2(0.0f))) ||
+        glm::any(glm::greaterThan(texHi, glm::vec2(COMPACT_TEXCOORD_RANGE))))
+    {
+        encoded.texCoordBias = texLo;
+        encoded.texCoordScale = glm::max(texHi - texLo, glm::vec2(1e-6f));
+    }
+    else
+        encoded.texCoordScale = glm::vec2(COMPACT_TEXCOORD_RANGE);
+
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        const GLfloat* p = v + i * FLOATS_PER_VERTEX;
+        unsigned char* out = &encoded.vertices[format.stride * i];
+
+        glm::vec3 position = (glm::vec3(p[0], p[1], p[2]) - encoded.positionBias) / encoded.positionScale;
+        glm::uint64 packedPosition = glm::packSnorm4x16(glm::vec4(position, 0.0f));
+        glm::uint packedNormal = glm::packSnorm2x16(UEncodeOctahedral(glm::vec3(p[3], p[4], p[5])));
+
+        glm::vec2 texCoord = (glm::vec2(p[6], p[7]) - encoded.texCoordBias) / encoded.texCoordScale;
+        glm::uint packedTexCoord = glm::packUnorm2x16(texCoord);
+
+        memcpy(out + format.attributes[0].offset, &packedPosition, sizeof(packedPosition));
+        memcpy(out + format.attributes[1].offset, &packedNormal, sizeof(packedNormal));
+        memcpy(out + format.attributes[2].offset, &packedTexCoord, sizeof(packedTexCoord));
+        memcpy(&encoded.positions[format.positionStride * i], &packedPosition, sizeof(packedPosition));
+    }
+}
+
+/**
+ * @brief Folds a unit normal onto the two components of an octahedral map.
+ *
+ * The normal is projected onto the octahedron |x| + |y| + |z| = 1, and the
+ * lower half is folded over the upper half, so every direction lands in
+ * [-1, 1] x [-1, 1] with nearly even precision. The vertex shader unfolds it.
+ * A zero normal, which imported models can contain, is encoded as +Z.
+ *
+ * @param normal The unit normal.
+ * @return The octahedral coordinates.
+ */
+glm::vec2 UEncodeOctahedral(const glm::vec3& normal)
+{
+    float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+    if (length == 0.0f)
+        return glm::vec2(0.0f);
+
+    glm::vec3 n = normal / length;
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f)
+        e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signNotZero(e);
+    return e;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "mesh.h"
+
+// Vertex layouts a geometry arena can store its meshes in
+enum VertexFormatId
+{
+    VERTEX_FORMAT_STANDARD = 0,  // float position, normal, and texture coordinate (32 bytes)
+    VERTEX_FORMAT_COMPACT = 1    // snorm16 position, octahedral snorm16 normal, unorm16 texture coordinate (16 bytes)
+};
+
+// Compact texture coordinates are stored as a fraction of this range when every one of a mesh's
+// coordinates fits in [0, COMPACT_TEXCOORD_RANGE], and of the mesh's own range otherwise
+const float COMPACT_TEXCOORD_RANGE = 8.0f;
+
+// Struct to hold one attribute of a vertex layout, as passed to glVertexAttribPointer
+struct VertexAttribute {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;           // bytes from the start of the vertex
+};
+
+// Struct to hold a vertex layout: its attributes, and how the shaders decode them
+struct VertexFormat {
+    VertexFormatId id;
+    VertexAttribute attributes[3];  // position (location 0), normal (1), texture coordinate (2)
+    GLsizei stride;                 // bytes per vertex
+    GLsizei positionStride;         // bytes per vertex of the position-only stream
+    bool octahedralNormals;         // normals are two octahedral components to be unfolded
+};
+
+// Struct to hold one mesh's vertices encoded in a vertex format
+struct EncodedVertices {
+    std::vector<unsigned char> vertices;   // stride bytes per vertex
+    std::vector<unsigned char> positions;  // positionStride bytes per vertex
+    glm::vec3 positionScale;               // object position = stored position * scale + bias
+    glm::vec3 positionBias;
+    glm::vec2 texCoordScale;               // texture coordinate = stored coordinate * scale + bias
+    glm::vec2 texCoordBias;
+};
+
+const VertexFormat& UGetVertexFormat(VertexFormatId id);
+void UBindVertexFormat(const VertexFormat& format, GLuint vertexBuffer);
+void UBindVertexFormatPositions(const VertexFormat& format, GLuint positionBuffer);
+void UEncodeVertices(const VertexFormat& format, const MeshData& data, EncodedVertices& encoded);
+glm::vec2 UEncodeOctahedral(const glm::vec3& normal);
\ No newline at end of file